@@ -0,0 +1,468 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include "utils.h"
+#include "crc32c.h"
+#include "main_functions.h"
+
+#define BENCH_CATALOG_PATH "build/bench/courses_bench.txt"
+#define BENCH_SAVE_PATH "build/bench/courses_save.txt"
+#define BENCH_REFERENCE_PATH "build/bench/courses_reference.txt"
+#define BENCH_COURSES 65535
+#define BENCH_REPETITIONS 5
+#define BENCH_LOG_PATH "build/bench/bench.log"
+#define BENCH_LOG_RECORDS 20000
+#define BENCH_SEATS_PATH "build/bench/courses_bench.seats"
+#define BENCH_STORE_DATA_PATH "build/bench/users_bench.db"
+#define BENCH_STORE_INDEX_PATH "build/bench/users_bench.idx"
+#define BENCH_STORE_USERS 2000
+#define BENCH_CHECKSUM_BYTES (4u << 20)
+#define BENCH_BACKUP_PATH "build/bench/courses_backup.txt"
+#define BENCH_ADMIN_PATH "build/bench/courses_admin.txt"
+#define BENCH_ADMIN_COURSES 30000
+
+void generate_catalog(const char *filepath, uint16_t courses);
+double elapsed_ms(struct timespec start, struct timespec end);
+void bench_load_courses(const char *filepath, unsigned int max_threads);
+void bench_save_courses(const char *filepath, unsigned int max_threads);
+bool same_content(const char *path_one, const char *path_two);
+void bench_booking_log(unsigned int max_threads);
+void bench_seat_counters(const char *filepath);
+void bench_user_store(void);
+void bench_checksums(void);
+void bench_background_save(const char *filepath);
+void bench_course_admin(void);
+
+int main(int argc, char* argv[]) {
+    unsigned int max_threads = 0;
+    if (argc > 1) {
+        max_threads = (unsigned int)atoi(argv[1]);
+    }
+    if (max_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        max_threads = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+    if (max_threads > MAX_LOAD_THREADS) {
+        max_threads = MAX_LOAD_THREADS;
+    }
+
+    generate_catalog(BENCH_CATALOG_PATH, BENCH_COURSES);
+    bench_load_courses(BENCH_CATALOG_PATH, max_threads);
+    bench_save_courses(BENCH_CATALOG_PATH, max_threads);
+    bench_booking_log(max_threads);
+    bench_seat_counters(BENCH_CATALOG_PATH);
+    bench_user_store();
+    bench_checksums();
+    bench_background_save(BENCH_CATALOG_PATH);
+    bench_course_admin();
+    return 0;
+}
+
+/*
+    Writes a catalog with the given number of courses in the text format
+    read by load_courses.
+*/
+void generate_catalog(const char *filepath, uint16_t courses) {
+    FILE *file = fopen(filepath, "w");
+    CHECK_NULL(file);
+
+    fprintf(file, "%u\n", courses);
+    for (uint32_t id = 1; id <= courses; id++) {
+        fprintf(file, "%u,Course %u,%02u:%02u %u/%u/2025,%u,%u,\n",
+                id, id % 300,
+                8 + id % 12, (id * 7) % 60,
+                1 + id % 28, 1 + id % 12,
+                10 + id % 40, id % 10);
+    }
+
+    fclose(file);
+}
+
+double elapsed_ms(struct timespec start, struct timespec end) {
+    return (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+/*
+    Loads the catalog with 1..max_threads threads and prints the best time
+    of BENCH_REPETITIONS runs for each thread count.
+*/
+void bench_load_courses(const char *filepath, unsigned int max_threads) {
+    printf("load_courses, %u courses\n", BENCH_COURSES);
+    printf("%8s %12s %10s\n", "threads", "best ms", "speedup");
+
+    double single_thread_ms = 0;
+    for (unsigned int threads = 1; threads <= max_threads; threads++) {
+        double best_ms = 0;
+        for (int r = 0; r < BENCH_REPETITIONS; r++) {
+            array_ptr array = NULL;
+            hash_map_ptr hash_map = NULL;
+            struct timespec start, end;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            load_courses_parallel(filepath, &array, &hash_map, threads);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            array_delete(array, NULL);
+            delete_hash_map(hash_map, true);
+
+            double ms = elapsed_ms(start, end);
+            if (r == 0 || ms < best_ms) best_ms = ms;
+        }
+        if (threads == 1) single_thread_ms = best_ms;
+        printf("%8u %12.3f %9.2fx\n", threads, best_ms, single_thread_ms / best_ms);
+    }
+}
+
+/*
+    Compares two files byte by byte.
+*/
+bool same_content(const char *path_one, const char *path_two) {
+    FILE *one = fopen(path_one, "r");
+    FILE *two = fopen(path_two, "r");
+    CHECK_NULL(one);
+    CHECK_NULL(two);
+
+    int c1, c2;
+    do {
+        c1 = fgetc(one);
+        c2 = fgetc(two);
+    } while (c1 == c2 && c1 != EOF);
+
+    fclose(one);
+    fclose(two);
+    return c1 == c2;
+}
+
+/*
+    Saves the catalog with 1..max_threads threads, prints the best time
+    of BENCH_REPETITIONS runs for each thread count, compared with the
+    fprintf callbacks, and checks the output against theirs.
+*/
+void bench_save_courses(const char *filepath, unsigned int max_threads) {
+    array_ptr array = NULL;
+    hash_map_ptr hash_map = NULL;
+    load_courses_parallel(filepath, &array, &hash_map, 1);
+
+    double fprintf_ms = 0;
+    for (int r = 0; r < BENCH_REPETITIONS; r++) {
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        FILE *reference = fopen(BENCH_REFERENCE_PATH, "w");
+        CHECK_NULL(reference);
+        fprintf(reference, "%d\n", get_size(array));
+        array_print(array, reference, print_course_file_callback);
+        fclose(reference);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ms = elapsed_ms(start, end);
+        if (r == 0 || ms < fprintf_ms) fprintf_ms = ms;
+    }
+
+    printf("save_courses, %u courses (fprintf callbacks: %.3f ms)\n", BENCH_COURSES, fprintf_ms);
+    printf("%8s %12s %10s %10s %10s\n", "threads", "best ms", "speedup", "vs fprintf", "output");
+
+    double single_thread_ms = 0;
+    for (unsigned int threads = 1; threads <= max_threads; threads++) {
+        double best_ms = 0;
+        for (int r = 0; r < BENCH_REPETITIONS; r++) {
+            struct timespec start, end;
+
+            clock_gettime(CLOCK_MONOTONIC, &start);
+            save_courses_parallel(BENCH_SAVE_PATH, array, threads);
+            clock_gettime(CLOCK_MONOTONIC, &end);
+
+            double ms = elapsed_ms(start, end);
+            if (r == 0 || ms < best_ms) best_ms = ms;
+        }
+        if (threads == 1) single_thread_ms = best_ms;
+        printf("%8u %12.3f %9.2fx %9.2fx %10s\n", threads, best_ms, single_thread_ms / best_ms,
+               fprintf_ms / best_ms,
+               same_content(BENCH_SAVE_PATH, BENCH_REFERENCE_PATH) ? "same" : "DIFFERS");
+    }
+
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+}
+
+/*
+    Replay callback of bench_booking_log: records are only counted.
+*/
+static void count_record(const booking_log_record *record, void *context) {
+    (void)record;
+    (void)context;
+}
+
+/*
+    Producer of bench_booking_log: queues its share of records and waits
+    for the last one to be durable.
+*/
+static void *log_producer(void *arg) {
+    uint32_t records = *(uint32_t *)arg;
+    booking_log_ticket ticket = 0;
+    for (uint32_t i = 0; i < records; i++) {
+        ticket = booking_log_book((uint16_t)(1 + i % UINT16_MAX));
+    }
+    booking_log_wait(ticket);
+    return NULL;
+}
+
+/*
+    Queues BENCH_LOG_RECORDS booking records from 1..max_threads producer
+    threads and reports how long it takes until all of them are durable,
+    and how many records reached the file.
+*/
+void bench_booking_log(unsigned int max_threads) {
+    printf("booking_log, %u records\n", BENCH_LOG_RECORDS);
+    printf("%8s %12s %14s\n", "threads", "ms", "records/ms");
+
+    for (unsigned int threads = 1; threads <= max_threads; threads++) {
+        remove(BENCH_LOG_PATH);
+        booking_log_open(BENCH_LOG_PATH, 0);
+
+        pthread_t producers[MAX_LOAD_THREADS];
+        uint32_t share = BENCH_LOG_RECORDS / threads;
+        struct timespec start, end;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (unsigned int t = 0; t < threads; t++) {
+            pthread_create(&producers[t], NULL, log_producer, &share);
+        }
+        for (unsigned int t = 0; t < threads; t++) {
+            pthread_join(producers[t], NULL);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        booking_log_close();
+
+        uint32_t replayed = booking_log_replay(BENCH_LOG_PATH, 0, count_record, NULL);
+        double ms = elapsed_ms(start, end);
+        printf("%8u %12.3f %14.1f %s\n", threads, ms, share * threads / ms,
+               replayed == share * threads ? "" : "RECORDS LOST");
+    }
+}
+
+/*
+    Compares persisting a few seat changes through the seat counter
+    sidecar with rewriting the whole catalog.
+*/
+void bench_seat_counters(const char *filepath) {
+    static const uint32_t dirty_courses[] = { 1, 10, 100, 1000 };
+    array_ptr array = NULL;
+    hash_map_ptr hash_map = NULL;
+    load_courses_parallel(filepath, &array, &hash_map, 1);
+
+    remove(BENCH_SEATS_PATH);
+    if (!seat_counters_open(BENCH_SEATS_PATH, filepath, array)) {
+        fprintf(stderr, "Cannot create %s\n", BENCH_SEATS_PATH);
+        exit(1);
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    save_courses_parallel(BENCH_SAVE_PATH, array, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("seat_counters, %u courses (full save: %.3f ms)\n", BENCH_COURSES, elapsed_ms(start, end));
+    printf("%8s %12s\n", "dirty", "flush ms");
+    for (size_t d = 0; d < sizeof(dirty_courses) / sizeof(dirty_courses[0]); d++) {
+        for (uint32_t i = 0; i < dirty_courses[d]; i++) {
+            seat_counters_mark(*(course_ptr*)get_at(array, (uint16_t)(i * 61 % BENCH_COURSES)));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        seat_counters_flush();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        printf("%8u %12.3f\n", dirty_courses[d], elapsed_ms(start, end));
+    }
+
+    seat_counters_close();
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+}
+
+/*
+    Scan callback of bench_user_store: records are only counted.
+*/
+static void count_user(const char *username, const char *value, size_t length, void *context) {
+    (void)username;
+    (void)value;
+    (void)length;
+    (*(uint32_t *)context)++;
+}
+
+/*
+    Fills a user store past its initial index capacity, reads every record
+    back, rewrites every record with a longer value and reports the time of
+    each phase and the data file size, which stays bounded by page reuse.
+*/
+void bench_user_store(void) {
+    char username[32];
+    char value[512];
+
+    remove(BENCH_STORE_DATA_PATH);
+    remove(BENCH_STORE_INDEX_PATH);
+    user_store_ptr store = user_store_open(BENCH_STORE_DATA_PATH, BENCH_STORE_INDEX_PATH);
+
+    printf("user_store, %u users\n", BENCH_STORE_USERS);
+    printf("%8s %12s %12s\n", "phase", "ms", "file KiB");
+
+    const char *phases[] = { "put", "get", "update" };
+    for (int phase = 0; phase < 3; phase++) {
+        bool valid = true;
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < BENCH_STORE_USERS; i++) {
+            snprintf(username, sizeof(username), "user%u", i);
+            int length = snprintf(value, sizeof(value), "00:00 1/1/2025\nCF%u,Name,Surname,user%u,pw,%*s\n",
+                                  i, i, phase == 2 ? (int)(i % 300) : (int)(i % 100), "");
+            if (phase == 1) {
+                size_t stored_length;
+                char *stored = user_store_get(store, username, &stored_length);
+                valid = valid && stored && strncmp(stored, value, 20) == 0;
+                mem_free(stored);
+            } else {
+                user_store_put(store, username, value, (size_t)length);
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        FILE *data = fopen(BENCH_STORE_DATA_PATH, "r");
+        CHECK_NULL(data);
+        fseek(data, 0, SEEK_END);
+        long size = ftell(data);
+        fclose(data);
+        printf("%8s %12.3f %12.1f %s\n", phases[phase], elapsed_ms(start, end), size / 1024.0,
+               valid ? "" : "RECORDS DIFFER");
+    }
+
+    uint32_t scanned = 0;
+    user_store_scan(store, count_user, &scanned);
+    if (scanned != BENCH_STORE_USERS || user_store_count(store) != BENCH_STORE_USERS) {
+        printf("scan found %u of %u users\n", scanned, BENCH_STORE_USERS);
+    }
+    user_store_close(store);
+}
+
+/*
+    Compares the throughput of the CRC32C used to verify persisted records
+    with the FNV-1a hash of str_hash, over the same buffer.
+*/
+void bench_checksums(void) {
+    unsigned char *buffer = mem_alloc(MEM_TAG_IO, BENCH_CHECKSUM_BYTES);
+    for (uint32_t i = 0; i < BENCH_CHECKSUM_BYTES; i++) buffer[i] = (unsigned char)(i * 131 + 7);
+
+    printf("checksums, %u KiB\n", BENCH_CHECKSUM_BYTES / 1024);
+    printf("%8s %12s %12s\n", "function", "ms", "MiB/s");
+
+    uint32_t sink = 0;
+    for (int function = 0; function < 2; function++) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int r = 0; r < BENCH_REPETITIONS; r++) {
+            sink ^= function == 0 ? crc32c(0, buffer, BENCH_CHECKSUM_BYTES)
+                                  : str_hash((const char *)buffer, BENCH_CHECKSUM_BYTES);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double ms = elapsed_ms(start, end) / BENCH_REPETITIONS;
+        printf("%8s %12.3f %12.1f\n", function == 0 ? "crc32c" : "fnv1a", ms,
+               BENCH_CHECKSUM_BYTES / 1048576.0 / (ms / 1000.0));
+    }
+    if (sink == 0) printf("\n");
+    mem_free(buffer);
+}
+
+/*
+    Background save of bench_background_save: writes the catalog from the
+    child's copy of the memory.
+*/
+static bool save_backup(void *context) {
+    return save_courses_parallel(BENCH_BACKUP_PATH, (array_ptr)context, 1);
+}
+
+/*
+    Saves the catalog from a forked child, once with the parent idle and
+    once with the parent changing the seats of every course meanwhile,
+    and reports the duration and the pages copied on write.
+*/
+void bench_background_save(const char *filepath) {
+    array_ptr array = NULL;
+    hash_map_ptr hash_map = NULL;
+    load_courses_parallel(filepath, &array, &hash_map, 1);
+    save_courses_parallel(BENCH_REFERENCE_PATH, array, 1);
+
+    printf("background_save, %u courses\n", BENCH_COURSES);
+    printf("%8s %12s %12s %12s\n", "parent", "child ms", "cow pages", "parent ms");
+    for (int busy = 0; busy < 2; busy++) {
+        struct timespec start, end;
+        background_save_stats stats;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (!background_save_start(save_backup, array)) {
+            fprintf(stderr, "Cannot start the background save\n");
+            exit(1);
+        }
+        for (uint16_t i = 0; busy && i < get_size(array); i++) {
+            course_ptr course = *(course_ptr*)get_at(array, i);
+            set_course_seats_booked(course, get_course_seats_booked(course));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        background_save_wait(&stats);
+        printf("%8s %12.3f %12llu %12.3f %s\n", busy ? "busy" : "idle", stats.duration_ms,
+               (unsigned long long)stats.cow_pages, elapsed_ms(start, end),
+               stats.success && same_content(BENCH_BACKUP_PATH, BENCH_REFERENCE_PATH) ? "" : "BACKUP DIFFERS");
+    }
+
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+}
+
+/*
+    Times deleting and adding back courses of a loaded catalog, each in
+    constant time, against reloading and rewriting the whole catalog.
+    The catalog is smaller than the others: at 65535 courses the index
+    cannot grow past one slot per course and every probe gets long.
+*/
+void bench_course_admin(void) {
+    static const uint32_t operations[] = { 1, 100, 10000 };
+    array_ptr array = NULL;
+    hash_map_ptr hash_map = NULL;
+    generate_catalog(BENCH_ADMIN_PATH, BENCH_ADMIN_COURSES);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    load_courses_parallel(BENCH_ADMIN_PATH, &array, &hash_map, 1);
+    save_courses_parallel(BENCH_SAVE_PATH, array, 1);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    printf("course_admin, %u courses (full load and save: %.3f ms)\n", BENCH_ADMIN_COURSES, elapsed_ms(start, end));
+    printf("%8s %12s %12s %s\n", "courses", "delete ms", "add ms", "");
+    struct datetime datetime;
+    init_datetime(&datetime, 0, 18, 1, 1, 2030);
+    for (size_t o = 0; o < sizeof(operations) / sizeof(operations[0]); o++) {
+        uint32_t count = operations[o];
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < count; i++) {
+            admin_delete_course(hash_map, array, (uint16_t)(i * 3 + 1));
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double delete_ms = elapsed_ms(start, end);
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t i = 0; i < count; i++) {
+            admin_add_course(hash_map, array, (uint16_t)(i * 3 + 1), "Course", &datetime, 20);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        bool intact = get_size(array) == BENCH_ADMIN_COURSES;
+        for (uint32_t id = 1; id <= BENCH_ADMIN_COURSES && intact; id++) {
+            intact = get_course(hash_map, (uint16_t)id) != NULL;
+        }
+        printf("%8u %12.3f %12.3f %s\n", count, delete_ms, elapsed_ms(start, end), intact ? "" : "CATALOG DAMAGED");
+    }
+
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+}
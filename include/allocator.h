@@ -0,0 +1,125 @@
+#ifndef ALLOCATOR_H
+#define ALLOCATOR_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+/*
+    Subsystem tags used to account every allocation of the project.
+    Counters are updated atomically, so allocation is safe from worker threads.
+*/
+typedef enum {
+    MEM_TAG_STRING,
+    MEM_TAG_COURSE,
+    MEM_TAG_DATETIME,
+    MEM_TAG_SUBSCRIPTION,
+    MEM_TAG_USER,
+    MEM_TAG_FREQUENTATION,
+    MEM_TAG_LINKED_LIST,
+    MEM_TAG_ARRAY,
+    MEM_TAG_HASH_MAP,
+    MEM_TAG_SESSION,
+    MEM_TAG_IO,
+    MEM_TAG_COUNT
+} mem_tag;
+
+/*
+    Counters kept for each tag.
+    arena_bytes counts bytes served from a session arena, which are
+    accounted as live under MEM_TAG_SESSION until the session closes.
+*/
+typedef struct {
+    size_t allocations;
+    size_t frees;
+    size_t live_bytes;
+    size_t peak_bytes;
+    size_t arena_bytes;
+} mem_stats;
+
+/*
+    Allocates memory and accounts it under the given tag.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        size: number of bytes requested.
+
+    Pre-conditions:
+        tag < MEM_TAG_COUNT.
+
+    Post-conditions:
+        The counters of tag are updated.
+
+    Returns:
+        Pointer to the allocated memory; exits the program on failure.
+*/
+void *mem_alloc(mem_tag tag, size_t size);
+
+/*
+    Allocates zero-initialized memory for count elements of size bytes.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        count: number of elements.
+        size: size of each element.
+
+    Returns:
+        Pointer to the allocated memory; exits the program on failure.
+*/
+void *mem_calloc(mem_tag tag, size_t count, size_t size);
+
+/*
+    Resizes memory previously returned by mem_alloc, mem_calloc or mem_realloc.
+
+    Parameters:
+        ptr: pointer to resize (may be NULL).
+        tag: subsystem the memory belongs to.
+        size: new size in bytes.
+
+    Returns:
+        Pointer to the resized memory; exits the program on failure.
+*/
+void *mem_realloc(void *ptr, mem_tag tag, size_t size);
+
+/*
+    Frees memory returned by mem_alloc, mem_calloc or mem_realloc and
+    updates the counters of the tag it was allocated with.
+
+    Parameters:
+        ptr: pointer to free (may be NULL).
+*/
+void mem_free(void *ptr);
+
+/*
+    Records that size bytes were served from a session arena for tag.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        size: number of bytes served.
+*/
+void mem_note_arena(mem_tag tag, size_t size);
+
+/*
+    Returns a copy of the counters of a tag.
+
+    Parameters:
+        tag: tag to query.
+
+    Returns:
+        The current counters.
+*/
+mem_stats mem_get_stats(mem_tag tag);
+
+/*
+    Prints a table with the counters of every tag.
+
+    Parameters:
+        file: output file.
+*/
+void mem_print_stats(FILE *file);
+
+/*
+    Registers an exit handler that prints the counters to stderr.
+*/
+void mem_dump_stats_at_exit(void);
+
+#endif
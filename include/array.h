@@ -8,14 +8,15 @@
 typedef struct array *array_ptr;
 
 /*
-    Function that creates a new array capable of holding up to `size` elements.
-    It allocates internal storage and initializes control fields.
+    Function that creates a new array with room for `size` elements; it
+    grows when more are added. It allocates internal storage and
+    initializes control fields.
 
     parameters:
         size: the intended capacity of the array (uint16_t).
 
     pre-condition:
-        size must be greater than zero.
+        None; a size of zero is raised to one.
 
     post-condition:
         A new array structure is created with the given size, and
@@ -29,7 +30,7 @@ array_ptr array_create(uint16_t size);
 
 /*
     Adds a new element to the array by inserting its reference at the next
-    available position.
+    available position, doubling the capacity of a full array.
 
     parameters:
         array:   pointer to the array 
@@ -38,19 +39,18 @@ array_ptr array_create(uint16_t size);
     pre-condition:
         array must be valid
         element must be valid
-        array->last_element < array->size
 
     post-condition:
         - element inserted at the last available position
         - last_element is incremented by 1
 
     return:
-        None; exits the program if capacity would be exceeded.
+        None; exits the program if the array already holds UINT16_MAX elements.
 */
 void array_add(array_ptr array, void* element);
 
 /*
-    Returns the total capacity (size) of the array.
+    Returns the number of elements stored in the array.
 
     parameters:
         array: pointer to the array (must be valid)
@@ -62,7 +62,7 @@ void array_add(array_ptr array, void* element);
         No changes to the array
 
     return:
-        The capacity of the array
+        The number of elements added so far
 */
 uint16_t get_size(array_ptr array);
 
@@ -75,7 +75,7 @@ uint16_t get_size(array_ptr array);
 
     pre-condition:
         array must be valid
-        index < array->size
+        index < get_size(array)
 
     post-condition:
         No changes to the array
@@ -95,7 +95,7 @@ void** get_at(array_ptr array, uint16_t index);
 
     pre-condition:
         array must be valid
-        index < array->size
+        index < get_size(array)
 
     post-condition:
         The element at the specified index is replaced
@@ -105,6 +105,48 @@ void** get_at(array_ptr array, uint16_t index);
 */
 void set_at(array_ptr array, uint16_t index, void* element);
 
+/*
+    Drops the elements from a given position to the end of the array.
+    The dropped elements are not freed.
+
+    parameters:
+        array: pointer to the array (must be valid)
+        size:  number of elements to keep
+
+    pre-condition:
+        array must be valid
+        size <= get_size(array)
+
+    post-condition:
+        get_size(array) == size
+
+    return:
+        None
+*/
+void array_truncate(array_ptr array, uint16_t size);
+
+/*
+    Removes the element at the specified index in constant time by moving
+    the last element into its place. The order of the elements is not
+    kept and the removed element is not freed.
+
+    parameters:
+        array: pointer to the array (must be valid)
+        index: zero-based index to remove
+
+    pre-condition:
+        array must be valid
+        index < get_size(array)
+
+    post-condition:
+        get_size(array) is one less; the former last element is at index
+        unless index was the last position
+
+    return:
+        void*: the removed element, or NULL if index is out of range
+*/
+void* array_swap_remove(array_ptr array, uint16_t index);
+
 /*
     Function that searches for an element by its ID within the array.
 
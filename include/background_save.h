@@ -0,0 +1,83 @@
+#ifndef BACKGROUND_SAVE_H
+#define BACKGROUND_SAVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+    Point-in-time saves written by a forked child while the parent keeps
+    serving, as Redis BGSAVE does. The child sees the memory of the
+    parent frozen at the fork; pages are shared copy-on-write, so only
+    the pages either process modifies during the save are duplicated.
+
+    At most one save runs at a time. The child reports how long the save
+    took and how many of its pages stopped being shared with the parent
+    (Private_Dirty in /proc/self/smaps_rollup, 0 where it is missing).
+*/
+
+/* Outcome of a finished background save */
+typedef struct {
+    bool success;
+    double duration_ms;
+    uint64_t cow_pages;
+} background_save_stats;
+
+/*
+    Forks a child that calls save and exits; the parent returns at once.
+
+    Parameters:
+        save: writes the snapshot from the child's copy of the memory and
+              returns false if it failed.
+        context: passed through to save.
+
+    Pre-conditions:
+        save must not be NULL; it must only write files, since nothing
+        it changes in memory is seen by the parent. It reports failures
+        through its return value rather than exiting the child.
+
+    Post-conditions:
+        A save is in progress on success.
+
+    Returns:
+        bool: false if a save is already running or the fork failed.
+*/
+bool background_save_start(bool (*save)(void *context), void *context);
+
+/*
+    Tells whether a background save is running.
+
+    Returns:
+        bool: true between a successful start and the poll or wait that
+        collects the child.
+*/
+bool background_save_in_progress(void);
+
+/*
+    Collects a finished background save without blocking.
+
+    Parameters:
+        stats: output, receives the outcome of the save.
+
+    Pre-conditions:
+        stats must not be NULL.
+
+    Returns:
+        bool: true if a save finished and stats was filled.
+*/
+bool background_save_poll(background_save_stats *stats);
+
+/*
+    Waits for the running background save to finish.
+
+    Parameters:
+        stats: output, receives the outcome of the save.
+
+    Pre-conditions:
+        stats must not be NULL.
+
+    Returns:
+        bool: true if a save was running and stats was filled.
+*/
+bool background_save_wait(background_save_stats *stats);
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef BOOKING_LOG_H
+#define BOOKING_LOG_H
+
+#include "datetime.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define BOOKING_LOG_VERSION 1
+#define BOOKING_LOG_INTERVAL_ENV "MYFITNESS_LOG_INTERVAL_MS"
+#define BOOKING_LOG_BATCH_ENV "MYFITNESS_LOG_BATCH"
+#define BOOKING_LOG_INTERVAL_MS 10
+#define BOOKING_LOG_BATCH 64
+
+/*
+    Write-ahead log of the mutations made during a session. Every
+    successful booking, cancellation and renewal queues one fixed-size
+    binary record; on the next login the records are replayed on top of
+    the last full save, and the log is emptied once a full save succeeds.
+
+    Records are not written by the caller: they go through a lock-free
+    queue to a persistence thread, which coalesces them and writes them
+    in batches with one fdatasync per batch, every BOOKING_LOG_INTERVAL_MS
+    or as soon as BOOKING_LOG_BATCH records are pending (both can be
+    overridden through the environment variables above).
+
+    Only log records go through the persistence thread. A booking or
+    cancellation record stands for the seat change and the booked and
+    history change together, replay redoes all of them. The seat counter
+    sidecar and the user record themselves are still written by the
+    interactive thread, when the session is saved: first the sidecar,
+    after a seats record naming the generation its blocks are written
+    with (see seat_counters.h), so replay can tell which seat changes the
+    sidecar already holds; then the user record; then the log is emptied.
+
+    The header carries the stamp of the saved user record the records
+    apply to (the CRC32C of its text, see load_user_from_store). A crash
+    after the full save but before the log is emptied leaves records that
+    are already in the new user record; its stamp no longer matches, so
+    they are dropped instead of being applied twice.
+
+    On-disk layout: "MFBL" | uint32 version | uint32 base stamp | record*
+    Each record ends with the CRC32C of its other fields.
+*/
+typedef enum {
+    BOOKING_LOG_BOOK = 1,
+    BOOKING_LOG_CANCEL = 2,
+    BOOKING_LOG_RENEW = 3,
+    BOOKING_LOG_SEATS = 4
+} booking_log_type;
+
+/* Compact datetime, as stored in a log record */
+typedef struct {
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+} booking_log_date;
+
+/*
+    Durability future of a queued record: booking_log_wait on it returns
+    once the record is on stable storage. 0 means nothing was queued.
+*/
+typedef uint64_t booking_log_ticket;
+
+/*
+    One log record: 24 bytes, course_id for book/cancel, dates for renew,
+    generation for seats. checksum is filled when the record is queued.
+*/
+typedef struct {
+    uint8_t type;
+    uint8_t reserved;
+    uint16_t course_id;
+    uint32_t generation;
+    booking_log_date start;
+    booking_log_date end;
+    uint32_t checksum;
+} booking_log_record;
+
+/*
+    Opens (creating it if needed) the log that subsequent appends go to
+    and starts its persistence thread.
+
+    Parameters:
+        filepath: path of the log file.
+        base: stamp of the user record the session started from.
+
+    Pre-conditions:
+        No log is open.
+
+    Post-conditions:
+        The log is open for appending, cut after its last intact record.
+        A log stamped with another base is emptied first, its records are
+        already saved.
+
+    Returns:
+        None; exits the program if the file cannot be opened or is not a log.
+*/
+void booking_log_open(const char *filepath, uint32_t base);
+
+/*
+    Queues a booking record.
+
+    Parameters:
+        course_id: ID of the booked course.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_book(uint16_t course_id);
+
+/*
+    Queues a cancellation record.
+
+    Parameters:
+        course_id: ID of the cancelled course.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_cancel(uint16_t course_id);
+
+/*
+    Queues a subscription renewal record.
+
+    Parameters:
+        start: new subscription start date.
+        end: new subscription end date.
+
+    Pre-conditions:
+        start and end must not be NULL.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_renew(datetime_ptr start, datetime_ptr end);
+
+/*
+    Queues a seats record: the seat counters of the records before it are
+    about to be flushed to the sidecar with the given generation.
+
+    Parameters:
+        generation: generation reserved for the flush.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_seats(uint32_t generation);
+
+/*
+    Blocks until a queued record is on stable storage. The persistence
+    thread is woken up so the wait does not last a whole interval.
+
+    Parameters:
+        ticket: future returned when the record was queued.
+
+    Post-conditions:
+        The record and every record queued before it by the same thread
+        are durable. Returns at once for ticket 0 or if no log is open.
+*/
+void booking_log_wait(booking_log_ticket ticket);
+
+/*
+    Converts a stored date back to a datetime.
+
+    Parameters:
+        datetime: destination.
+        date: stored date.
+
+    Pre-conditions:
+        Both parameters must not be NULL.
+*/
+void booking_log_to_datetime(datetime_ptr datetime, const booking_log_date *date);
+
+/*
+    Empties the open log, after its records have been saved in full.
+    Records still queued are written first.
+
+    Post-conditions:
+        Only the header remains; nothing happens if no log is open.
+*/
+void booking_log_checkpoint(void);
+
+/*
+    Writes the records still queued, stops the persistence thread and
+    closes the open log, if any.
+
+    Post-conditions:
+        Appends are ignored until a log is opened again.
+*/
+void booking_log_close(void);
+
+/*
+    Reads a log and calls apply on every record, in order, up to the
+    first one that is partial (interrupted append) or fails its checksum;
+    the records from there on are reported on stderr and ignored. Nothing
+    is applied if the log is stamped with another base.
+
+    Parameters:
+        filepath: path of the log file.
+        base: stamp of the user record the records are applied to.
+        apply: function applying one record.
+        context: passed through to apply.
+
+    Pre-conditions:
+        No log is open on filepath.
+
+    Returns:
+        uint32_t: number of records applied; 0 if the log does not exist
+        or belongs to another base.
+        Exits the program if the file is not a log.
+*/
+uint32_t booking_log_replay(const char *filepath, uint32_t base,
+                            void (*apply)(const booking_log_record *record, void *context),
+                            void *context);
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef CATALOG_SNAPSHOT_H
+#define CATALOG_SNAPSHOT_H
+
+#include "array.h"
+#include "hash_map.h"
+#include <stdbool.h>
+
+#define CATALOG_SNAPSHOT_VERSION 1
+
+/*
+    Writes the catalog to a binary snapshot: a header, one fixed-width
+    record per course (in array order), the hash index layout of the map
+    and a pool of null-terminated course names. The header carries a
+    checksum of the sections and no catalog stamp.
+
+    Parameters:
+        filepath: path of the snapshot file to create.
+        array: catalog array.
+        hash_map: catalog hash map indexing the same courses.
+
+    Pre-conditions:
+        All parameters must be valid.
+
+    Post-conditions:
+        The snapshot file is created or replaced; on failure the error is
+        reported and the file is left as it was.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+bool save_catalog_snapshot(const char *filepath, array_ptr array, hash_map_ptr hash_map);
+
+/*
+    Writes the catalog to a binary snapshot as save_catalog_snapshot does,
+    stamping the header with the size and modification time of the text
+    catalog, so the next start can trust the saved index without looking
+    at the text file.
+
+    Parameters:
+        filepath: path of the snapshot file to create.
+        text_path: path of the text catalog the courses match.
+        array: catalog array.
+        hash_map: catalog hash map indexing the same courses.
+
+    Pre-conditions:
+        All parameters must be valid; the text catalog must already hold
+        the courses being saved.
+
+    Post-conditions:
+        The snapshot file is created or replaced; on failure the error is
+        reported and the file is left as it was.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+bool save_catalog_snapshot_stamped(const char *filepath, const char *text_path, array_ptr array, hash_map_ptr hash_map);
+
+/*
+    Tells whether the snapshot was exported from the current text catalog,
+    comparing the stamp in its header with the size and modification time
+    of the text file. An unstamped snapshot is never fresh while the text
+    file exists.
+
+    Parameters:
+        snapshot_path: path of the binary snapshot.
+        text_path: path of the text catalog.
+
+    Returns:
+        true if the snapshot exists and matches the text file, or there is
+        no text file.
+*/
+bool catalog_snapshot_is_fresh(const char *snapshot_path, const char *text_path);
+
+/*
+    Maps a binary snapshot in memory and builds the catalog from it
+    without any text parsing; the hash map is restored slot by slot from
+    the saved index, with no hashing or probing.
+
+    Parameters:
+        filepath: path of the snapshot file.
+        array: output, receives the catalog array.
+        hash_map: output, receives the catalog hash map.
+
+    Pre-conditions:
+        array and hash_map must not be NULL.
+
+    Post-conditions:
+        On success *array and *hash_map hold the catalog.
+        On failure nothing is allocated.
+
+    Returns:
+        true on success; false if the file is missing, of another version,
+        malformed or fails its checksum, so the caller can fall back to
+        the text catalog.
+*/
+bool load_catalog_snapshot(const char *filepath, array_ptr *array, hash_map_ptr *hash_map);
+
+#endif
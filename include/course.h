@@ -2,11 +2,27 @@
 #define COURSE_H
 
 #include "datetime.h"
+#include "out_buffer.h"
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 
 typedef struct course *course_ptr;
 
+/*
+    Stable reference to a course, valid across catalog compaction and
+    reload. Every course owns a slot of the course slab; a handle is the
+    slot index (low 16 bits) and the slot generation (high 16 bits).
+    Deleting a course bumps the generation of its slot, so any handle
+    still pointing to it resolves to NULL instead of to freed memory or
+    to the course that later reuses the slot. A slot whose generation is
+    exhausted is retired rather than reused.
+*/
+typedef uint32_t course_handle;
+
+/* Never the handle of a course */
+#define COURSE_HANDLE_NONE 0
+
 /*
     Creates a new course object with the specified parameters.
 
@@ -23,13 +39,14 @@ typedef struct course *course_ptr;
 
     Post-conditions:
         A new course object is allocated and initialized.
+        The name is interned, so courses with the same name share it.
 
     Returns:
         course_ptr: pointer to the newly created course object.
 */
 course_ptr create_course(
     uint16_t id,
-    char* name, 
+    const char* name, 
     datetime_ptr datetime, 
     uint16_t seats_total,
     uint16_t seats_booked
@@ -71,7 +88,7 @@ int compare_course_id(void* a, void* b);
         course must be initialized and not NULL.
 
     Returns:
-        char*: name of the course.
+        char*: interned name of the course (must not be freed).
 */
 char* get_course_name(course_ptr course);
 
@@ -129,17 +146,67 @@ uint16_t get_course_seats_booked(course_ptr course);
 */
 void set_course_seats_booked(course_ptr course, int value);
 
+/*
+    Returns the position of the course in the catalog array, kept by
+    whoever adds, moves or removes it there so that a course is found
+    in the array without scanning it.
+
+    Parameters:
+        course: pointer to the course.
+
+    Pre-conditions:
+        course must be initialized and not NULL.
+
+    Returns:
+        uint16_t: index of the course in the catalog array.
+*/
+uint16_t get_course_position(course_ptr course);
+
+/*
+    Records the position of the course in the catalog array.
+
+    Parameters:
+        course: pointer to the course.
+        position: index of the course in the catalog array.
+
+    Returns:
+        None.
+*/
+void set_course_position(course_ptr course, uint16_t position);
+
+/*
+    Replaces the description of a course in place, so pointers to it
+    stay valid. The id and the booked seats are left unchanged.
+
+    Parameters:
+        course: pointer to the course.
+        name: new name (need not be null-terminated).
+        name_length: length of name.
+        datetime: new datetime, copied into the course.
+        seats_total: new total number of seats.
+
+    Pre-conditions:
+        course, name and datetime must not be NULL.
+
+    Post-conditions:
+        The name is interned.
+
+    Returns:
+        None.
+*/
+void update_course(course_ptr course, const char *name, size_t name_length, datetime_ptr datetime, uint16_t seats_total);
+
 /*
     Callback function to save course booking information to a file.
 
     Parameters:
-        file: output file pointer.
+        out: output buffer of the user file.
         element: void pointer to a course.
 
     Returns:
         None.
 */
-void save_booking_callback(FILE *file, void *element);
+void save_booking_callback(out_buffer_ptr out, void *element);
 
 /*
     Prints detailed information about the course.
@@ -180,7 +247,45 @@ void print_course_callback(FILE *file, void *element);
 void print_course_file_callback(FILE *file, void *element);
 
 /*
-    Frees the memory allocated for the course, its name, and datetime.
+    Callback function to save a course as one line of the catalog file,
+    with the same text print_course_file_callback writes.
+
+    Parameters:
+        out: output buffer of the catalog file.
+        element: void pointer to a course.
+
+    Returns:
+        None.
+*/
+void save_course_callback(out_buffer_ptr out, void *element);
+
+/*
+    Returns the handle of a course.
+
+    Parameters:
+        course: pointer to the course.
+
+    Pre-conditions:
+        course must be initialized and not NULL.
+
+    Returns:
+        course_handle: the handle, valid until the course is deleted.
+*/
+course_handle get_course_handle(course_ptr course);
+
+/*
+    Resolves a course handle in constant time.
+
+    Parameters:
+        handle: handle returned by get_course_handle.
+
+    Returns:
+        course_ptr: the course, or NULL if it has been deleted since.
+*/
+course_ptr resolve_course_handle(course_handle handle);
+
+/*
+    Frees the memory allocated for the course and its datetime.
 
     Parameters:
         course: pointer to the course to delete.
@@ -188,9 +293,29 @@ void print_course_file_callback(FILE *file, void *element);
     Pre-conditions:
         course must be initialized and not NULL.
 
+    Post-conditions:
+        Handles to the course no longer resolve.
+
     Returns:
         None.
 */
 void delete_course(course_ptr course);
 
+/*
+    Frees the course slab.
+
+    Parameters:
+        None.
+
+    Pre-conditions:
+        Every course has been deleted and no handle is resolved afterwards.
+
+    Post-conditions:
+        The slab is empty.
+
+    Returns:
+        None.
+*/
+void course_slab_clear(void);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,29 @@
+#ifndef CRC32C_H
+#define CRC32C_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    CRC32C (Castagnoli) of the records written to disk. On x86-64 CPUs
+    with SSE4.2 it is computed with the crc32 instruction, eight bytes at
+    a time; elsewhere a 256-entry table is used. Both give the same value.
+*/
+
+/*
+    Extends a CRC32C with more bytes.
+
+    Parameters:
+        crc: CRC32C of the preceding bytes, 0 to start a new one.
+        data: bytes to add.
+        length: number of bytes.
+
+    Pre-conditions:
+        data must be readable for length bytes (may be NULL if length is 0).
+
+    Returns:
+        uint32_t: CRC32C of the preceding bytes followed by data.
+*/
+uint32_t crc32c(uint32_t crc, const void *data, size_t length);
+
+#endif
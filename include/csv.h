@@ -0,0 +1,106 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include "utils.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Delimiter sets. A record field ends at ',' or '\n' only, so names and
+    passwords may contain ';'. An element of the booked or history list
+    may also end at ';'.
+*/
+typedef enum {
+    CSV_DELIMS_FIELD,
+    CSV_DELIMS_LIST
+} csv_delims;
+
+/*
+    Returns a pointer to the first delimiter of the given set in [p, end).
+    The search is vectorized 16 or 32 bytes at a time when the compiler
+    targets SSE2/AVX2, and scalar otherwise.
+
+    Parameters:
+        p: first character to examine.
+        end: one past the last character.
+        delims: delimiter set to stop at.
+
+    Pre-conditions:
+        p <= end, and [p, end) must be readable.
+
+    Returns:
+        Pointer to the delimiter, or end if there is none.
+*/
+const char *csv_find_delimiter(const char *p, const char *end, csv_delims delims);
+
+/*
+    Extracts the next field from a view.
+
+    Parameters:
+        rest: view to read from; advanced past the delimiter.
+        delim: output, receives the delimiter that ended the field
+               (',', ';', '\n'), or '\0' when the view was exhausted.
+        delims: delimiter set ending the field.
+
+    Pre-conditions:
+        rest and delim must not be NULL.
+
+    Post-conditions:
+        rest starts after the returned field and its delimiter.
+
+    Returns:
+        The field span (possibly empty).
+*/
+str_view csv_next_field(str_view *rest, char *delim, csv_delims delims);
+
+/*
+    Skips the remaining fields of the current line.
+
+    Parameters:
+        rest: view to advance.
+        delim: delimiter that ended the last field read, updated.
+
+    Post-conditions:
+        rest starts at the next line (or is empty).
+*/
+void csv_skip_line(str_view *rest, char *delim);
+
+/*
+    Reads the fields of the current line and moves to the next line.
+    Fields are split on ',' only. Extra fields beyond max_fields are skipped.
+
+    Parameters:
+        rest: view to read from; advanced to the start of the next line.
+        fields: output array receiving the field spans.
+        max_fields: capacity of fields.
+
+    Pre-conditions:
+        rest and fields must not be NULL.
+
+    Returns:
+        The number of fields stored (0 if rest was empty).
+*/
+int csv_read_line(str_view *rest, str_view *fields, int max_fields);
+
+/*
+    Parses a decimal unsigned integer from a view, allowing surrounding
+    spaces, tabs and carriage returns.
+
+    Parameters:
+        view: characters to parse.
+        max: largest accepted value.
+        value: output, receives the parsed value.
+
+    Pre-conditions:
+        value must not be NULL.
+
+    Post-conditions:
+        *value is set only on success.
+
+    Returns:
+        true on success; false if the view is empty, contains anything
+        other than digits, or the number exceeds max (overflow).
+*/
+bool csv_parse_uint(str_view view, uint32_t max, uint32_t *value);
+
+#endif
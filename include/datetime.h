@@ -3,6 +3,18 @@
 
 #include <stdio.h>
 
+/*
+    The layout is public so that datetimes can be embedded by value
+    in other records (subscription, user) instead of being heap allocated.
+*/
+struct datetime {
+    int minute;
+    int hour;
+    int day;
+    int month;
+    int year;
+};
+
 typedef struct datetime *datetime_ptr;
 
 /*
@@ -66,7 +78,25 @@ int compare_time(datetime_ptr datetime_one, datetime_ptr datetime_two);
 int compare_datetime(datetime_ptr datetime_one, datetime_ptr datetime_two);
 
 /*
-    Allocates and initializes a new datetime object.
+    Fills an existing datetime with the current local date and time.
+
+    parameters:
+        datetime: pointer to the datetime to fill.
+
+    pre-condition:
+        datetime must not be NULL.
+
+    post-condition:
+        datetime holds the current local date and time.
+
+    return:
+        Nothing.
+*/
+void init_datetime_now(datetime_ptr datetime);
+
+/*
+    Allocates and initializes a new datetime object with the current
+    local date and time; it is released with delete_datetime.
 
     parameters:
         None.
@@ -108,6 +138,29 @@ int get_datetime_field(datetime_ptr datetime, char* field);
 */
 datetime_ptr create_datetime(int minute, int hour, int day, int month, int year);
 
+/*
+    Sets every field of an existing datetime, which may live on the stack
+    or inside another record.
+
+    parameters:
+        datetime — pointer to the datetime to fill
+        minute   — minute value (0–59)
+        hour     — hour value (0–23)
+        day      — day of month (1–31)
+        month    — month of year (1–12)
+        year     — full year (e.g., 2025)
+
+    pre-condition:
+        datetime must be non-NULL.
+
+    post-condition:
+        datetime contains exactly the provided fields.
+
+    return:
+        Nothing.
+*/
+void init_datetime(datetime_ptr datetime, int minute, int hour, int day, int month, int year);
+
 /*
     Print the datetime object.
 
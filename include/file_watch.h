@@ -0,0 +1,60 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <stdbool.h>
+
+/*
+    Change notifications for a single file, through inotify. The
+    directory of the file is watched rather than the file itself, so a
+    file replaced by rename (as editors and out_buffer_open do) is still
+    seen. Only completed writes count: a file closed after writing, or a
+    file moved into place.
+
+    Checks never block; the caller polls between its own work.
+*/
+typedef struct file_watch *file_watch_ptr;
+
+/*
+    Starts watching a file.
+
+    Parameters:
+        filepath: path of the file; it need not exist yet.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Returns:
+        file_watch_ptr: the watch, or NULL if inotify is not available.
+*/
+file_watch_ptr file_watch_open(const char *filepath);
+
+/*
+    Tells whether the file changed since the previous call, consuming
+    all the pending notifications.
+
+    Parameters:
+        watch: the watch.
+
+    Pre-conditions:
+        watch must not be NULL.
+
+    Returns:
+        bool: true if the file was written or replaced.
+*/
+bool file_watch_changed(file_watch_ptr watch);
+
+/*
+    Stops watching and frees the watch.
+
+    Parameters:
+        watch: the watch.
+
+    Pre-conditions:
+        watch must not be NULL.
+
+    Post-conditions:
+        The watch must not be used anymore.
+*/
+void file_watch_close(file_watch_ptr watch);
+
+#endif
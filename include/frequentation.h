@@ -1,6 +1,7 @@
 #ifndef FREQUENTATION_H
 #define FREQUENTATION_H
 
+#include "out_buffer.h"
 #include <stdio.h>
 #include <stdint.h>
 
@@ -18,7 +19,7 @@ typedef struct frequentation *frequentation_ptr;
         course_name must not be NULL.
 
     Post-conditions:
-        Allocates memory for a new frequentation and copies course_name.
+        Allocates memory for a new frequentation and interns course_name.
 
     Returns:
         A pointer to the newly created frequentation object.
@@ -26,19 +27,20 @@ typedef struct frequentation *frequentation_ptr;
 frequentation_ptr create_frequentation(uint16_t course_id, char *course_name, uint16_t times_booked);
 
 /*
-    Saves the frequentation data to a file in CSV format.
+    Saves the frequentation data to a user file as an "id:count," pair.
 
     Parameters:
-        file: file pointer to write to.
+        out: output buffer of the user file.
         element: void pointer to frequentation object.
 
     Returns:
         None.
 */
-void save_frequentation_callback(FILE *file, void *element);
+void save_frequentation_callback(out_buffer_ptr out, void *element);
 
 /*
-    Frees the memory allocated for a frequentation, including its name.
+    Frees the memory allocated for a frequentation.
+    The interned name is not freed.
 
     Parameters:
         element: void pointer to frequentation object.
@@ -105,4 +107,16 @@ void set_frequentation_times_booked(frequentation_ptr frequentation, int value);
 */
 void print_frequentation_callback(FILE* file, void* element);
 
+/*
+    Writes the same text as print_frequentation_callback to a report file.
+
+    Parameters:
+        out: output buffer of the report file.
+        element: void pointer to frequentation.
+
+    Returns:
+        None.
+*/
+void report_frequentation_callback(out_buffer_ptr out, void* element);
+
 #endif
\ No newline at end of file
@@ -2,6 +2,7 @@
 #define HASH_MAP_H
 
 #include "course.h"
+#include "array.h"
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -27,7 +28,7 @@ hash_map_ptr create_hash_map(uint16_t size);
 
 /*
     Inserts a course into the hash map using the given key.
-    If the key already exists, the existing course is deleted and replaced.
+    If the key already exists, the existing course is replaced and returned.
 
     Parameters:
         map: pointer to the hash map.
@@ -42,9 +43,9 @@ hash_map_ptr create_hash_map(uint16_t size);
         The course is inserted or updated in the map.
 
     Returns:
-        None.
+        course_ptr: the course replaced (not freed), or NULL.
 */
-void insert_course(hash_map_ptr map, uint16_t key, course_ptr value);
+course_ptr insert_course(hash_map_ptr map, uint16_t key, course_ptr value);
 
 /*
     Retrieves a course from the hash map using the given key.
@@ -64,6 +65,95 @@ void insert_course(hash_map_ptr map, uint16_t key, course_ptr value);
 */
 course_ptr get_course(hash_map_ptr map, uint16_t key);
 
+/*
+    Removes a course from the hash map by its key, shifting the rest of
+    its probe run back so that no tombstone is left.
+
+    Parameters:
+        map: pointer to the hash map.
+        key: the course ID to remove.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Post-conditions:
+        The key is no longer in the map; the course itself is not freed.
+
+    Returns:
+        course_ptr: the removed course, or NULL if the key was not in the map.
+*/
+course_ptr remove_course(hash_map_ptr map, uint16_t key);
+
+/*
+    Returns the number of slots in the hash map.
+
+    Parameters:
+        map: pointer to the hash map.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Returns:
+        uint16_t: table size.
+*/
+uint16_t get_hash_map_size(hash_map_ptr map);
+
+/*
+    Returns the slot index holding the given key.
+
+    Parameters:
+        map: pointer to the hash map.
+        key: the key to look up.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Returns:
+        int: slot index, or -1 if the key is not present.
+*/
+int get_course_slot(hash_map_ptr map, uint16_t key);
+
+/*
+    Describes the table layout for persistence: for every slot, the
+    position + 1 of its course in the catalog array, or 0 if it is empty.
+
+    Parameters:
+        map: pointer to the hash map.
+        array: catalog array holding the same courses.
+        slots: output, receives one entry per slot of the map.
+
+    Pre-conditions:
+        map and array must not be NULL; slots must hold
+        get_hash_map_size(map) entries.
+
+    Returns:
+        None.
+*/
+void export_hash_map_layout(hash_map_ptr map, array_ptr array, uint16_t *slots);
+
+/*
+    Restores a table layout saved by export_hash_map_layout in one pass,
+    without hashing or probing.
+
+    Parameters:
+        map: pointer to an empty hash map of the saved size.
+        array: catalog array in the saved order.
+        slots: saved layout, one entry per slot of the map.
+
+    Pre-conditions:
+        map, array and slots must not be NULL.
+
+    Post-conditions:
+        On success every course of the array is in its saved slot;
+        on failure the map is left empty.
+
+    Returns:
+        bool: false if the layout does not reference every course of the
+        array exactly once, repeats an id, or places a course where a
+        lookup of its id would not find it.
+*/
+bool import_hash_map_layout(hash_map_ptr map, array_ptr array, const uint16_t *slots);
+
 /*
     Frees all memory used by the hash map and optionally its course elements.
 
@@ -196,4 +196,23 @@ void ll_delete_list(linked_list_ptr linked_list, void (*delete_function)(void* e
 */
 void ll_print(linked_list_ptr linked_list, FILE* file, void (*print_function)(FILE* file, void* element));
 
+/*
+    Writes all elements in the list to an output buffer using the provided write function.
+
+    parameters:
+        linked_list: valid (non-NULL) pointer to the list.
+        out: output buffer in which the write function appends.
+        write_function: valid function pointer to write an element.
+
+    pre-condition:
+        All parameters must be valid and non-NULL.
+
+    post-condition:
+        The list remains unmodified; elements are appended to the buffer.
+
+    return:
+        None
+*/
+void ll_write(linked_list_ptr linked_list, out_buffer_ptr out, void (*write_function)(out_buffer_ptr out, void* element));
+
 #endif
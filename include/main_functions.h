@@ -8,29 +8,72 @@
 #include "course.h"
 #include "user.h"
 #include "utils.h"
+#include "catalog_snapshot.h"
+#include "csv.h"
+#include "booking_log.h"
+#include "seat_counters.h"
+#include "user_store.h"
+#include "user_paths.h"
+#include "record_reader.h"
+#include "background_save.h"
+#include "file_watch.h"
+#include "crc32c.h"
 #include <errno.h>
 #include <string.h>
 
 #define LINE_READ_BUFFER 1024
 #define MAX_INPUT_USER 128
 #define USERS_PATH "assets/users/"
+#define USER_FILE_SUFFIX ".txt"
+#define USER_STORE_PATH "assets/users.db"
+#define USER_INDEX_PATH "assets/users.idx"
 #define COURSE_PATH "assets/courses.txt"
+#define COURSE_SNAPSHOT_PATH "assets/courses.bin"
+#define SEAT_COUNTERS_PATH "assets/courses.seats"
 #define REPORT_PATH "assets/report/"
+#define BOOKING_LOG_SUFFIX ".log"
+#define LOAD_THREADS_ENV "MYFITNESS_LOAD_THREADS"
+#define MAX_LOAD_THREADS 64
+#define MIN_LOAD_CHUNK_BYTES 16384
+#define MIN_SAVE_CHUNK_COURSES 4096
+#define BACKUP_PATH "assets/backup/"
+#define BACKUP_USERS_PATH "assets/backup/users/"
+#define BACKUP_COURSE_PATH "assets/backup/courses.txt"
+#define BACKUP_SNAPSHOT_PATH "assets/backup/courses.bin"
+#define BACKUP_INTERVAL_ENV "MYFITNESS_BACKUP_INTERVAL_S"
+#define BACKUP_INTERVAL_S 300
+#define ADMIN_ENV "MYFITNESS_ADMIN"
 
 void action_print_all_courses(array_ptr array);
 void action_show_booked_courses(linked_list_ptr booked_list, user_ptr user);
-void action_show_history(linked_list_ptr history_list);
-void action_book_course(int course_id, linked_list_ptr booked_list, linked_list_ptr history_list, hash_map_ptr hash_map, user_ptr user);
-void action_cancel_course(linked_list_ptr booked_list, linked_list_ptr history_list);
+void action_show_history(linked_list_ptr history_list, user_ptr user);
+booking_log_ticket action_book_course(int course_id, linked_list_ptr booked_list, linked_list_ptr history_list, hash_map_ptr hash_map, user_ptr user);
+booking_log_ticket action_cancel_course(linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user);
 void action_check_subscription(user_ptr user);
 void action_show_last_report(user_ptr user);
-void action_exit_and_save(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user);
-char *login_user();
+bool action_background_backup(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user);
+void background_backup_tick(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user);
+void action_exit_and_save(user_store_ptr store, hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user);
+char *login_user(user_store_ptr store);
 void load_courses(const char *filepath, array_ptr *array, hash_map_ptr *hash_map);
+void load_courses_parallel(const char *filepath, array_ptr *array, hash_map_ptr *hash_map, unsigned int threads);
+void load_catalog(const char *snapshot_path, const char *text_path, array_ptr *array, hash_map_ptr *hash_map);
+void catalog_watch_open(const char *text_path);
+bool catalog_reload_tick(const char *text_path, hash_map_ptr map, array_ptr array);
+bool reload_courses(const char *filepath, hash_map_ptr map, array_ptr array);
+void catalog_watch_close(void);
+bool admin_add_course(hash_map_ptr map, array_ptr array, uint16_t id, const char *name, datetime_ptr datetime, uint16_t seats_total);
+bool admin_update_course(hash_map_ptr map, uint16_t id, const char *name, datetime_ptr datetime, uint16_t seats_total);
+bool admin_delete_course(hash_map_ptr map, array_ptr array, uint16_t id);
+void action_manage_courses(hash_map_ptr map, array_ptr array, user_ptr user);
 user_ptr load_user(const char *filepath, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map);
-void save_user(char* filepath, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user);
-void registration_user();
-void save_course(char* filepath, array_ptr array);
+user_ptr load_user_from_store(user_store_ptr store, const char *username, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map, uint32_t *stamp);
+void replay_booking_log(const char *filepath, uint32_t stamp, linked_list_ptr booked_list, linked_list_ptr history_list, hash_map_ptr hash_map, user_ptr user);
+bool save_user(char* filepath, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user);
+void save_user_to_store(user_store_ptr store, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user);
+void registration_user(user_store_ptr store);
+bool save_course(char* filepath, array_ptr array);
+bool save_courses_parallel(const char *filepath, array_ptr array, unsigned int threads);
 void report(char* filepath, user_ptr user, linked_list_ptr frequentation_linked_list);
 
 #endif 
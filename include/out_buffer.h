@@ -0,0 +1,211 @@
+#ifndef OUT_BUFFER_H
+#define OUT_BUFFER_H
+
+#include "datetime.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Output buffer used by all persistence code instead of stdio.
+    Values are appended as text without format strings; a buffer is
+    either bound to a file (flushed with write() when full) or kept in
+    memory (grown on demand, read back with out_buffer_data).
+    A file is written to "<path>.tmp" and renamed over <path> on close.
+    Write errors are reported and returned, never fatal, so the buffer
+    can be used from the child of a background save.
+*/
+typedef struct out_buffer *out_buffer_ptr;
+
+#define OUT_BUFFER_CAPACITY 65536
+
+/*
+    Binds a new buffer to a file. The text goes to a temporary file that
+    replaces the file only when the buffer is closed.
+
+    Parameters:
+        filepath: path of the file to write.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Post-conditions:
+        The temporary file is open for writing and empty.
+
+    Returns:
+        out_buffer_ptr: the buffer, or NULL if the file cannot be created.
+*/
+out_buffer_ptr out_buffer_open(const char *filepath);
+
+/*
+    Creates a memory-only buffer that grows as text is appended.
+
+    Parameters:
+        capacity: initial capacity in bytes.
+
+    Returns:
+        out_buffer_ptr: the new buffer.
+*/
+out_buffer_ptr out_buffer_create(size_t capacity);
+
+/*
+    Appends raw bytes.
+
+    Parameters:
+        out: destination buffer.
+        data: bytes to append.
+        length: number of bytes.
+
+    Pre-conditions:
+        out must not be NULL, data must hold length readable bytes.
+*/
+void out_append_bytes(out_buffer_ptr out, const void *data, size_t length);
+
+/*
+    Appends a null-terminated string (without the terminator).
+
+    Parameters:
+        out: destination buffer.
+        string: text to append.
+
+    Pre-conditions:
+        out and string must not be NULL.
+*/
+void out_append_string(out_buffer_ptr out, const char *string);
+
+/*
+    Appends a single character.
+
+    Parameters:
+        out: destination buffer.
+        c: character to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_char(out_buffer_ptr out, char c);
+
+/*
+    Appends an unsigned integer in decimal, as "%u" would.
+
+    Parameters:
+        out: destination buffer.
+        value: number to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_uint(out_buffer_ptr out, uint32_t value);
+
+/*
+    Appends a signed integer in decimal, as "%d" would.
+
+    Parameters:
+        out: destination buffer.
+        value: number to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_int(out_buffer_ptr out, int value);
+
+/*
+    Appends a datetime with the same text print_datetime writes.
+
+    Parameters:
+        out: destination buffer.
+        datetime: datetime to append.
+
+    Pre-conditions:
+        out and datetime must not be NULL.
+*/
+void out_append_datetime(out_buffer_ptr out, datetime_ptr datetime);
+
+/*
+    Returns the buffered bytes not yet flushed.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Returns:
+        const char*: start of the buffered text (not null-terminated).
+*/
+const char *out_buffer_data(out_buffer_ptr out);
+
+/*
+    Returns the number of buffered bytes not yet flushed.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Returns:
+        size_t: buffered length.
+*/
+size_t out_buffer_length(out_buffer_ptr out);
+
+/*
+    Writes the buffered bytes to the bound file and empties the buffer.
+    Does nothing for memory-only buffers.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Post-conditions:
+        The buffer is empty. If the write fails the error is reported,
+        the buffer is marked failed and out_buffer_close returns false.
+
+    Returns:
+        bool: false if the buffer has failed.
+*/
+bool out_flush(out_buffer_ptr out);
+
+/*
+    Writes the text buffered in a file buffer followed by the text of
+    memory buffers, in order, with as few writev calls as possible.
+
+    Parameters:
+        out: buffer bound to a file.
+        parts: memory buffers to append.
+        count: number of parts.
+
+    Pre-conditions:
+        out must be bound to a file; parts must hold count memory buffers.
+
+    Post-conditions:
+        The parts are written; they are left unchanged. If the write
+        fails the error is reported and the buffer is marked failed.
+
+    Returns:
+        bool: false if the buffer has failed.
+*/
+bool out_buffer_writev(out_buffer_ptr out, out_buffer_ptr *parts, int count);
+
+/*
+    Flushes the buffer and frees it. A file buffer is synced and its
+    temporary file atomically renamed over the target path.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Post-conditions:
+        The buffer is freed and must not be used anymore. If a write,
+        the sync or the rename failed, the target file is left as it was.
+
+    Returns:
+        bool: true if the file was replaced (always for memory buffers).
+*/
+bool out_buffer_close(out_buffer_ptr out);
+
+#endif
@@ -0,0 +1,116 @@
+#ifndef RECORD_READER_H
+#define RECORD_READER_H
+
+#include "utils.h"
+#include "csv.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+#define RECORD_READER_CHUNK 4096
+
+/*
+    Streaming reader of text records, from a file or from memory.
+
+    Whole lines are returned in a reusable growable buffer, as getline
+    does; fields are returned one at a time, so a line of any length is
+    read while only its longest field is held in memory.
+*/
+typedef struct record_reader *record_reader_ptr;
+
+/*
+    Opens a reader on a file.
+
+    Parameters:
+        filepath: path of the file.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Returns:
+        record_reader_ptr: the reader, or NULL if the file cannot be opened.
+*/
+record_reader_ptr record_reader_open(const char *filepath);
+
+/*
+    Creates a reader over text already in memory.
+
+    Parameters:
+        data: text to read.
+        length: number of bytes.
+
+    Pre-conditions:
+        data must stay valid and unchanged until the reader is closed.
+
+    Returns:
+        record_reader_ptr: the reader.
+*/
+record_reader_ptr record_reader_from_memory(const char *data, size_t length);
+
+/*
+    Reads the rest of the current line.
+
+    Parameters:
+        reader: the reader.
+        length: output, receives the line length, newline included (may be NULL).
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Post-conditions:
+        The reader is at the start of the next line.
+
+    Returns:
+        char*: the null-terminated line, valid until the next line read;
+        the caller may modify it. NULL at the end of the input.
+*/
+char *record_reader_line(record_reader_ptr reader, size_t *length);
+
+/*
+    Reads the next field of the current line.
+
+    Parameters:
+        reader: the reader.
+        delim: output, receives the delimiter that ended the field
+               (',', ';', '\n'), or '\0' at the end of the input.
+        delims: delimiter set ending the field (see csv.h).
+
+    Pre-conditions:
+        reader and delim must not be NULL.
+
+    Post-conditions:
+        The reader is past the field and its delimiter.
+
+    Returns:
+        str_view: the field (possibly empty), valid until the next read.
+*/
+str_view record_reader_field(record_reader_ptr reader, char *delim, csv_delims delims);
+
+/*
+    Tells whether the whole input has been read.
+
+    Parameters:
+        reader: the reader.
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Returns:
+        bool: true if no byte is left.
+*/
+bool record_reader_eof(record_reader_ptr reader);
+
+/*
+    Closes the reader and frees its buffers.
+
+    Parameters:
+        reader: the reader.
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Post-conditions:
+        The reader must not be used anymore.
+*/
+void record_reader_close(record_reader_ptr reader);
+
+#endif
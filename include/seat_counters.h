@@ -0,0 +1,174 @@
+#ifndef SEAT_COUNTERS_H
+#define SEAT_COUNTERS_H
+
+#include "array.h"
+#include "course.h"
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SEAT_COUNTERS_VERSION 2
+#define SEAT_COUNTERS_BLOCK 32
+
+/*
+    Sidecar file holding the seats_booked counter of every course as a
+    fixed-width uint16, in blocks of SEAT_COUNTERS_BLOCK course IDs each
+    followed by its CRC32C, so a booking is persisted with one pwrite of
+    its block instead of rewriting the text catalog. A block failing its
+    checksum is reported on open and its courses keep the catalog values.
+
+    The header stamps the size and modification time of the text catalog
+    the counters belong to: while the stamp matches, the counters override
+    the seats_booked values of the text file (and of its snapshot); when
+    the text catalog is edited the sidecar is rebuilt from it. A catalog
+    the session writes or reloads itself is stamped with
+    seat_counters_restamp instead, keeping the counters persisted.
+
+    Courses whose counter changed are tracked as dirty and only those are
+    written by seat_counters_flush.
+
+    A flush is journaled: the changed blocks are written after the table
+    and synced before they are written in place, so a flush interrupted
+    by a crash is finished on the next open, or never happened at all.
+    Each flush has a generation, handed out by seat_counters_reserve and
+    persisted first so that it is never handed out twice; the header
+    records the last generation completed and the ones lost before their
+    journal was whole. The session logs the generation (BOOKING_LOG_SEATS)
+    before flushing, and replay skips the seat changes logged before a
+    marker whose flush completed. A rebuild keeps these generations.
+*/
+
+/*
+    Opens the sidecar of a catalog and applies its counters, or rebuilds
+    it from the loaded catalog if it is missing or stale.
+
+    Parameters:
+        filepath: path of the sidecar file.
+        catalog_path: path of the text catalog it belongs to.
+        array: loaded catalog.
+
+    Pre-conditions:
+        No sidecar is open; array must not be NULL.
+
+    Post-conditions:
+        On success seats_booked of every course holds the persisted value.
+
+    Returns:
+        bool: true if the sidecar is open, false if it cannot be used
+        (the catalog must then be saved in full).
+*/
+bool seat_counters_open(const char *filepath, const char *catalog_path, array_ptr array);
+
+/*
+    Tells whether a sidecar is open.
+
+    Returns:
+        bool: true after a successful seat_counters_open.
+*/
+bool seat_counters_is_open(void);
+
+/*
+    Records that the seats_booked counter of a course changed.
+
+    Parameters:
+        course: the changed course.
+
+    Pre-conditions:
+        course must not be NULL and must stay alive until the next flush.
+
+    Post-conditions:
+        The course is in the dirty set once, however many times it is
+        marked; nothing happens if no sidecar is open. A course past the
+        end of the sidecar grows it, under the same catalog stamp.
+        Exits the program if the sidecar cannot be grown.
+*/
+void seat_counters_mark(course_ptr course);
+
+/*
+    Drops a course from the dirty set, before the course is freed.
+
+    Parameters:
+        course: the course.
+
+    Pre-conditions:
+        course must not be NULL.
+
+    Post-conditions:
+        The dirty set no longer refers to the course.
+*/
+void seat_counters_forget(course_ptr course);
+
+/*
+    Hands out the generation the next seat_counters_flush writes. The
+    generation is persisted before it is returned, so it
+    is never handed out again, even after a crash.
+
+    Post-conditions:
+        Calling it again before the flush returns the same generation.
+        Exits the program on a write error.
+
+    Returns:
+        uint32_t: the generation, 0 if no sidecar is open or no course
+        is dirty (the flush then writes nothing).
+*/
+uint32_t seat_counters_reserve(void);
+
+/*
+    Writes the counter of every dirty course and syncs the file. The
+    changed blocks go to a journal first, so the flush lands whole or
+    not at all; its generation is reserved first if seat_counters_reserve
+    was not called.
+
+    Post-conditions:
+        The dirty set is empty. Exits the program on a write error.
+
+    Returns:
+        uint32_t: number of counters written.
+*/
+uint32_t seat_counters_flush(void);
+
+/*
+    Tells whether the flush of a generation reached the sidecar.
+
+    Parameters:
+        generation: generation handed out by seat_counters_reserve.
+
+    Returns:
+        bool: true if every counter of that flush is on disk, false if
+        the flush was interrupted before its journal was complete, or no
+        sidecar is open.
+*/
+bool seat_counters_flushed(uint32_t generation);
+
+/*
+    Stamps the open sidecar with a new text catalog, after the catalog
+    was written or reloaded. Each course gets the counter persisted for
+    it: its current value, or for a dirty course the value on disk, since
+    its changes are still to be flushed; courses no longer in the catalog
+    lose theirs. The file is replaced atomically.
+
+    Parameters:
+        catalog_path: path of the text catalog.
+        array: catalog.
+
+    Pre-conditions:
+        A sidecar is open; array must not be NULL.
+
+    Post-conditions:
+        The dirty set and the generations are kept.
+
+    Returns:
+        bool: false if the sidecar cannot be written; it is then left
+        stamped with the old catalog.
+*/
+bool seat_counters_restamp(const char *catalog_path, array_ptr array);
+
+/*
+    Closes the sidecar, dropping the dirty set and the journal of the
+    last flush.
+
+    Post-conditions:
+        No sidecar is open.
+*/
+void seat_counters_close(void);
+
+#endif
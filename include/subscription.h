@@ -4,6 +4,15 @@
 #include "datetime.h"
 #include <stdint.h>
 
+/*
+    The dates are stored by value and the layout is public, so a
+    subscription can be embedded directly inside a user record.
+*/
+struct subscription {
+    struct datetime start_date;
+    struct datetime end_date;
+};
+
 typedef struct subscription *subscription_ptr;
 
 /*
@@ -15,7 +24,7 @@ typedef struct subscription *subscription_ptr;
 
     Pre-conditions:
         start_date and end_date must be non-NULL.
-        The datetime values must be valid and managed externally.
+        The datetime values are copied; the caller keeps ownership of the arguments.
 
     Post-conditions:
         A new subscription object is allocated and initialized.
@@ -28,6 +37,26 @@ subscription_ptr create_subscription(
     datetime_ptr end_date
 );
 
+/*
+    Initializes an existing subscription with copies of the given dates.
+
+    Parameters:
+        subscription: pointer to the subscription to fill.
+        start_date: pointer to the start datetime.
+        end_date: pointer to the end datetime.
+
+    Pre-conditions:
+        All parameters must be non-NULL.
+
+    Post-conditions:
+        subscription holds copies of start_date and end_date.
+*/
+void init_subscription(
+    subscription_ptr subscription,
+    datetime_ptr start_date,
+    datetime_ptr end_date
+);
+
 /*
     Retrieves the start date of the subscription.
 
@@ -73,7 +102,7 @@ datetime_ptr get_subscription_end_date(subscription_ptr subscription);
         Both pointers must not be NULL.
 
     Post-conditions:
-        The subscription's start date is updated.
+        The subscription's start date is updated with a copy of start_date.
 */
 void set_subscription_start_date(subscription_ptr subscription, datetime_ptr start_date);
 
@@ -88,7 +117,7 @@ void set_subscription_start_date(subscription_ptr subscription, datetime_ptr sta
         Both pointers must not be NULL.
 
     Post-conditions:
-        The subscription's end date is updated.
+        The subscription's end date is updated with a copy of end_date.
 */
 void set_subscription_end_date(subscription_ptr subscription, datetime_ptr end_date);
 
@@ -104,7 +133,7 @@ void set_subscription_end_date(subscription_ptr subscription, datetime_ptr end_d
         All pointers must not be NULL.
 
     Post-conditions:
-        Both start and end dates are updated in the subscription.
+        Both start and end dates are copied into the subscription.
 */
 void set_subscription_renew(subscription_ptr subscription, datetime_ptr start_date, datetime_ptr end_date);
 
@@ -123,7 +152,7 @@ void set_subscription_renew(subscription_ptr subscription, datetime_ptr start_da
 void print_subscription(subscription_ptr subscription);
 
 /*
-    Deletes a subscription and frees its memory (including datetime fields).
+    Deletes a subscription and frees its memory (the dates are stored inline).
 
     Parameters:
         subscription: pointer to the subscription to delete.
@@ -26,7 +26,8 @@ typedef struct user *user_ptr;
         subscription must not be NULL.
 
     Post-conditions:
-        A new user object is allocated and initialized.
+        A new user object is allocated in a single block holding copies of
+        the strings, the subscription and the last report date.
 
     Returns:
         user_ptr: pointer to the newly created user.
@@ -168,10 +169,41 @@ datetime_ptr get_user_last_report_date(user_ptr user);
         Both user and last_report must not be NULL.
 
     Post-conditions:
-        The previous datetime is freed and replaced by the new one.
+        The stored date is overwritten with a copy of last_report.
 */
 void set_user_last_report_date(user_ptr user, datetime_ptr last_report);
 
+/*
+    Keeps the serialized history of the user until it is first needed.
+
+    Parameters:
+        user: pointer to a valid user object.
+        text: history line, or NULL once the history list is built.
+        length: length of text.
+
+    Pre-conditions:
+        user must not be NULL; text must live as long as the user.
+
+    Post-conditions:
+        The user refers to text, which is not copied.
+*/
+void set_user_history_text(user_ptr user, char* text, size_t length);
+
+/*
+    Returns the serialized history not parsed yet.
+
+    Parameters:
+        user: pointer to a valid user object.
+        length: output, receives the length of the text (may be NULL).
+
+    Pre-conditions:
+        user must not be NULL.
+
+    Returns:
+        char*: the history line, or NULL if there is none pending.
+*/
+char* get_user_history_text(user_ptr user, size_t* length);
+
 /*
     Prints user information to standard output.
 
@@ -0,0 +1,72 @@
+#ifndef USER_PATHS_H
+#define USER_PATHS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Per-user files are not kept in one flat directory: they are spread
+    over a two-level fan-out of subdirectories named after the bytes of
+    the username hash, e.g. assets/users/3f/a2/mrossi.log, so no directory
+    holds more than a few entries even with millions of users.
+*/
+
+/* Subdirectories per level (two hex digits) */
+#define USER_SHARD_FANOUT 256
+
+/*
+    Builds the path of a per-user file inside its shard directory.
+
+    Parameters:
+        buffer: destination of the path.
+        size: size of buffer.
+        users_path: root of the user tree, ending with '/'.
+        username: owner of the file.
+        suffix: file name suffix, e.g. ".txt".
+
+    Pre-conditions:
+        All pointers must not be NULL.
+
+    Returns:
+        bool: false if the path does not fit in buffer.
+*/
+bool user_file_path(char *buffer, size_t size, const char *users_path, const char *username, const char *suffix);
+
+/*
+    Creates the shard directories of a user if they do not exist.
+
+    Parameters:
+        users_path: root of the user tree, ending with '/'.
+        username: owner of the directories.
+
+    Pre-conditions:
+        users_path must exist.
+
+    Returns:
+        bool: false if a directory cannot be created.
+*/
+bool user_file_dirs(const char *users_path, const char *username);
+
+/*
+    Moves the per-user files left directly in the root of the user tree
+    into their shard directories. A file belongs to a user if its name is
+    the username followed by one of the suffixes.
+
+    Parameters:
+        users_path: root of the user tree, ending with '/'.
+        suffixes: recognised file name suffixes.
+        count: number of suffixes.
+
+    Pre-conditions:
+        No other process uses the files being moved.
+
+    Post-conditions:
+        Files that cannot be moved are reported on stderr and left in place.
+
+    Returns:
+        uint32_t: number of files moved.
+*/
+uint32_t migrate_user_files(const char *users_path, const char *const *suffixes, int count);
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef USER_STORE_H
+#define USER_STORE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define USER_STORE_VERSION 1
+#define USER_INDEX_VERSION 1
+#define USER_STORE_PAGE_SIZE 256
+#define USER_STORE_INITIAL_INDEX 1024
+
+/*
+    Store of all the user records in one data file plus a hash index.
+
+    The data file is divided into USER_STORE_PAGE_SIZE pages; a record
+    (key, value and a small header) spans a run of consecutive pages.
+    The index file is an open-addressing hash table keyed by username,
+    whose entries point to the first page and page count of a record.
+
+    Records are never overwritten in place: a put writes the new record
+    to free pages, syncs it, then repoints the index entry, so a crash
+    leaves either the old or the new record. Pages not referenced by the
+    index are free and reused by later puts.
+
+    Every record carries the CRC32C of its header, key and value, checked
+    whenever the record is read, so a damaged record is reported as such
+    before any of it is parsed.
+*/
+typedef struct user_store *user_store_ptr;
+
+/*
+    Opens a store, creating its files if they do not exist.
+
+    Parameters:
+        data_path: path of the data file.
+        index_path: path of the index file.
+
+    Pre-conditions:
+        Both paths must be valid strings.
+
+    Returns:
+        user_store_ptr: the store; exits the program if the files cannot
+        be created or are not a store.
+*/
+user_store_ptr user_store_open(const char *data_path, const char *index_path);
+
+/*
+    Reads the record of a user.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+        length: output, receives the value length (may be NULL).
+
+    Pre-conditions:
+        store and username must not be NULL.
+
+    Returns:
+        char*: a null-terminated copy of the value, to be released with
+        mem_free, or NULL if the user is not in the store. Exits the
+        program if the record fails its checksum.
+*/
+char *user_store_get(user_store_ptr store, const char *username, size_t *length);
+
+/*
+    Tells whether a user is in the store, without reading the value.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+
+    Pre-conditions:
+        store and username must not be NULL.
+
+    Returns:
+        bool: true if the user has a record.
+*/
+bool user_store_contains(user_store_ptr store, const char *username);
+
+/*
+    Inserts or replaces the record of a user.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+        value: record value.
+        length: value length in bytes.
+
+    Pre-conditions:
+        store, username and value must not be NULL.
+
+    Post-conditions:
+        The record is durable when the function returns.
+        Exits the program on a write error.
+*/
+void user_store_put(user_store_ptr store, const char *username, const char *value, size_t length);
+
+/*
+    Calls visit on every record of the store, in index order.
+
+    Parameters:
+        store: the store.
+        visit: function receiving username, value, value length and context.
+        context: passed through to visit.
+
+    Pre-conditions:
+        store and visit must not be NULL; visit must not modify the store.
+*/
+void user_store_scan(user_store_ptr store,
+                     void (*visit)(const char *username, const char *value, size_t length, void *context),
+                     void *context);
+
+/*
+    Returns the number of records in the store.
+
+    Parameters:
+        store: the store.
+
+    Pre-conditions:
+        store must not be NULL.
+
+    Returns:
+        uint32_t: record count.
+*/
+uint32_t user_store_count(user_store_ptr store);
+
+/*
+    Closes the store and frees it.
+
+    Parameters:
+        store: the store.
+
+    Pre-conditions:
+        store must not be NULL.
+
+    Post-conditions:
+        The store must not be used anymore.
+*/
+void user_store_close(user_store_ptr store);
+
+#endif
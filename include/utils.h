@@ -3,6 +3,21 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "allocator.h"
+
+typedef struct arena *arena_ptr;
+
+/*
+    A length-delimited, non-owning view of characters (for example a
+    field inside a memory-mapped file). It is not null-terminated.
+*/
+typedef struct {
+    const char *data;
+    size_t length;
+} str_view;
 
 /*
     Macro to check if a pointer is NULL.
@@ -76,4 +91,159 @@ char *str_sep(char **stringp, const char *delim);
 */
 void ptr_swap(void **pp1, void **pp2);
 
+/*
+    Returns the shared copy of a string, storing it on first use.
+    Two interned strings are equal if and only if their pointers are equal.
+
+    Parameters:
+        s: Pointer to a null-terminated string.
+
+    Pre-condition:
+        s must not be NULL.
+
+    Post-condition:
+        The intern table contains a copy of s.
+
+    Returns:
+        Pointer to the interned string; it must not be modified or freed.
+*/
+char *str_intern(const char *s);
+
+/*
+    Interns a string given by pointer and length; the characters do not
+    need to be null-terminated.
+
+    Parameters:
+        s: Pointer to the first character.
+        len: Number of characters.
+
+    Pre-condition:
+        s must point to at least len readable bytes.
+
+    Returns:
+        Pointer to the null-terminated interned string.
+*/
+char *str_intern_n(const char *s, size_t len);
+
+/*
+    Computes the FNV-1a hash of the first len bytes of a string.
+
+    Parameters:
+        s: Pointer to the characters to hash.
+        len: Number of characters.
+
+    Pre-condition:
+        s must point to at least len readable bytes.
+
+    Returns:
+        uint32_t: the hash value of s.
+*/
+uint32_t str_hash(const char *s, size_t len);
+
+/*
+    Releases every interned string.
+
+    Pre-condition:
+        No interned pointer is used after the call.
+
+    Post-condition:
+        The intern table is empty.
+*/
+void str_intern_clear(void);
+
+/*
+    Creates an empty region allocator.
+
+    Returns:
+        Pointer to the new arena.
+*/
+arena_ptr arena_create(void);
+
+/*
+    Allocates memory from an arena. It is never freed individually.
+
+    Parameters:
+        arena: Pointer to the arena.
+        size: Number of bytes requested.
+
+    Pre-condition:
+        arena must not be NULL.
+
+    Returns:
+        Pointer to suitably aligned memory, valid until arena_delete.
+*/
+void *arena_alloc(arena_ptr arena, size_t size);
+
+/*
+    Frees an arena and everything allocated from it.
+
+    Parameters:
+        arena: Pointer to the arena.
+
+    Post-condition:
+        All memory handed out by the arena is invalid.
+*/
+void arena_delete(arena_ptr arena);
+
+/*
+    Opens the arena holding all user-scoped objects of a login session
+    (user, booked and history lists, their nodes, frequentations and
+    history texts).
+
+    Pre-condition:
+        No session is open.
+*/
+void session_open(void);
+
+/*
+    Releases every session-scoped allocation at once.
+
+    Post-condition:
+        No session is open.
+*/
+void session_close(void);
+
+/*
+    Allocates a session-scoped object; falls back to mem_alloc when no
+    session is open.
+
+    Parameters:
+        tag: Subsystem the object belongs to, for memory accounting.
+        size: Number of bytes requested.
+
+    Returns:
+        Pointer to the allocated memory.
+*/
+void *session_alloc(mem_tag tag, size_t size);
+
+/*
+    Frees memory obtained from session_alloc. Memory owned by the open
+    session is released later by session_close.
+
+    Parameters:
+        ptr: Pointer to free (may be NULL).
+*/
+void session_free(void *ptr);
+
+/*
+    Maps a file read-only in memory.
+
+    Parameters:
+        filepath: Path of the file.
+        size: Output, receives the size of the mapping.
+
+    Returns:
+        Start of the mapping, or NULL on failure or if the file is empty.
+*/
+const char *map_file(const char *filepath, size_t *size);
+
+/*
+    Unmaps a file mapped with map_file.
+
+    Parameters:
+        base: Start of the mapping.
+        size: Size of the mapping.
+*/
+void unmap_file(const char *base, size_t size);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,250 @@
+#include "allocator.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+    Every block carries a small header in front of the user memory so
+    that mem_free knows its size and tag. The union keeps the user
+    memory aligned like malloc would.
+*/
+typedef union {
+    struct {
+        size_t size;
+        mem_tag tag;
+    } info;
+    long double align;
+} mem_header;
+
+static mem_stats stats[MEM_TAG_COUNT];
+
+static const char *tag_names[MEM_TAG_COUNT] = {
+    "string",
+    "course",
+    "datetime",
+    "subscription",
+    "user",
+    "frequentation",
+    "linked_list",
+    "array",
+    "hash_map",
+    "session",
+    "io"
+};
+
+/*
+    Updates the counters of a tag after an allocation.
+    Counters are updated atomically so worker threads can allocate.
+
+    Parameters:
+        tag: tag of the allocation.
+        size: number of bytes allocated.
+
+    Returns:
+        None.
+*/
+static void account_alloc(mem_tag tag, size_t size) {
+    __atomic_add_fetch(&stats[tag].allocations, 1, __ATOMIC_RELAXED);
+    size_t live = __atomic_add_fetch(&stats[tag].live_bytes, size, __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&stats[tag].peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak &&
+           !__atomic_compare_exchange_n(&stats[tag].peak_bytes, &peak, live,
+                                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+/*
+    Updates the counters of a tag after a free.
+
+    Parameters:
+        tag: tag of the allocation.
+        size: number of bytes released.
+
+    Returns:
+        None.
+*/
+static void account_free(mem_tag tag, size_t size) {
+    __atomic_add_fetch(&stats[tag].frees, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&stats[tag].live_bytes, size, __ATOMIC_RELAXED);
+}
+
+/*
+    Allocates size bytes plus a header recording size and tag.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        size: number of bytes requested.
+
+    Pre-conditions:
+        tag < MEM_TAG_COUNT.
+
+    Post-conditions:
+        The counters of tag are updated.
+
+    Returns:
+        void*: pointer to the memory after the header.
+*/
+void *mem_alloc(mem_tag tag, size_t size) {
+    mem_header *header = malloc(sizeof(mem_header) + size);
+    CHECK_NULL(header);
+    header->info.size = size;
+    header->info.tag = tag;
+    account_alloc(tag, size);
+    return header + 1;
+}
+
+/*
+    Allocates zeroed memory for count elements of size bytes.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        count: number of elements.
+        size: size of each element.
+
+    Pre-conditions:
+        tag < MEM_TAG_COUNT.
+
+    Post-conditions:
+        The counters of tag are updated.
+
+    Returns:
+        void*: pointer to zero-initialized memory.
+*/
+void *mem_calloc(mem_tag tag, size_t count, size_t size) {
+    mem_header *header = calloc(1, sizeof(mem_header) + count * size);
+    CHECK_NULL(header);
+    header->info.size = count * size;
+    header->info.tag = tag;
+    account_alloc(tag, count * size);
+    return header + 1;
+}
+
+/*
+    Resizes a tagged block, moving its accounting to the new size.
+
+    Parameters:
+        ptr: block to resize, or NULL to allocate a new one.
+        tag: subsystem the memory belongs to.
+        size: new size in bytes.
+
+    Pre-conditions:
+        ptr is NULL or was returned by this module.
+
+    Post-conditions:
+        The counters reflect the new size.
+
+    Returns:
+        void*: pointer to the resized memory.
+*/
+void *mem_realloc(void *ptr, mem_tag tag, size_t size) {
+    if (!ptr) return mem_alloc(tag, size);
+
+    mem_header *header = (mem_header *)ptr - 1;
+    account_free(header->info.tag, header->info.size);
+
+    header = realloc(header, sizeof(mem_header) + size);
+    CHECK_NULL(header);
+    header->info.size = size;
+    header->info.tag = tag;
+    account_alloc(tag, size);
+    return header + 1;
+}
+
+/*
+    Frees a tagged block and updates the counters of its tag.
+
+    Parameters:
+        ptr: block to free (may be NULL).
+
+    Pre-conditions:
+        ptr is NULL or was returned by this module.
+
+    Post-conditions:
+        The memory is released.
+
+    Returns:
+        None.
+*/
+void mem_free(void *ptr) {
+    if (!ptr) return;
+    mem_header *header = (mem_header *)ptr - 1;
+    account_free(header->info.tag, header->info.size);
+    free(header);
+}
+
+/*
+    Records bytes served from a session arena for a tag. The arena blocks
+    themselves are accounted under MEM_TAG_SESSION.
+
+    Parameters:
+        tag: subsystem the memory belongs to.
+        size: number of bytes served.
+
+    Returns:
+        None.
+*/
+void mem_note_arena(mem_tag tag, size_t size) {
+    __atomic_add_fetch(&stats[tag].allocations, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&stats[tag].arena_bytes, size, __ATOMIC_RELAXED);
+}
+
+/*
+    Returns the counters of a tag.
+
+    Parameters:
+        tag: tag to query.
+
+    Pre-conditions:
+        tag < MEM_TAG_COUNT.
+
+    Returns:
+        mem_stats: copy of the counters.
+*/
+mem_stats mem_get_stats(mem_tag tag) {
+    return stats[tag];
+}
+
+/*
+    Prints allocation counts, live, peak and arena bytes for every tag.
+
+    Parameters:
+        file: output file.
+
+    Pre-conditions:
+        file must be valid.
+
+    Returns:
+        None.
+*/
+void mem_print_stats(FILE *file) {
+    CHECK_NULL(file);
+    fprintf(file, "%-14s %10s %10s %12s %12s %12s\n",
+            "tag", "allocs", "frees", "live", "peak", "arena");
+    for (int i = 0; i < MEM_TAG_COUNT; i++) {
+        fprintf(file, "%-14s %10zu %10zu %12zu %12zu %12zu\n",
+                tag_names[i],
+                stats[i].allocations,
+                stats[i].frees,
+                stats[i].live_bytes,
+                stats[i].peak_bytes,
+                stats[i].arena_bytes);
+    }
+}
+
+/*
+    Exit handler printing the counters to stderr.
+*/
+static void dump_stats(void) {
+    mem_print_stats(stderr);
+}
+
+/*
+    Registers dump_stats to run at program exit.
+
+    Returns:
+        None.
+*/
+void mem_dump_stats_at_exit(void) {
+    atexit(dump_stats);
+}
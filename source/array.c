@@ -6,19 +6,21 @@
 
 struct array {
     void** elements;
+    // capacity of elements, and number of elements stored
     uint16_t size;
     uint16_t last_element;
 };
 
 /*
     Allocates memory for a new array structure and initializes its fields.
-    The elements buffer is also allocated to hold pointers up to the given size.
+    The elements buffer is also allocated to hold pointers up to the given size
+    before it has to grow.
 
     parameters:
         size: the intended capacity of the array (uint16_t).
 
     pre-condition:
-        size must be greater than zero.
+        None; a size of zero is raised to one.
 
     post-condition:
         A new array structure is created with the given size, and
@@ -29,10 +31,10 @@ struct array {
         or exit if memory allocation fails.
 */
 array_ptr array_create(uint16_t size) {
-    struct array* new_array = malloc(sizeof(struct array));
-    CHECK_NULL(new_array);
+    struct array* new_array = mem_alloc(MEM_TAG_ARRAY, sizeof(struct array));
 
-    new_array->elements = malloc(sizeof(void*) * size);
+    if (size == 0) size = 1;
+    new_array->elements = mem_alloc(MEM_TAG_ARRAY, sizeof(void*) * size);
     new_array->size = size;
     new_array->last_element = 0;
 
@@ -42,6 +44,7 @@ array_ptr array_create(uint16_t size) {
 /*
     Adds a new element to the array by inserting its pointer at the next
     available position (last_element). It then increments last_element.
+    A full array doubles its capacity first.
 
     parameters:
         array:   pointer to the array (must be valid)
@@ -50,26 +53,29 @@ array_ptr array_create(uint16_t size) {
     pre-condition:
         array must be valid
         element must be valid
-        array->last_element < array->size
 
     post-condition:
         - elements[old last_element] == element
         - last_element is incremented by 1
 
     return:
-        None; exits the program if capacity would be exceeded.
+        None; exits the program if the array already holds UINT16_MAX elements.
 */
 void array_add(array_ptr array, void* element){
-    if (array->last_element > array->size) {
-        perror("Array size surpassed");
-        exit(1);
+    if (array->last_element == array->size) {
+        if (array->size == UINT16_MAX) {
+            fprintf(stderr, "Array size surpassed\n");
+            exit(1);
+        }
+        array->size = array->size > UINT16_MAX / 2 ? UINT16_MAX : (uint16_t)(array->size * 2);
+        array->elements = mem_realloc(array->elements, MEM_TAG_ARRAY, sizeof(void*) * array->size);
     }
     array->elements[array->last_element] = element;
     array->last_element++;
 }
 
 /*
-    Returns the total capacity (size) of the array.
+    Returns the number of elements stored in the array.
 
     parameters:
         array: pointer to the array (must be valid)
@@ -81,10 +87,10 @@ void array_add(array_ptr array, void* element){
         No changes to the array
 
     return:
-        The capacity of the array
+        The number of elements added so far
 */
 uint16_t get_size(array_ptr array){
-    return array->size;
+    return array->last_element;
 }
 
 /*
@@ -96,7 +102,7 @@ uint16_t get_size(array_ptr array){
 
     pre-condition:
         array must be valid
-        index < array->size
+        index < get_size(array)
 
     post-condition:
         No changes to the array
@@ -105,7 +111,7 @@ uint16_t get_size(array_ptr array){
         Pointer to the element at the given index, or NULL if out of bounds
 */
 void** get_at(array_ptr array, uint16_t index) {
-    if (index >= array->size) return NULL;
+    if (index >= array->last_element) return NULL;
     return &array->elements[index];
 }
 
@@ -119,7 +125,7 @@ void** get_at(array_ptr array, uint16_t index) {
 
     pre-condition:
         array must be valid
-        index < array->size
+        index < get_size(array)
 
     post-condition:
         The element at the specified index is replaced
@@ -128,10 +134,62 @@ void** get_at(array_ptr array, uint16_t index) {
         None
 */
 void set_at(array_ptr array, uint16_t index, void* element) {
-    if (index >= array->size) return;
+    if (index >= array->last_element) return;
     array->elements[index] = element;
 }
 
+/*
+    Drops the elements from a given position to the end of the array.
+    The dropped elements are not freed.
+
+    parameters:
+        array: pointer to the array (must be valid)
+        size:  number of elements to keep
+
+    pre-condition:
+        array must be valid
+        size <= get_size(array)
+
+    post-condition:
+        get_size(array) == size
+
+    return:
+        None
+*/
+void array_truncate(array_ptr array, uint16_t size) {
+    CHECK_NULL(array);
+    if (size < array->last_element) array->last_element = size;
+}
+
+/*
+    Removes the element at the specified index in constant time by moving
+    the last element into its place. The order of the elements is not
+    kept and the removed element is not freed.
+
+    parameters:
+        array: pointer to the array (must be valid)
+        index: zero-based index to remove
+
+    pre-condition:
+        array must be valid
+        index < get_size(array)
+
+    post-condition:
+        get_size(array) is one less; the former last element is at index
+        unless index was the last position
+
+    return:
+        void*: the removed element, or NULL if index is out of range
+*/
+void* array_swap_remove(array_ptr array, uint16_t index) {
+    CHECK_NULL(array);
+    if (index >= array->last_element) return NULL;
+
+    void* removed = array->elements[index];
+    array->elements[index] = array->elements[--array->last_element];
+    return removed;
+}
+
 /*
     Iterates over the array and calls a user-provided print function on each element.
 
@@ -155,7 +213,7 @@ void set_at(array_ptr array, uint16_t index, void* element) {
 void array_print(array_ptr array,  FILE* file, void (*print_function)(FILE* file, void* element)) {
     CHECK_NULL(array);
     CHECK_NULL(print_function);
-    for (int i = 0; i < array->size; i++) {
+    for (int i = 0; i < array->last_element; i++) {
         print_function(file, array->elements[i]);
     }
 }
@@ -180,15 +238,15 @@ void array_print(array_ptr array,  FILE* file, void (*print_function)(FILE* file
 */
 void array_delete(array_ptr array, void (*delete_function)(void* element)) {
     if (!delete_function) {
-        free(array->elements);
-        free(array);
+        mem_free(array->elements);
+        mem_free(array);
         return;
     }
 
-    for(int i = 0; i < array->size; i++) {
+    for(int i = 0; i < array->last_element; i++) {
         delete_function(array->elements[i]);
     }
 
-    free(array->elements);
-    free(array);
+    mem_free(array->elements);
+    mem_free(array);
 }
\ No newline at end of file
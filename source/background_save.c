@@ -0,0 +1,193 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "background_save.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define SMAPS_ROLLUP_PATH "/proc/self/smaps_rollup"
+
+/* Child of the running save, -1 when none runs, and the read end of its pipe */
+static pid_t child_pid = -1;
+static int child_pipe = -1;
+
+/*
+    Returns the number of pages of the calling process no longer shared
+    with its parent, from the Private_Dirty line of smaps_rollup.
+
+    Returns:
+        uint64_t: page count, 0 if the kernel does not report it.
+*/
+static uint64_t private_dirty_pages(void) {
+    FILE *file = fopen(SMAPS_ROLLUP_PATH, "r");
+    if (!file) return 0;
+
+    char line[256];
+    unsigned long long kib = 0;
+    while (fgets(line, sizeof(line), file)) {
+        if (sscanf(line, "Private_Dirty: %llu kB", &kib) == 1) break;
+    }
+    fclose(file);
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    return page_size > 0 ? (uint64_t)kib * 1024 / (uint64_t)page_size : 0;
+}
+
+/*
+    Body of the child: runs the save, measures it and sends the outcome
+    to the parent. Never returns.
+
+    Parameters:
+        save: the save function, false if it failed.
+        context: passed through to save.
+        fd: write end of the pipe to the parent.
+*/
+static void run_child(bool (*save)(void *context), void *context, int fd) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool saved = save(context);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    background_save_stats stats;
+    stats.success = saved;
+    stats.duration_ms = (double)(end.tv_sec - start.tv_sec) * 1000.0
+                      + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+    stats.cow_pages = private_dirty_pages();
+
+    bool sent = write(fd, &stats, sizeof(stats)) == (ssize_t)sizeof(stats);
+    // skip the atexit handlers and stdio buffers inherited from the parent
+    _exit(sent ? 0 : 1);
+}
+
+/*
+    Forks a child that calls save and exits; the parent returns at once.
+
+    Parameters:
+        save: writes the snapshot from the child's copy of the memory and
+              returns false if it failed.
+        context: passed through to save.
+
+    Pre-conditions:
+        save must not be NULL; it must only write files, since nothing
+        it changes in memory is seen by the parent. It reports failures
+        through its return value rather than exiting the child.
+
+    Post-conditions:
+        A save is in progress on success.
+
+    Returns:
+        bool: false if a save is already running or the fork failed.
+*/
+bool background_save_start(bool (*save)(void *context), void *context) {
+    CHECK_NULL(save);
+    if (child_pid >= 0) return false;
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        fprintf(stderr, "Background save: cannot create pipe: %s\n", strerror(errno));
+        return false;
+    }
+
+    // nothing buffered may be written twice, once by each process
+    fflush(stdout);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        fprintf(stderr, "Background save: cannot fork: %s\n", strerror(errno));
+        close(fds[0]);
+        close(fds[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        run_child(save, context, fds[1]);
+    }
+
+    close(fds[1]);
+    child_pid = pid;
+    child_pipe = fds[0];
+    return true;
+}
+
+/*
+    Tells whether a background save is running.
+
+    Returns:
+        bool: true between a successful start and the poll or wait that
+        collects the child.
+*/
+bool background_save_in_progress(void) {
+    return child_pid >= 0;
+}
+
+/*
+    Reaps the child and reads its outcome.
+
+    Parameters:
+        stats: output, receives the outcome of the save.
+        options: waitpid options, WNOHANG to return if it still runs.
+
+    Returns:
+        bool: true if the child was reaped and stats was filled.
+*/
+static bool collect_child(background_save_stats *stats, int options) {
+    CHECK_NULL(stats);
+    if (child_pid < 0) return false;
+
+    int status;
+    pid_t reaped;
+    do {
+        reaped = waitpid(child_pid, &status, options);
+    } while (reaped < 0 && errno == EINTR);
+    if (reaped == 0) return false;
+
+    memset(stats, 0, sizeof(*stats));
+    bool exited = reaped == child_pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    if (!exited || read(child_pipe, stats, sizeof(*stats)) != (ssize_t)sizeof(*stats)) {
+        memset(stats, 0, sizeof(*stats));
+    }
+
+    close(child_pipe);
+    child_pipe = -1;
+    child_pid = -1;
+    return true;
+}
+
+/*
+    Collects a finished background save without blocking.
+
+    Parameters:
+        stats: output, receives the outcome of the save.
+
+    Pre-conditions:
+        stats must not be NULL.
+
+    Returns:
+        bool: true if a save finished and stats was filled.
+*/
+bool background_save_poll(background_save_stats *stats) {
+    return collect_child(stats, WNOHANG);
+}
+
+/*
+    Waits for the running background save to finish.
+
+    Parameters:
+        stats: output, receives the outcome of the save.
+
+    Pre-conditions:
+        stats must not be NULL.
+
+    Returns:
+        bool: true if a save was running and stats was filled.
+*/
+bool background_save_wait(background_save_stats *stats) {
+    return collect_child(stats, 0);
+}
@@ -0,0 +1,727 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "booking_log.h"
+#include "crc32c.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define BOOKING_LOG_MAGIC "MFBL"
+
+/* Tickets that can be written out of order before the oldest one lands */
+#define TICKET_WINDOW 65536
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t base;
+} booking_log_header;
+
+/*
+    Node of the multi-producer single-consumer queue (Vyukov): producers
+    swap themselves in at head and then link the previous head to them;
+    the consumer follows next pointers from tail, which is always a node
+    already consumed (initially a stub).
+*/
+struct log_node {
+    struct log_node *next;
+    booking_log_ticket ticket;
+    booking_log_record record;
+};
+
+/* Descriptor of the open log, -1 when appends are ignored */
+static int log_fd = -1;
+
+static struct log_node *queue_head;
+static struct log_node *queue_tail;
+static uint64_t queue_pending;
+static uint64_t last_ticket;
+
+/* Written tickets not yet covered by durable_ticket, one bit per ticket */
+static uint8_t written_tickets[TICKET_WINDOW / 8];
+
+static pthread_t writer;
+static pthread_mutex_t writer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t writer_wake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t durable_changed = PTHREAD_COND_INITIALIZER;
+static booking_log_ticket durable_ticket;
+static bool flush_requested;
+static bool stop_requested;
+static unsigned int interval_ms = BOOKING_LOG_INTERVAL_MS;
+static unsigned int batch_size = BOOKING_LOG_BATCH;
+
+/*
+    Writes a whole buffer at a given offset, resuming after short writes.
+
+    Parameters:
+        fd: destination file.
+        data: bytes to write.
+        length: number of bytes.
+        offset: file offset, or -1 to write at the current position.
+
+    Returns:
+        None; exits the program on a write error.
+*/
+static void write_fully(int fd, const void *data, size_t length, off_t offset) {
+    const char *p = data;
+    while (length > 0) {
+        ssize_t n = offset < 0 ? write(fd, p, length) : pwrite(fd, p, length, offset);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "Failed to write booking log: %s\n", strerror(errno));
+            exit(1);
+        }
+        p += n;
+        length -= (size_t)n;
+        if (offset >= 0) offset += n;
+    }
+}
+
+/*
+    Checks the magic and version at the start of a log.
+
+    Parameters:
+        header: bytes read from the start of the file.
+
+    Returns:
+        bool: true if the header belongs to a log of this version.
+*/
+static bool header_is_valid(const booking_log_header *header) {
+    return memcmp(header->magic, BOOKING_LOG_MAGIC, sizeof(header->magic)) == 0
+        && header->version == BOOKING_LOG_VERSION;
+}
+
+/*
+    Computes the checksum of a record.
+
+    Parameters:
+        record: the record (its checksum field is ignored).
+
+    Returns:
+        uint32_t: CRC32C of the fields before checksum.
+*/
+static uint32_t record_checksum(const booking_log_record *record) {
+    return crc32c(0, record, offsetof(booking_log_record, checksum));
+}
+
+/*
+    Reads a record of a log body.
+
+    Parameters:
+        record: destination.
+        body: records following the header.
+        index: record number.
+
+    Returns:
+        bool: false if the record fails its checksum.
+*/
+static bool read_record(booking_log_record *record, const char *body, uint32_t index) {
+    memcpy(record, body + (size_t)index * sizeof(*record), sizeof(*record));
+    return record_checksum(record) == record->checksum;
+}
+
+/*
+    Counts the records at the start of a log body that are complete and
+    match their checksum: everything from the first damaged or partial
+    record on is the tail of an interrupted append, or corruption.
+
+    Parameters:
+        body: records following the header.
+        length: length of body.
+
+    Returns:
+        uint32_t: number of intact records.
+*/
+static uint32_t intact_records(const char *body, size_t length) {
+    uint32_t complete = (uint32_t)(length / sizeof(booking_log_record));
+    booking_log_record record;
+    uint32_t count = 0;
+    while (count < complete && read_record(&record, body, count)) count++;
+    return count;
+}
+
+/*
+    Reads a positive integer knob from the environment.
+
+    Parameters:
+        name: environment variable.
+        fallback: value used when the variable is unset or invalid.
+
+    Returns:
+        unsigned int: the configured value.
+*/
+static unsigned int env_knob(const char *name, unsigned int fallback) {
+    const char *value = getenv(name);
+    if (!value || !*value) return fallback;
+    char *end;
+    unsigned long parsed = strtoul(value, &end, 10);
+    if (*end || parsed == 0 || parsed > 1000000) return fallback;
+    return (unsigned int)parsed;
+}
+
+/*
+    Takes the oldest record off the queue. Only the persistence thread
+    calls this.
+
+    Parameters:
+        node: output, receives the ticket and the record.
+
+    Returns:
+        bool: false if the queue is empty (or the next producer has not
+        finished linking its node yet).
+*/
+static bool queue_pop(struct log_node *node) {
+    struct log_node *tail = queue_tail;
+    struct log_node *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (!next) return false;
+
+    node->ticket = next->ticket;
+    node->record = next->record;
+    queue_tail = next;
+    mem_free(tail);
+    __atomic_sub_fetch(&queue_pending, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+/*
+    Drops records of a batch whose effects cancel out: a booking followed
+    later in the batch by the cancellation of the same course (with no
+    other record for that course or seats record in between), and every
+    renewal but the last one. Replaying the coalesced batch gives the
+    same state.
+
+    Parameters:
+        batch: records in queue order.
+        count: number of records.
+
+    Returns:
+        uint32_t: number of records kept, compacted at the start of batch.
+*/
+static uint32_t coalesce_batch(struct log_node *batch, uint32_t count) {
+    bool *dropped = mem_calloc(MEM_TAG_IO, count ? count : 1, sizeof(*dropped));
+    int32_t last_renew = -1;
+
+    for (uint32_t i = 0; i < count; i++) {
+        booking_log_record *record = &batch[i].record;
+        if (record->type == BOOKING_LOG_RENEW) {
+            if (last_renew >= 0) dropped[last_renew] = true;
+            last_renew = (int32_t)i;
+        } else if (record->type == BOOKING_LOG_CANCEL) {
+            for (uint32_t j = i; j-- > 0;) {
+                // a seats record splits the pair: the booking may be in the sidecar
+                if (batch[j].record.type == BOOKING_LOG_SEATS) break;
+                if (dropped[j] || batch[j].record.type == BOOKING_LOG_RENEW) continue;
+                if (batch[j].record.course_id != record->course_id) continue;
+                if (batch[j].record.type == BOOKING_LOG_BOOK) {
+                    dropped[j] = true;
+                    dropped[i] = true;
+                }
+                break;
+            }
+        }
+    }
+
+    uint32_t kept = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!dropped[i]) batch[kept++] = batch[i];
+    }
+    mem_free(dropped);
+    return kept;
+}
+
+/*
+    Records that a batch is durable and moves durable_ticket past every
+    ticket written without gaps. Called with writer_lock held.
+
+    Parameters:
+        tickets: tickets of the batch, including coalesced records.
+        count: number of tickets.
+
+    Returns:
+        None.
+*/
+static void mark_durable(const booking_log_ticket *tickets, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t bit = tickets[i] % TICKET_WINDOW;
+        written_tickets[bit / 8] |= (uint8_t)(1u << (bit % 8));
+    }
+    for (;;) {
+        uint64_t bit = (durable_ticket + 1) % TICKET_WINDOW;
+        uint8_t mask = (uint8_t)(1u << (bit % 8));
+        if (!(written_tickets[bit / 8] & mask)) break;
+        written_tickets[bit / 8] &= (uint8_t)~mask;
+        durable_ticket++;
+    }
+    pthread_cond_broadcast(&durable_changed);
+}
+
+/*
+    Drains the queue: coalesces what was taken, appends it with a single
+    write and makes it durable with one fdatasync.
+
+    Parameters:
+        None.
+
+    Returns:
+        uint32_t: number of records taken off the queue.
+*/
+static uint32_t write_batch(void) {
+    uint32_t capacity = batch_size;
+    uint32_t count = 0;
+    struct log_node *batch = mem_alloc(MEM_TAG_IO, capacity * sizeof(*batch));
+    while (queue_pop(&batch[count])) {
+        if (++count == capacity) {
+            capacity *= 2;
+            batch = mem_realloc(batch, MEM_TAG_IO, capacity * sizeof(*batch));
+        }
+    }
+    if (count == 0) {
+        mem_free(batch);
+        return 0;
+    }
+
+    booking_log_ticket *tickets = mem_alloc(MEM_TAG_IO, count * sizeof(*tickets));
+    for (uint32_t i = 0; i < count; i++) tickets[i] = batch[i].ticket;
+
+    uint32_t kept = coalesce_batch(batch, count);
+    if (kept) {
+        booking_log_record *records = mem_alloc(MEM_TAG_IO, kept * sizeof(*records));
+        for (uint32_t i = 0; i < kept; i++) records[i] = batch[i].record;
+        write_fully(log_fd, records, kept * sizeof(*records), -1);
+        mem_free(records);
+        if (fdatasync(log_fd) != 0) {
+            fprintf(stderr, "Failed to sync booking log: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+
+    pthread_mutex_lock(&writer_lock);
+    mark_durable(tickets, count);
+    pthread_mutex_unlock(&writer_lock);
+
+    mem_free(tickets);
+    mem_free(batch);
+    return count;
+}
+
+/*
+    Persistence thread: sleeps until the interval elapses, the batch
+    threshold is reached or someone waits on a ticket, then writes
+    everything queued so far. Drains the queue before stopping.
+
+    Parameters:
+        arg: unused.
+
+    Returns:
+        NULL.
+*/
+static void *writer_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&writer_lock);
+        if (!stop_requested && !flush_requested
+            && __atomic_load_n(&queue_pending, __ATOMIC_RELAXED) < batch_size) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += interval_ms / 1000;
+            deadline.tv_nsec += (long)(interval_ms % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&writer_wake, &writer_lock, &deadline);
+        }
+        bool stopping = stop_requested;
+        flush_requested = false;
+        pthread_mutex_unlock(&writer_lock);
+
+        write_batch();
+        if (stopping && __atomic_load_n(&queue_pending, __ATOMIC_ACQUIRE) == 0) break;
+    }
+    return NULL;
+}
+
+/*
+    Wakes the persistence thread before its interval elapses.
+
+    Parameters:
+        None.
+
+    Returns:
+        None.
+*/
+static void wake_writer(void) {
+    pthread_mutex_lock(&writer_lock);
+    flush_requested = true;
+    pthread_cond_signal(&writer_wake);
+    pthread_mutex_unlock(&writer_lock);
+}
+
+/*
+    Opens (creating it if needed) the log that subsequent appends go to
+    and starts its persistence thread. A partial record left by an
+    interrupted append is cut off so new records stay aligned.
+
+    Parameters:
+        filepath: path of the log file.
+        base: stamp of the user record the session started from.
+
+    Pre-conditions:
+        No log is open.
+
+    Post-conditions:
+        The log is open for appending, cut after its last intact record.
+        A log stamped with another base is emptied first, its records are
+        already saved.
+
+    Returns:
+        None; exits the program if the file cannot be opened or is not a log.
+*/
+void booking_log_open(const char *filepath, uint32_t base) {
+    CHECK_NULL(filepath);
+    if (log_fd >= 0) {
+        fprintf(stderr, "A booking log is already open\n");
+        exit(1);
+    }
+
+    int fd = open(filepath, O_RDWR | O_CREAT | O_APPEND, 0666);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open booking log %s: %s\n", filepath, strerror(errno));
+        exit(1);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        fprintf(stderr, "Failed to stat booking log %s\n", filepath);
+        exit(1);
+    }
+
+    booking_log_header header;
+    if (st.st_size > 0) {
+        if ((size_t)st.st_size < sizeof(header)
+            || pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)
+            || !header_is_valid(&header)) {
+            fprintf(stderr, "Invalid booking log %s\n", filepath);
+            exit(1);
+        }
+        // the records of another base are in the saved user already
+        if (header.base != base && ftruncate(fd, 0) != 0) {
+            fprintf(stderr, "Failed to reset booking log %s\n", filepath);
+            exit(1);
+        }
+    }
+    if (st.st_size == 0 || header.base != base) {
+        memcpy(header.magic, BOOKING_LOG_MAGIC, sizeof(header.magic));
+        header.version = BOOKING_LOG_VERSION;
+        header.base = base;
+        write_fully(fd, &header, sizeof(header), -1);
+    } else {
+        // cut the log after its last intact record
+        size_t size = 0;
+        const char *mapping = map_file(filepath, &size);
+        CHECK_NULL(mapping);
+        uint32_t count = intact_records(mapping + sizeof(header), size - sizeof(header));
+        off_t intact = (off_t)(sizeof(header) + (size_t)count * sizeof(booking_log_record));
+        if (intact != st.st_size && ftruncate(fd, intact) != 0) {
+            fprintf(stderr, "Failed to repair booking log %s\n", filepath);
+            exit(1);
+        }
+        unmap_file(mapping, size);
+    }
+
+    // empty queue: head and tail on a stub node
+    struct log_node *stub = mem_alloc(MEM_TAG_IO, sizeof(*stub));
+    stub->next = NULL;
+    queue_head = queue_tail = stub;
+    queue_pending = 0;
+    last_ticket = durable_ticket = 0;
+    memset(written_tickets, 0, sizeof(written_tickets));
+    flush_requested = stop_requested = false;
+    interval_ms = env_knob(BOOKING_LOG_INTERVAL_ENV, BOOKING_LOG_INTERVAL_MS);
+    batch_size = env_knob(BOOKING_LOG_BATCH_ENV, BOOKING_LOG_BATCH);
+
+    log_fd = fd;
+    if (pthread_create(&writer, NULL, writer_main, NULL) != 0) {
+        fprintf(stderr, "Failed to start booking log thread\n");
+        exit(1);
+    }
+}
+
+/*
+    Stores a datetime in the compact log format.
+
+    Parameters:
+        date: destination.
+        datetime: source datetime.
+
+    Returns:
+        None.
+*/
+static void to_log_date(booking_log_date *date, datetime_ptr datetime) {
+    CHECK_NULL(datetime);
+    date->year = (uint16_t)datetime->year;
+    date->month = (uint8_t)datetime->month;
+    date->day = (uint8_t)datetime->day;
+    date->hour = (uint8_t)datetime->hour;
+    date->minute = (uint8_t)datetime->minute;
+}
+
+/*
+    Queues a record for the persistence thread without taking any lock,
+    unless the batch threshold is reached and the thread must be woken.
+
+    Parameters:
+        record: record to queue.
+
+    Returns:
+        booking_log_ticket: the record's ticket, 0 if no log is open.
+*/
+static booking_log_ticket append_record(const booking_log_record *record) {
+    if (log_fd < 0) return 0;
+
+    struct log_node *node = mem_alloc(MEM_TAG_IO, sizeof(*node));
+    node->next = NULL;
+    node->record = *record;
+    node->record.checksum = record_checksum(record);
+    node->ticket = __atomic_add_fetch(&last_ticket, 1, __ATOMIC_RELAXED);
+
+    struct log_node *previous = __atomic_exchange_n(&queue_head, node, __ATOMIC_ACQ_REL);
+    __atomic_store_n(&previous->next, node, __ATOMIC_RELEASE);
+
+    if (__atomic_add_fetch(&queue_pending, 1, __ATOMIC_RELAXED) == batch_size) {
+        wake_writer();
+    }
+    return node->ticket;
+}
+
+/*
+    Queues a booking record.
+
+    Parameters:
+        course_id: ID of the booked course.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_book(uint16_t course_id) {
+    booking_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = BOOKING_LOG_BOOK;
+    record.course_id = course_id;
+    return append_record(&record);
+}
+
+/*
+    Queues a cancellation record.
+
+    Parameters:
+        course_id: ID of the cancelled course.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_cancel(uint16_t course_id) {
+    booking_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = BOOKING_LOG_CANCEL;
+    record.course_id = course_id;
+    return append_record(&record);
+}
+
+/*
+    Queues a subscription renewal record.
+
+    Parameters:
+        start: new subscription start date.
+        end: new subscription end date.
+
+    Pre-conditions:
+        start and end must not be NULL.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_renew(datetime_ptr start, datetime_ptr end) {
+    booking_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = BOOKING_LOG_RENEW;
+    to_log_date(&record.start, start);
+    to_log_date(&record.end, end);
+    return append_record(&record);
+}
+
+/*
+    Queues a seats record: the seat counters of the records before it are
+    about to be flushed to the sidecar with the given generation.
+
+    Parameters:
+        generation: generation reserved for the flush.
+
+    Post-conditions:
+        The record is queued if a log is open, otherwise nothing happens.
+
+    Returns:
+        booking_log_ticket: durability future of the record, 0 if no log is open.
+*/
+booking_log_ticket booking_log_seats(uint32_t generation) {
+    booking_log_record record;
+    memset(&record, 0, sizeof(record));
+    record.type = BOOKING_LOG_SEATS;
+    record.generation = generation;
+    return append_record(&record);
+}
+
+/*
+    Blocks until a queued record is on stable storage. The persistence
+    thread is woken up so the wait does not last a whole interval.
+
+    Parameters:
+        ticket: future returned when the record was queued.
+
+    Post-conditions:
+        The record and every record queued before it by the same thread
+        are durable. Returns at once for ticket 0 or if no log is open.
+*/
+void booking_log_wait(booking_log_ticket ticket) {
+    if (ticket == 0 || log_fd < 0) return;
+
+    pthread_mutex_lock(&writer_lock);
+    while (durable_ticket < ticket) {
+        flush_requested = true;
+        pthread_cond_signal(&writer_wake);
+        pthread_cond_wait(&durable_changed, &writer_lock);
+    }
+    pthread_mutex_unlock(&writer_lock);
+}
+
+/*
+    Converts a stored date back to a datetime.
+
+    Parameters:
+        datetime: destination.
+        date: stored date.
+
+    Pre-conditions:
+        Both parameters must not be NULL.
+*/
+void booking_log_to_datetime(datetime_ptr datetime, const booking_log_date *date) {
+    CHECK_NULL(date);
+    init_datetime(datetime, date->minute, date->hour, date->day, date->month, date->year);
+}
+
+/*
+    Empties the open log, after its records have been saved in full.
+    Records still queued are written first.
+
+    Post-conditions:
+        Only the header remains; nothing happens if no log is open.
+*/
+void booking_log_checkpoint(void) {
+    if (log_fd < 0) return;
+    booking_log_wait(__atomic_load_n(&last_ticket, __ATOMIC_RELAXED));
+    if (ftruncate(log_fd, (off_t)sizeof(booking_log_header)) != 0) {
+        fprintf(stderr, "Failed to reset booking log: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+/*
+    Writes the records still queued, stops the persistence thread and
+    closes the open log, if any.
+
+    Post-conditions:
+        Appends are ignored until a log is opened again.
+*/
+void booking_log_close(void) {
+    if (log_fd < 0) return;
+
+    pthread_mutex_lock(&writer_lock);
+    stop_requested = true;
+    pthread_cond_signal(&writer_wake);
+    pthread_mutex_unlock(&writer_lock);
+    pthread_join(writer, NULL);
+
+    mem_free(queue_tail);
+    queue_head = queue_tail = NULL;
+    close(log_fd);
+    log_fd = -1;
+}
+
+/*
+    Reads a log and calls apply on every record, in order, up to the
+    first one that is partial (interrupted append) or fails its checksum;
+    the records from there on are reported on stderr and ignored. Nothing
+    is applied if the log is stamped with another base.
+
+    Parameters:
+        filepath: path of the log file.
+        base: stamp of the user record the records are applied to.
+        apply: function applying one record.
+        context: passed through to apply.
+
+    Pre-conditions:
+        No log is open on filepath.
+
+    Returns:
+        uint32_t: number of records applied; 0 if the log does not exist
+        or belongs to another base.
+        Exits the program if the file is not a log.
+*/
+uint32_t booking_log_replay(const char *filepath, uint32_t base,
+                            void (*apply)(const booking_log_record *record, void *context),
+                            void *context) {
+    CHECK_NULL(apply);
+
+    size_t size = 0;
+    const char *mapping = map_file(filepath, &size);
+    if (!mapping) return 0;
+
+    booking_log_header header;
+    if (size < sizeof(header)) {
+        fprintf(stderr, "Invalid booking log %s\n", filepath);
+        exit(1);
+    }
+    memcpy(&header, mapping, sizeof(header));
+    if (!header_is_valid(&header)) {
+        fprintf(stderr, "Invalid booking log %s\n", filepath);
+        exit(1);
+    }
+    if (header.base != base) {
+        unmap_file(mapping, size);
+        return 0;
+    }
+
+    const char *body = mapping + sizeof(header);
+    size_t length = size - sizeof(header);
+    uint32_t count = intact_records(body, length);
+    uint32_t complete = (uint32_t)(length / sizeof(booking_log_record));
+    if (count < complete) {
+        fprintf(stderr, "Booking log %s: record %u fails its checksum, %u records ignored\n",
+                filepath, count + 1, complete - count);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        booking_log_record record;
+        read_record(&record, body, i);
+        apply(&record, context);
+    }
+
+    unmap_file(mapping, size);
+    return count;
+}
@@ -0,0 +1,371 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "catalog_snapshot.h"
+#include "course.h"
+#include "crc32c.h"
+#include "datetime.h"
+#include "out_buffer.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SNAPSHOT_MAGIC "MFCS"
+
+/*
+    On-disk layout, native endianness:
+        header | records[course_count] | index[index_size] | strings
+    index[slot] is 0 for an empty slot, otherwise record number + 1.
+    The header stamps the text catalog the snapshot was exported from
+    (all zero when unstamped) and the CRC32C of everything after it.
+*/
+struct snapshot_header {
+    char magic[4];
+    uint32_t version;
+    uint32_t course_count;
+    uint32_t index_size;
+    uint32_t records_offset;
+    uint32_t index_offset;
+    uint32_t strings_offset;
+    uint32_t strings_size;
+    uint64_t catalog_size;
+    int64_t catalog_mtime_sec;
+    int64_t catalog_mtime_nsec;
+    uint32_t checksum;
+    uint32_t reserved;
+};
+
+struct snapshot_record {
+    uint16_t id;
+    uint16_t seats_total;
+    uint16_t seats_booked;
+    uint16_t year;
+    uint8_t month;
+    uint8_t day;
+    uint8_t hour;
+    uint8_t minute;
+    uint32_t name_offset;
+    uint32_t name_length;
+};
+
+/*
+    Fills the catalog stamp of a header from the text catalog.
+
+    Parameters:
+        header: header to fill.
+        text_path: path of the text catalog.
+
+    Returns:
+        bool: false if the text catalog cannot be stat'ed.
+*/
+static bool stamp_text_catalog(struct snapshot_header *header, const char *text_path) {
+    struct stat st;
+    if (stat(text_path, &st) != 0) return false;
+    header->catalog_size = (uint64_t)st.st_size;
+    header->catalog_mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    header->catalog_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    return true;
+}
+
+/*
+    Writes the snapshot sections one after the other, after a header
+    holding their checksum and, if text_path is given, the stamp of the
+    text catalog.
+
+    Parameters:
+        filepath: path of the snapshot file to create.
+        text_path: path of the text catalog, or NULL.
+        array: catalog array.
+        hash_map: catalog hash map.
+
+    Pre-conditions:
+        filepath, array and hash_map must be valid.
+
+    Post-conditions:
+        The snapshot file is written, or left as it was on failure.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+static bool write_snapshot(const char *filepath, const char *text_path, array_ptr array, hash_map_ptr hash_map) {
+    CHECK_NULL(filepath);
+    CHECK_NULL(array);
+    CHECK_NULL(hash_map);
+
+    uint16_t count = get_size(array);
+    uint16_t index_size = get_hash_map_size(hash_map);
+
+    struct snapshot_record *records = mem_calloc(MEM_TAG_IO, count ? count : 1, sizeof(*records));
+    uint16_t *index = mem_calloc(MEM_TAG_IO, index_size ? index_size : 1, sizeof(*index));
+    export_hash_map_layout(hash_map, array, index);
+
+    uint32_t strings_size = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        datetime_ptr datetime = get_course_datetime(course);
+
+        records[i].id = get_course_id(course);
+        records[i].seats_total = get_course_seats_total(course);
+        records[i].seats_booked = get_course_seats_booked(course);
+        records[i].year = (uint16_t)datetime->year;
+        records[i].month = (uint8_t)datetime->month;
+        records[i].day = (uint8_t)datetime->day;
+        records[i].hour = (uint8_t)datetime->hour;
+        records[i].minute = (uint8_t)datetime->minute;
+        records[i].name_offset = strings_size;
+        records[i].name_length = strlen(get_course_name(course));
+        strings_size += records[i].name_length + 1;
+    }
+
+    // the sections are assembled in memory to checksum them before the header
+    out_buffer_ptr payload = out_buffer_create(count * sizeof(*records) + index_size * sizeof(*index) + strings_size);
+    out_append_bytes(payload, records, count * sizeof(*records));
+    out_append_bytes(payload, index, index_size * sizeof(*index));
+    for (uint16_t i = 0; i < count; i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        out_append_bytes(payload, get_course_name(course), records[i].name_length + 1);
+    }
+
+    struct snapshot_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = CATALOG_SNAPSHOT_VERSION;
+    header.course_count = count;
+    header.index_size = index_size;
+    header.records_offset = sizeof(header);
+    header.index_offset = header.records_offset + count * sizeof(*records);
+    header.strings_offset = header.index_offset + index_size * sizeof(*index);
+    header.strings_size = strings_size;
+    header.checksum = crc32c(0, out_buffer_data(payload), out_buffer_length(payload));
+    if (text_path) stamp_text_catalog(&header, text_path);
+
+    bool saved = false;
+    out_buffer_ptr out = out_buffer_open(filepath);
+    if (out) {
+        out_append_bytes(out, &header, sizeof(header));
+        out_buffer_writev(out, &payload, 1);
+        saved = out_buffer_close(out);
+    } else {
+        fprintf(stderr, "Failed to open %s\n", filepath);
+    }
+
+    out_buffer_close(payload);
+    mem_free(records);
+    mem_free(index);
+    return saved;
+}
+
+/*
+    Writes the catalog to an unstamped binary snapshot.
+
+    Parameters:
+        filepath: path of the snapshot file to create.
+        array: catalog array.
+        hash_map: catalog hash map.
+
+    Pre-conditions:
+        All parameters must be valid.
+
+    Post-conditions:
+        The snapshot file is written, or left as it was on failure.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+bool save_catalog_snapshot(const char *filepath, array_ptr array, hash_map_ptr hash_map) {
+    return write_snapshot(filepath, NULL, array, hash_map);
+}
+
+/*
+    Writes the catalog to a binary snapshot stamped with the size and
+    modification time of the text catalog it was exported from.
+
+    Parameters:
+        filepath: path of the snapshot file to create.
+        text_path: path of the text catalog.
+        array: catalog array.
+        hash_map: catalog hash map.
+
+    Pre-conditions:
+        All parameters must be valid.
+
+    Post-conditions:
+        The snapshot file is written, or left as it was on failure.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+bool save_catalog_snapshot_stamped(const char *filepath, const char *text_path, array_ptr array, hash_map_ptr hash_map) {
+    CHECK_NULL(text_path);
+    return write_snapshot(filepath, text_path, array, hash_map);
+}
+
+/*
+    Checks that every offset and length stored in the snapshot stays
+    inside the mapped file and that the sections match their checksum.
+
+    Parameters:
+        base: start of the mapping.
+        size: size of the mapping in bytes.
+
+    Pre-conditions:
+        base must point to at least size readable bytes.
+
+    Returns:
+        bool: true if the snapshot can be used safely.
+*/
+static bool snapshot_is_valid(const char *base, size_t size) {
+    if (size < sizeof(struct snapshot_header)) return false;
+
+    const struct snapshot_header *header = (const struct snapshot_header *)base;
+    if (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->version != CATALOG_SNAPSHOT_VERSION) return false;
+    if (header->course_count == 0 || header->course_count > UINT16_MAX) return false;
+    if (header->index_size < header->course_count || header->index_size > UINT16_MAX) return false;
+
+    uint64_t records_end = (uint64_t)header->records_offset
+        + (uint64_t)header->course_count * sizeof(struct snapshot_record);
+    uint64_t index_end = (uint64_t)header->index_offset
+        + (uint64_t)header->index_size * sizeof(uint16_t);
+    uint64_t strings_end = (uint64_t)header->strings_offset + header->strings_size;
+    if (records_end > size || index_end > size || strings_end > size) return false;
+    if (header->records_offset % sizeof(uint32_t) || header->index_offset % sizeof(uint16_t)) return false;
+
+    const struct snapshot_record *records =
+        (const struct snapshot_record *)(base + header->records_offset);
+    const char *strings = base + header->strings_offset;
+    for (uint32_t i = 0; i < header->course_count; i++) {
+        uint64_t name_end = (uint64_t)records[i].name_offset + records[i].name_length;
+        if (name_end >= header->strings_size || strings[name_end] != '\0') return false;
+    }
+
+    // the index layout itself is checked when it is imported
+    uint64_t payload_end = strings_end;
+    return crc32c(0, base + sizeof(*header), (size_t)(payload_end - sizeof(*header))) == header->checksum;
+}
+
+/*
+    Compares the stamp saved in the snapshot header with the text catalog,
+    so the snapshot is used only if the text file has not changed since
+    it was exported.
+
+    Parameters:
+        snapshot_path: path of the binary snapshot.
+        text_path: path of the text catalog.
+
+    Pre-conditions:
+        Both paths must be valid strings.
+
+    Returns:
+        bool: true if the snapshot exists and its stamp matches the text
+        file (or there is no text file).
+*/
+bool catalog_snapshot_is_fresh(const char *snapshot_path, const char *text_path) {
+    int fd = open(snapshot_path, O_RDONLY);
+    if (fd < 0) return false;
+
+    struct snapshot_header header;
+    bool read_ok = pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header);
+    close(fd);
+    if (!read_ok || memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0
+        || header.version != CATALOG_SNAPSHOT_VERSION) return false;
+
+    struct snapshot_header expected;
+    if (!stamp_text_catalog(&expected, text_path)) return true;
+    return header.catalog_size == expected.catalog_size
+        && header.catalog_mtime_sec == expected.catalog_mtime_sec
+        && header.catalog_mtime_nsec == expected.catalog_mtime_nsec;
+}
+
+/*
+    Deletes a course stored in the array, for array_delete.
+
+    Parameters:
+        element: the course.
+*/
+static void delete_course_element(void *element) {
+    delete_course((course_ptr)element);
+}
+
+/*
+    Maps the snapshot read-only and builds courses, array and hash map
+    straight from the fixed-width records and the saved index.
+
+    Parameters:
+        filepath: path of the snapshot file.
+        array: output catalog array.
+        hash_map: output catalog hash map.
+
+    Pre-conditions:
+        array and hash_map must not be NULL.
+
+    Post-conditions:
+        On success the catalog is built, through the saved index when it
+        is usable and by hashing every course otherwise; the mapping is
+        released.
+
+    Returns:
+        bool: true on success, false if the snapshot cannot be used.
+*/
+bool load_catalog_snapshot(const char *filepath, array_ptr *array, hash_map_ptr *hash_map) {
+    CHECK_NULL(array);
+    CHECK_NULL(hash_map);
+
+    size_t size;
+    const char *base = map_file(filepath, &size);
+    if (!base) return false;
+
+    if (!snapshot_is_valid(base, size)) {
+        unmap_file(base, size);
+        return false;
+    }
+
+    const struct snapshot_header *header = (const struct snapshot_header *)base;
+    const struct snapshot_record *records =
+        (const struct snapshot_record *)(base + header->records_offset);
+    const uint16_t *index = (const uint16_t *)(base + header->index_offset);
+    const char *strings = base + header->strings_offset;
+
+    *array = array_create((uint16_t)header->course_count);
+    *hash_map = create_hash_map((uint16_t)header->index_size);
+
+    for (uint32_t i = 0; i < header->course_count; i++) {
+        const struct snapshot_record *record = &records[i];
+        course_ptr course = create_course(
+            record->id,
+            (char *)strings + record->name_offset,
+            create_datetime(record->minute, record->hour, record->day, record->month, record->year),
+            record->seats_total,
+            record->seats_booked);
+        set_course_position(course, (uint16_t)i);
+        array_add(*array, course);
+    }
+
+    // the saved table is restored as is, nothing is hashed again; a table
+    // that lookups would not follow is rebuilt by hashing every course
+    bool indexed = import_hash_map_layout(*hash_map, *array, index);
+    if (!indexed) {
+        indexed = true;
+        for (uint32_t i = 0; i < header->course_count && indexed; i++) {
+            course_ptr course = *(course_ptr*)get_at(*array, (uint16_t)i);
+            // a repeated id makes the snapshot unusable
+            indexed = get_course(*hash_map, get_course_id(course)) == NULL;
+            if (indexed) insert_course(*hash_map, get_course_id(course), course);
+        }
+    }
+    if (!indexed) {
+        array_delete(*array, delete_course_element);
+        delete_hash_map(*hash_map, false);
+        *array = NULL;
+        *hash_map = NULL;
+        unmap_file(base, size);
+        return false;
+    }
+
+    unmap_file(base, size);
+    return true;
+}
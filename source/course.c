@@ -7,15 +7,88 @@
 
 struct course {
     uint16_t id;
+    uint16_t position;
     char* name;
     datetime_ptr datetime;
     uint16_t seats_total;
     uint16_t seats_booked;
+    course_handle handle;
 };
 
+/* Slot of the course slab: the course it holds, or the next free slot */
+struct course_slot {
+    course_ptr course;
+    uint32_t next_free;
+    uint16_t generation;
+};
+
+#define COURSE_SLAB_SLOTS (UINT16_MAX + 1u)
+#define COURSE_SLOT_NONE UINT32_MAX
+
+/* Slab every course is registered in, with the free slots chained */
+static struct course_slot *slab;
+static uint32_t slab_size;
+static uint32_t slab_capacity;
+static uint32_t slab_free = COURSE_SLOT_NONE;
+
+/*
+    Registers a course in a free slot of the slab, reusing released
+    slots first.
+
+    Parameters:
+        course: the course.
+
+    Post-conditions:
+        Exits the program when every slot is in use or retired.
+
+    Returns:
+        course_handle: the handle of the course.
+*/
+static course_handle slab_acquire(course_ptr course) {
+    uint32_t index = slab_free;
+    if (index != COURSE_SLOT_NONE) {
+        slab_free = slab[index].next_free;
+    } else {
+        if (slab_size == COURSE_SLAB_SLOTS) {
+            fprintf(stderr, "Too many courses: all %u course slots are in use or retired\n", COURSE_SLAB_SLOTS);
+            exit(1);
+        }
+        if (slab_size == slab_capacity) {
+            slab_capacity = slab_capacity ? slab_capacity * 2 : 64;
+            if (slab_capacity > COURSE_SLAB_SLOTS) slab_capacity = COURSE_SLAB_SLOTS;
+            slab = mem_realloc(slab, MEM_TAG_COURSE, slab_capacity * sizeof(*slab));
+        }
+        index = slab_size++;
+        // generation 0 is never used, so no handle is COURSE_HANDLE_NONE
+        slab[index].generation = 1;
+    }
+
+    slab[index].course = course;
+    slab[index].next_free = COURSE_SLOT_NONE;
+    return ((course_handle)slab[index].generation << 16) | index;
+}
+
+/*
+    Releases the slot of a deleted course: its generation moves on, so
+    the handles to it stop resolving. A slot whose generation has reached
+    UINT16_MAX is retired instead of wrapping, since a wrapped generation
+    would make a handle from its first use resolve again.
+
+    Parameters:
+        handle: handle of the course.
+*/
+static void slab_release(course_handle handle) {
+    uint32_t index = handle & 0xFFFFu;
+    slab[index].course = NULL;
+    if (slab[index].generation == UINT16_MAX) return;
+    slab[index].generation++;
+    slab[index].next_free = slab_free;
+    slab_free = index;
+}
+
 /*
     Allocates memory for a new course object and initializes its fields.
-    Copies the provided name string, stores a reference to the datetime parameter.
+    Interns the provided name string, stores a reference to the datetime parameter.
 
     Parameters:
         id: unique identifier for the course.
@@ -36,23 +109,22 @@ struct course {
 */
 course_ptr create_course(
     uint16_t id,
-    char* name,
+    const char* name,
     datetime_ptr datetime,
     uint16_t seats_total,
     uint16_t seats_booked
 ) {
-    course_ptr new_course = malloc(sizeof(struct course));
-    CHECK_NULL(new_course);
+    course_ptr new_course = mem_alloc(MEM_TAG_COURSE, sizeof(struct course));
 
     new_course->id = id;
+    new_course->position = 0;
 
-    new_course->name = malloc(strlen(name) + 1);
-    CHECK_NULL(new_course->name);
-    strcpy(new_course->name, name);
+    new_course->name = str_intern(name);
 
     new_course->datetime = datetime;
     new_course->seats_total  = seats_total;
     new_course->seats_booked = seats_booked;
+    new_course->handle = slab_acquire(new_course);
 
     return new_course;
 }
@@ -102,7 +174,7 @@ int compare_course_id(void* a, void* b) {
         course must be initialized and not NULL.
 
     Returns:
-        Pointer to the null-terminated name string.
+        Pointer to the null-terminated interned name string.
 */
 char* get_course_name(course_ptr course) {
     return course->name;
@@ -177,22 +249,90 @@ void set_course_seats_booked(course_ptr course, int value) {
 }
 
 /*
-    Callback function to print only the course ID to a file.
+    Returns the position of the course in the catalog array.
 
     Parameters:
-        file: output file pointer.
+        course: a valid pointer to a course object.
+
+    Pre-conditions:
+        course must be initialized and not NULL.
+
+    Returns:
+        Index of the course in the catalog array.
+*/
+uint16_t get_course_position(course_ptr course) {
+    return course->position;
+}
+
+/*
+    Records the position of the course in the catalog array.
+
+    Parameters:
+        course: pointer to a course object.
+        position: index of the course in the catalog array.
+
+    Pre-conditions:
+        course must be initialized and not NULL.
+
+    Post-conditions:
+        course->position is updated to the new value.
+
+    Returns:
+        None.
+*/
+void set_course_position(course_ptr course, uint16_t position) {
+    course->position = position;
+}
+
+/*
+    Replaces the description of a course in place, so pointers to it
+    stay valid. The id and the booked seats are left unchanged.
+
+    Parameters:
+        course: pointer to the course.
+        name: new name (need not be null-terminated).
+        name_length: length of name.
+        datetime: new datetime, copied into the course.
+        seats_total: new total number of seats.
+
+    Pre-conditions:
+        course, name and datetime must not be NULL.
+
+    Post-conditions:
+        The name is interned.
+
+    Returns:
+        None.
+*/
+void update_course(course_ptr course, const char *name, size_t name_length, datetime_ptr datetime, uint16_t seats_total) {
+    CHECK_NULL(course);
+    CHECK_NULL(name);
+    CHECK_NULL(datetime);
+
+    course->name = str_intern_n(name, name_length);
+    init_datetime(course->datetime, datetime->minute, datetime->hour,
+                  datetime->day, datetime->month, datetime->year);
+    course->seats_total = seats_total;
+}
+
+/*
+    Callback function to write only the course ID to a file.
+
+    Parameters:
+        out: output buffer of the user file.
         element: void pointer to a course.
 
     Pre-conditions:
-        file must be a valid FILE pointer.
+        out must be a valid output buffer.
         element must be a valid pointer to a course object.
 
     Returns:
         None.
 */
-void save_booking_callback(FILE *file, void *element){
+void save_booking_callback(out_buffer_ptr out, void *element){
     course_ptr course = (course_ptr)element;
-    fprintf(file, "%d,", get_course_id(course));
+    out_append_uint(out, get_course_id(course));
+    out_append_char(out, ',');
 }
 
 /*
@@ -259,9 +399,72 @@ void print_course_file_callback(FILE *file, void *element){
     fprintf(file, "\n");
 }
 
+/*
+    Callback to save a course as one line of the catalog file,
+    with the same text print_course_file_callback writes.
+
+    Parameters:
+        out: output buffer of the catalog file.
+        element: void pointer to a course.
+
+    Pre-conditions:
+        out must be a valid output buffer.
+        element must be a valid pointer to a course object.
+
+    Returns:
+        None.
+*/
+void save_course_callback(out_buffer_ptr out, void *element){
+    course_ptr course = (course_ptr)element;
+    out_append_uint(out, course->id);
+    out_append_char(out, ',');
+    out_append_string(out, course->name);
+    out_append_char(out, ',');
+    out_append_datetime(out, course->datetime);
+    out_append_char(out, ',');
+    out_append_uint(out, course->seats_total);
+    out_append_char(out, ',');
+    out_append_uint(out, course->seats_booked);
+    out_append_string(out, ",\n");
+}
+
+/*
+    Returns the handle of a course.
+
+    Parameters:
+        course: pointer to the course.
+
+    Pre-conditions:
+        course must be initialized and not NULL.
+
+    Returns:
+        course_handle: the handle, valid until the course is deleted.
+*/
+course_handle get_course_handle(course_ptr course) {
+    CHECK_NULL(course);
+    return course->handle;
+}
+
+/*
+    Resolves a course handle in constant time: the slot is indexed
+    directly and its generation must match the one in the handle.
+
+    Parameters:
+        handle: handle returned by get_course_handle.
+
+    Returns:
+        course_ptr: the course, or NULL if it has been deleted since.
+*/
+course_ptr resolve_course_handle(course_handle handle) {
+    uint32_t index = handle & 0xFFFFu;
+    if (index >= slab_size || slab[index].generation != handle >> 16) return NULL;
+    return slab[index].course;
+}
+
 /*
     Frees all memory associated with the course:
-    name, datetime object, and the course struct itself.
+    datetime object and the course struct itself.
+    The name is interned and stays in the intern table.
 
     Parameters:
         course: a pointer to the course to delete.
@@ -270,13 +473,38 @@ void print_course_file_callback(FILE *file, void *element){
         course must be initialized and not NULL.
 
     Post-conditions:
-        The course and all associated memory are freed.
+        The course and all associated memory are freed; its slab slot is
+        released, so handles to it no longer resolve.
 
     Returns:
         None.
 */
 void delete_course(course_ptr course) {
-    free(course->name);
-    free(course->datetime);
-    free(course);
+    slab_release(course->handle);
+    delete_datetime(course->datetime);
+    mem_free(course);
+}
+
+/*
+    Frees the course slab. Every slot, retired ones included, becomes
+    available again.
+
+    Parameters:
+        None.
+
+    Pre-conditions:
+        Every course has been deleted and no handle is resolved afterwards.
+
+    Post-conditions:
+        The slab is empty.
+
+    Returns:
+        None.
+*/
+void course_slab_clear(void) {
+    mem_free(slab);
+    slab = NULL;
+    slab_size = 0;
+    slab_capacity = 0;
+    slab_free = COURSE_SLOT_NONE;
 }
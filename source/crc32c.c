@@ -0,0 +1,108 @@
+#include "crc32c.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define CRC32C_HARDWARE 1
+#endif
+
+/* Reflected Castagnoli polynomial */
+#define CRC32C_POLY 0x82F63B78u
+
+static uint32_t crc_table[256];
+static pthread_once_t table_once = PTHREAD_ONCE_INIT;
+
+/*
+    Fills the byte-at-a-time lookup table.
+
+    Parameters:
+        None.
+
+    Returns:
+        None.
+*/
+static void build_table(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0u - (crc & 1u)));
+        }
+        crc_table[i] = crc;
+    }
+}
+
+/*
+    Table-driven CRC32C, one byte per step.
+
+    Parameters:
+        crc: running value, already inverted.
+        p: bytes to add.
+        length: number of bytes.
+
+    Returns:
+        uint32_t: running value, still inverted.
+*/
+static uint32_t crc32c_table(uint32_t crc, const unsigned char *p, size_t length) {
+    pthread_once(&table_once, build_table);
+    while (length--) {
+        crc = crc_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef CRC32C_HARDWARE
+/*
+    CRC32C with the SSE4.2 crc32 instruction: eight bytes per step, then
+    the tail byte by byte. Only called once the CPU is known to have it.
+
+    Parameters:
+        crc: running value, already inverted.
+        p: bytes to add.
+        length: number of bytes.
+
+    Returns:
+        uint32_t: running value, still inverted.
+*/
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const unsigned char *p, size_t length) {
+    uint64_t wide = crc;
+    while (length >= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+        p += 8;
+        length -= 8;
+    }
+    crc = (uint32_t)wide;
+    while (length--) {
+        crc = _mm_crc32_u8(crc, *p++);
+    }
+    return crc;
+}
+#endif
+
+/*
+    Extends a CRC32C with more bytes, with the crc32 instruction when the
+    CPU supports SSE4.2 and the lookup table otherwise.
+
+    Parameters:
+        crc: CRC32C of the preceding bytes, 0 to start a new one.
+        data: bytes to add.
+        length: number of bytes.
+
+    Pre-conditions:
+        data must be readable for length bytes (may be NULL if length is 0).
+
+    Returns:
+        uint32_t: CRC32C of the preceding bytes followed by data.
+*/
+uint32_t crc32c(uint32_t crc, const void *data, size_t length) {
+    const unsigned char *p = data;
+    crc = ~crc;
+#ifdef CRC32C_HARDWARE
+    if (__builtin_cpu_supports("sse4.2")) return ~crc32c_sse42(crc, p, length);
+#endif
+    return ~crc32c_table(crc, p, length);
+}
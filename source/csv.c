@@ -0,0 +1,205 @@
+#include "csv.h"
+
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/*
+    Tells whether a character ends a field.
+
+    Parameters:
+        c: character to test.
+        delims: delimiter set.
+
+    Returns:
+        bool: true for ',' and '\n', and for ';' in the list set.
+*/
+static bool is_delimiter(char c, csv_delims delims) {
+    return c == ',' || c == '\n' || (c == ';' && delims == CSV_DELIMS_LIST);
+}
+
+/*
+    Scans for the first delimiter. Full vector blocks are compared against
+    the delimiters at once and the first match is found from the byte mask;
+    the tail shorter than a vector is scanned byte by byte. Outside the
+    list set the ';' lane compares against ',' again, so the loop is the
+    same for both sets.
+
+    Parameters:
+        p: first character to examine.
+        end: one past the last character.
+        delims: delimiter set.
+
+    Pre-conditions:
+        [p, end) must be readable.
+
+    Returns:
+        const char*: pointer to the delimiter, or end if none is found.
+*/
+const char *csv_find_delimiter(const char *p, const char *end, csv_delims delims) {
+    const char list_only = delims == CSV_DELIMS_LIST ? ';' : ',';
+#if defined(__AVX2__)
+    const __m256i comma = _mm256_set1_epi8(',');
+    const __m256i semicolon = _mm256_set1_epi8(list_only);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    while (end - p >= 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)p);
+        __m256i hits = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(block, comma), _mm256_cmpeq_epi8(block, semicolon)),
+            _mm256_cmpeq_epi8(block, newline));
+        unsigned int mask = (unsigned int)_mm256_movemask_epi8(hits);
+        if (mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+#elif defined(__SSE2__)
+    const __m128i comma = _mm_set1_epi8(',');
+    const __m128i semicolon = _mm_set1_epi8(list_only);
+    const __m128i newline = _mm_set1_epi8('\n');
+    while (end - p >= 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)p);
+        __m128i hits = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, semicolon)),
+            _mm_cmpeq_epi8(block, newline));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+        if (mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+#endif
+    while (p < end && !is_delimiter(*p, delims)) p++;
+    return p;
+}
+
+/*
+    Returns the span up to the next delimiter and advances past it.
+
+    Parameters:
+        rest: view to read from.
+        delim: output, the delimiter found or '\0' at the end of the view.
+        delims: delimiter set.
+
+    Pre-conditions:
+        rest and delim must not be NULL.
+
+    Returns:
+        str_view: the field.
+*/
+str_view csv_next_field(str_view *rest, char *delim, csv_delims delims) {
+    CHECK_NULL(rest);
+    CHECK_NULL(delim);
+
+    const char *end = rest->data + rest->length;
+    const char *p = csv_find_delimiter(rest->data, end, delims);
+    str_view field = { rest->data, (size_t)(p - rest->data) };
+
+    if (p < end) {
+        *delim = *p;
+        p++;
+    } else {
+        *delim = '\0';
+    }
+    rest->length = (size_t)(end - p);
+    rest->data = p;
+    return field;
+}
+
+/*
+    Reads and discards fields until the end of the line.
+
+    Parameters:
+        rest: view to advance.
+        delim: last delimiter read; '\n' or '\0' means the line is over.
+
+    Pre-conditions:
+        rest and delim must not be NULL.
+
+    Returns:
+        None.
+*/
+void csv_skip_line(str_view *rest, char *delim) {
+    CHECK_NULL(delim);
+    while (*delim != '\n' && *delim != '\0') {
+        csv_next_field(rest, delim, CSV_DELIMS_FIELD);
+    }
+}
+
+/*
+    Splits the current line on ',' into at most max_fields fields and skips
+    whatever is left of it.
+
+    Parameters:
+        rest: view to read from.
+        fields: output field spans.
+        max_fields: capacity of fields.
+
+    Pre-conditions:
+        rest and fields must not be NULL.
+
+    Returns:
+        int: number of fields stored.
+*/
+int csv_read_line(str_view *rest, str_view *fields, int max_fields) {
+    CHECK_NULL(rest);
+    CHECK_NULL(fields);
+    if (!rest->length) return 0;
+
+    int count = 0;
+    char delim = ',';
+    while (count < max_fields && delim != '\n' && delim != '\0') {
+        fields[count++] = csv_next_field(rest, &delim, CSV_DELIMS_FIELD);
+    }
+    csv_skip_line(rest, &delim);
+    return count;
+}
+
+/*
+    Tells whether a character is blank padding around a number.
+
+    Parameters:
+        c: character to test.
+
+    Returns:
+        bool: true for space, tab and carriage return.
+*/
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*
+    Parses an unsigned decimal number, rejecting empty fields, stray
+    characters and values larger than max.
+
+    Parameters:
+        view: characters to parse.
+        max: largest accepted value.
+        value: output value.
+
+    Pre-conditions:
+        value must not be NULL.
+
+    Returns:
+        bool: true if the view holds a valid number not above max.
+*/
+bool csv_parse_uint(str_view view, uint32_t max, uint32_t *value) {
+    CHECK_NULL(value);
+
+    const char *p = view.data;
+    const char *end = view.data + view.length;
+    while (p < end && is_blank(*p)) p++;
+    while (end > p && is_blank(end[-1])) end--;
+    if (p == end) return false;
+
+    uint64_t result = 0;
+    for (; p < end; p++) {
+        unsigned int digit = (unsigned char)*p - '0';
+        if (digit > 9) return false;
+        result = result * 10 + digit;
+        if (result > max) return false;
+    }
+
+    *value = (uint32_t)result;
+    return true;
+}
@@ -7,14 +7,6 @@
 #include <errno.h>
 #include <string.h>
 
-struct datetime {
-    int minute;
-    int hour;
-    int day;
-    int month;
-    int year;
-};
-
 /*
     Builds temporary integer arrays of [day, month, year] for each datetime,
     then iterates from year down to day comparing corresponding elements to
@@ -138,25 +130,25 @@ int compare_datetime(datetime_ptr datetime_one, datetime_ptr datetime_two) {
 }
 
 /*
-    Allocates a new datetime struct, retrieves the current system time,
-    converts to local time, and populates each field (minute, hour, day,
-    month, year) with proper adjustments (e.g., tm_mon + 1).
+    Fills an existing datetime with the current local date and time,
+    converting the fields of struct tm (e.g., tm_mon + 1).
 
     parameters:
-        None.
+        datetime: pointer to the datetime to fill, which may live on
+                  the stack or inside another record.
 
     pre-condition:
+        datetime must not be NULL.
         Standard time functions (time, localtime) succeed.
 
     post-condition:
-        A newly allocated datetime object contains the current local date and time.
+        datetime holds the current local date and time.
 
     return:
-        Pointer to the new datetime object, or exit if allocation fails.
+        None.
 */
-datetime_ptr get_datetime() {
-    struct datetime* new_datetime = malloc(sizeof(struct datetime));
-    CHECK_NULL(new_datetime);
+void init_datetime_now(datetime_ptr datetime) {
+    CHECK_NULL(datetime);
 
     time_t current_time;
     struct tm *local_time;
@@ -167,12 +159,33 @@ datetime_ptr get_datetime() {
     // Convert to local time format
     local_time = localtime(&current_time);
 
-    new_datetime->minute = local_time->tm_min; 
-    new_datetime->hour   = local_time->tm_hour;
-    new_datetime->day    = local_time->tm_mday;
-    new_datetime->month  = local_time->tm_mon + 1;  // tm_mon is 0–11
-    new_datetime->year   = local_time->tm_year + 1900; // tm_year is years since 1900
+    datetime->minute = local_time->tm_min; 
+    datetime->hour   = local_time->tm_hour;
+    datetime->day    = local_time->tm_mday;
+    datetime->month  = local_time->tm_mon + 1;  // tm_mon is 0–11
+    datetime->year   = local_time->tm_year + 1900; // tm_year is years since 1900
+}
+
+/*
+    Allocates a new datetime struct holding the current local date and
+    time. Like create_datetime it comes from mem_alloc and is released
+    with delete_datetime.
+
+    parameters:
+        None.
+
+    pre-condition:
+        Standard time functions (time, localtime) succeed.
+
+    post-condition:
+        A newly allocated datetime object contains the current local date and time.
 
+    return:
+        Pointer to the new datetime object, or exit if allocation fails.
+*/
+datetime_ptr get_datetime() {
+    struct datetime* new_datetime = mem_alloc(MEM_TAG_DATETIME, sizeof(struct datetime));
+    init_datetime_now(new_datetime);
     return new_datetime;
 }
 
@@ -197,28 +210,54 @@ int get_datetime_field(datetime_ptr datetime, char* field) {
         year   — year value to store in the struct
 
     pre-condition:
-        malloc must succeed in allocating sizeof(struct datetime) bytes.
+        mem_alloc must succeed in allocating sizeof(struct datetime) bytes.
 
     post-condition:
         The returned struct pointer has all fields set;
-        upon allocation failure, the program exits (via CHECK_NULL).
+        upon allocation failure, the program exits.
 
     return:
         Pointer to the allocated and populated datetime struct.
 */
 datetime_ptr create_datetime(int minute, int hour, int day, int month, int year) {
-    struct datetime* new_datetime = malloc(sizeof(struct datetime));
-    CHECK_NULL(new_datetime);
+    struct datetime* new_datetime = mem_alloc(MEM_TAG_DATETIME, sizeof(struct datetime));
 
-    new_datetime->minute = minute;
-    new_datetime->hour = hour;
-    new_datetime->day = day;
-    new_datetime->month = month;
-    new_datetime->year = year;
+    init_datetime(new_datetime, minute, hour, day, month, year);
 
     return new_datetime;
 }
 
+/*
+    Assigns each struct member of an already allocated datetime from
+    the corresponding parameter.
+
+    parameters:
+        datetime — pointer to the datetime to fill
+        minute   — minute value to store in the struct
+        hour     — hour value to store in the struct
+        day      — day value to store in the struct
+        month    — month value to store in the struct
+        year     — year value to store in the struct
+
+    pre-condition:
+        datetime must be non-NULL.
+
+    post-condition:
+        All fields of datetime are set.
+
+    return:
+        Nothing.
+*/
+void init_datetime(datetime_ptr datetime, int minute, int hour, int day, int month, int year) {
+    CHECK_NULL(datetime);
+
+    datetime->minute = minute;
+    datetime->hour = hour;
+    datetime->day = day;
+    datetime->month = month;
+    datetime->year = year;
+}
+
 /*
     Print the datetime object.
 
@@ -256,7 +295,7 @@ void print_datetime(FILE* file, datetime_ptr datetime) {
         datetime: pointer to the datetime object to delete.
 
     pre-condition:
-        datetime must be non-NULL and previously allocated by get_datetime().
+        datetime must be non-NULL and allocated by get_datetime() or create_datetime().
 
     post-condition:
         The memory for the datetime object is released. The pointer becomes invalid.
@@ -265,5 +304,5 @@ void print_datetime(FILE* file, datetime_ptr datetime) {
         Nothing.
 */
 void delete_datetime(datetime_ptr datetime) {
-    free(datetime);
+    mem_free(datetime);
 }
\ No newline at end of file
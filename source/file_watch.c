@@ -0,0 +1,108 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "file_watch.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+struct file_watch {
+    int fd;
+    // file name inside the watched directory
+    char *name;
+};
+
+/*
+    Starts watching a file.
+
+    Parameters:
+        filepath: path of the file; it need not exist yet.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Returns:
+        file_watch_ptr: the watch, or NULL if inotify is not available.
+*/
+file_watch_ptr file_watch_open(const char *filepath) {
+    CHECK_NULL(filepath);
+
+    char directory[512];
+    const char *slash = strrchr(filepath, '/');
+    const char *name = slash ? slash + 1 : filepath;
+    size_t length = slash ? (size_t)(slash - filepath) : 1;
+    if (length == 0) length = 1;  // file in "/"
+    if (length >= sizeof(directory)) return NULL;
+    memcpy(directory, slash ? filepath : ".", length);
+    directory[length] = '\0';
+
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return NULL;
+    if (inotify_add_watch(fd, directory, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        close(fd);
+        return NULL;
+    }
+
+    file_watch_ptr watch = mem_alloc(MEM_TAG_IO, sizeof(*watch));
+    watch->fd = fd;
+    watch->name = mem_alloc(MEM_TAG_IO, strlen(name) + 1);
+    strcpy(watch->name, name);
+    return watch;
+}
+
+/*
+    Tells whether the file changed since the previous call, consuming
+    all the pending notifications.
+
+    Parameters:
+        watch: the watch.
+
+    Pre-conditions:
+        watch must not be NULL.
+
+    Returns:
+        bool: true if the file was written or replaced.
+*/
+bool file_watch_changed(file_watch_ptr watch) {
+    CHECK_NULL(watch);
+
+    // events are variable-length records aligned like struct inotify_event
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    for (;;) {
+        ssize_t n = read(watch->fd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        for (char *p = buffer; p < buffer + n; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            if (event->len > 0 && strcmp(event->name, watch->name) == 0) changed = true;
+            // the queue overflowed: the file may be among the lost events
+            if (event->mask & IN_Q_OVERFLOW) changed = true;
+            p += sizeof(*event) + event->len;
+        }
+    }
+    return changed;
+}
+
+/*
+    Stops watching and frees the watch.
+
+    Parameters:
+        watch: the watch.
+
+    Pre-conditions:
+        watch must not be NULL.
+
+    Post-conditions:
+        The watch must not be used anymore.
+*/
+void file_watch_close(file_watch_ptr watch) {
+    CHECK_NULL(watch);
+    close(watch->fd);
+    mem_free(watch->name);
+    mem_free(watch);
+}
@@ -12,7 +12,8 @@ struct frequentation {
 
 /*
     Creates a new frequentation object with specified values.
-    Allocates and copies course_name.
+    The course_name is interned and shared with the course catalog.
+    The object is session-scoped (see session_alloc).
 
     Parameters:
         course_id: ID of the course.
@@ -29,14 +30,11 @@ struct frequentation {
         pointer to the new frequentation.
 */
 frequentation_ptr create_frequentation(uint16_t course_id, char *course_name, uint16_t times_booked) {
-    frequentation_ptr new_frequentation = malloc(sizeof(struct frequentation));
-    CHECK_NULL(new_frequentation);
+    frequentation_ptr new_frequentation = session_alloc(MEM_TAG_FREQUENTATION, sizeof(struct frequentation));
 
     new_frequentation->course_id = course_id;
 
-    new_frequentation->course_name = malloc(strlen(course_name) + 1);
-    CHECK_NULL(new_frequentation->course_name);
-    strcpy(new_frequentation->course_name, course_name);
+    new_frequentation->course_name = str_intern(course_name);
 
     new_frequentation->times_booked = times_booked;
 
@@ -44,25 +42,27 @@ frequentation_ptr create_frequentation(uint16_t course_id, char *course_name, ui
 }
 
 /*
-    Writes frequentation data to a file in CSV format.
+    Writes frequentation data to a user file as an "id:count," pair.
+    The course name is not saved, it is taken from the catalog on load.
 
     Parameters:
-        file: output file pointer.
+        out: output buffer of the user file.
         element: void pointer to frequentation.
 
     Returns:
         None.
 */
-void save_frequentation_callback(FILE *file, void *element) {
+void save_frequentation_callback(out_buffer_ptr out, void *element) {
     frequentation_ptr frequentation = (frequentation_ptr)element;
-    fprintf(file, "%d,%s,%d,",
-            get_frequentation_id(frequentation),
-            get_frequentation_name(frequentation),
-            get_frequentation_times_booked(frequentation));
+    out_append_uint(out, get_frequentation_id(frequentation));
+    out_append_char(out, ':');
+    out_append_uint(out, get_frequentation_times_booked(frequentation));
+    out_append_char(out, ',');
 }
 
 /*
-    Frees memory allocated for frequentation and its course_name string.
+    Frees memory allocated for frequentation.
+    The interned course_name is left in the intern table.
 
     Parameters:
         element: void pointer to frequentation.
@@ -72,9 +72,7 @@ void save_frequentation_callback(FILE *file, void *element) {
 */
 void delete_frequentation(void* element) {
     if (!element) return;
-    frequentation_ptr f = (frequentation_ptr)element;
-    free(f->course_name);
-    free(f);
+    session_free(element);
 }
 
 /*
@@ -97,7 +95,7 @@ uint16_t get_frequentation_id(frequentation_ptr frequentation) {
         frequentation: pointer to frequentation.
 
     Returns:
-        course name string.
+        interned course name string.
 */
 char* get_frequentation_name(frequentation_ptr frequentation) {
     return frequentation->course_name;
@@ -130,6 +128,26 @@ void set_frequentation_times_booked(frequentation_ptr frequentation, int value)
     frequentation->times_booked = value;
 }
 
+/*
+    Tells whether a history entry is the placeholder written for users
+    without history ("0,"",0," or similar).
+
+    Parameters:
+        entry: frequentation to test, may be NULL.
+
+    Returns:
+        bool: true if the entry is NULL or effectively empty.
+*/
+static bool is_empty_entry(frequentation_ptr entry) {
+    return entry == NULL ||
+        (entry->course_id == 0 &&
+         entry->times_booked == 0 &&
+         (entry->course_name == NULL ||
+          strcmp(entry->course_name, "") == 0 ||
+          strcmp(entry->course_name, "0") == 0 ||
+          strcmp(entry->course_name, "\"\"") == 0));
+}
+
 /*
     Prints a formatted frequentation entry to a file if entry is valid.
 
@@ -144,16 +162,38 @@ void print_frequentation_callback(FILE* file, void* element) {
     frequentation_ptr entry = (frequentation_ptr)element;
 
     // Check if entry is effectively empty/null
-    if (entry == NULL ||
-        (entry->course_id == 0 &&
-         entry->times_booked == 0 &&
-         (entry->course_name == NULL ||
-          strcmp(entry->course_name, "") == 0 ||
-          strcmp(entry->course_name, "0") == 0 ||
-          strcmp(entry->course_name, "\"\"") == 0))) {
+    if (is_empty_entry(entry)) {
         return;
     }
 
     fprintf(file, "History Entry - ID: %hu, Name: %s, Times Booked: %hu\n",
             entry->course_id, entry->course_name, entry->times_booked);
-}
\ No newline at end of file
+}
+
+/*
+    Writes a formatted frequentation entry to a report if entry is valid,
+    with the same text print_frequentation_callback prints.
+
+    Parameters:
+        out: output buffer of the report file.
+        element: void pointer to frequentation.
+
+    Returns:
+        None.
+*/
+void report_frequentation_callback(out_buffer_ptr out, void* element) {
+    frequentation_ptr entry = (frequentation_ptr)element;
+
+    // Check if entry is effectively empty/null
+    if (is_empty_entry(entry)) {
+        return;
+    }
+
+    out_append_string(out, "History Entry - ID: ");
+    out_append_uint(out, entry->course_id);
+    out_append_string(out, ", Name: ");
+    out_append_string(out, entry->course_name);
+    out_append_string(out, ", Times Booked: ");
+    out_append_uint(out, entry->times_booked);
+    out_append_char(out, '\n');
+}
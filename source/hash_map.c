@@ -58,15 +58,45 @@ static uint16_t hash_function(uint16_t key, uint16_t size) {
         hash_map_ptr: pointer to the newly created hash map.
 */
 hash_map_ptr create_hash_map(uint16_t size) {
-    hash_map_ptr map = malloc(sizeof(*map));
-    CHECK_NULL(map);
+    hash_map_ptr map = mem_alloc(MEM_TAG_HASH_MAP, sizeof(*map));
     map->size = size;
     map->count = 0;
-    map->table = calloc(size, sizeof(*map->table));
-    CHECK_NULL(map->table);
+    map->table = mem_calloc(MEM_TAG_HASH_MAP, size, sizeof(*map->table));
     return map;
 }
 
+/*
+    Doubles the table (up to UINT16_MAX slots) and reinserts every entry.
+
+    Parameters:
+        map: pointer to the hash map.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Post-conditions:
+        The map holds the same entries in a larger table.
+
+    Returns:
+        None.
+*/
+static void grow_hash_map(hash_map_ptr map) {
+    uint16_t old_size = map->size;
+    item_ptr old_table = map->table;
+
+    map->size = old_size > UINT16_MAX / 2 ? UINT16_MAX : (uint16_t)(old_size * 2);
+    map->table = mem_calloc(MEM_TAG_HASH_MAP, map->size, sizeof(*map->table));
+    for (uint16_t i = 0; i < old_size; ++i) {
+        if (!old_table[i].is_occupied) continue;
+        uint16_t idx = hash_function(old_table[i].key, map->size);
+        while (map->table[idx].is_occupied) {
+            idx = (uint16_t)((idx + 1) % map->size);
+        }
+        map->table[idx] = old_table[i];
+    }
+    mem_free(old_table);
+}
+
 /*
     Inserts a course into the hash map, or replaces an existing one with the same key.
 
@@ -81,16 +111,21 @@ hash_map_ptr create_hash_map(uint16_t size) {
 
     Post-conditions:
         The course is inserted or replaces an existing entry with the same key.
+        A table more than three quarters full is doubled first.
 
     Returns:
-        None.
+        course_ptr: the course replaced, which is not freed since the
+        catalog array may still hold it, or NULL.
 */
-void insert_course(hash_map_ptr map, uint16_t key, course_ptr value) {
+course_ptr insert_course(hash_map_ptr map, uint16_t key, course_ptr value) {
     CHECK_NULL(map);
     CHECK_NULL(value);
+    if ((uint32_t)(map->count + 1) * 4 > (uint32_t)map->size * 3 && map->size < UINT16_MAX) {
+        grow_hash_map(map);
+    }
     if (map->count >= map->size) {
         fprintf(stderr, "Hash map full, cannot insert key %u\n", key);
-        return;
+        return NULL;
     }
 
     uint16_t start = hash_function(key, map->size);
@@ -103,17 +138,18 @@ void insert_course(hash_map_ptr map, uint16_t key, course_ptr value) {
             slot->value = value;
             slot->is_occupied = true;
             map->count++;
-            return;
+            return NULL;
         }
 
         if (slot->key == key) {
-            delete_course(slot->value);
+            course_ptr replaced = slot->value;
             slot->value = value;
-            return;
+            return replaced;
         }
     }
 
     fprintf(stderr, "Hash map probing failed, map may be full.\n");
+    return NULL;
 }
 
 /*
@@ -152,6 +188,237 @@ course_ptr get_course(hash_map_ptr map, uint16_t key) {
     return NULL;
 }
 
+/*
+    Tells whether the home slot of a key lies cyclically in (from, to].
+
+    Parameters:
+        home: home slot of the key.
+        from: first slot, excluded.
+        to: last slot, included.
+
+    Returns:
+        bool: true if a probe for the key passes slot from before reaching to.
+*/
+static bool home_in_range(uint16_t home, uint16_t from, uint16_t to) {
+    return from <= to ? (from < home && home <= to) : (from < home || home <= to);
+}
+
+/*
+    Removes a course from the hash map by its key. The entries following
+    it in the probe run are shifted back over the freed slot (backward
+    shift deletion), so no tombstone is left and lookups stay as short as
+    if the key had never been inserted.
+
+    Parameters:
+        map: pointer to the hash map.
+        key: the course ID to remove.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Post-conditions:
+        The key is no longer in the map; the course itself is not freed.
+
+    Returns:
+        course_ptr: the removed course, or NULL if the key was not in the map.
+*/
+course_ptr remove_course(hash_map_ptr map, uint16_t key) {
+    CHECK_NULL(map);
+
+    int found = get_course_slot(map, key);
+    if (found < 0) return NULL;
+
+    uint16_t hole = (uint16_t)found;
+    course_ptr removed = map->table[hole].value;
+    // a full table has no empty slot to stop at: one lap at most
+    uint16_t next = hole;
+    for (uint16_t step = 1; step < map->size; ++step) {
+        next = (uint16_t)((next + 1) % map->size);
+        if (!map->table[next].is_occupied) break;
+        // an entry whose home is between the hole and itself must stay
+        if (home_in_range(hash_function(map->table[next].key, map->size), hole, next)) continue;
+        map->table[hole] = map->table[next];
+        hole = next;
+    }
+
+    memset(&map->table[hole], 0, sizeof(map->table[hole]));
+    map->count--;
+    return removed;
+}
+
+/*
+    Returns the number of slots of the hash map.
+
+    Parameters:
+        map: pointer to the hash map.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Returns:
+        uint16_t: the table size.
+*/
+uint16_t get_hash_map_size(hash_map_ptr map) {
+    CHECK_NULL(map);
+    return map->size;
+}
+
+/*
+    Finds the slot where a key is stored, following the same probe
+    sequence used by insert_course.
+
+    Parameters:
+        map: pointer to the hash map.
+        key: the course ID to look up.
+
+    Pre-conditions:
+        map must not be NULL.
+
+    Post-conditions:
+        None.
+
+    Returns:
+        int: the slot index, or -1 if the key is not in the map.
+*/
+int get_course_slot(hash_map_ptr map, uint16_t key) {
+    CHECK_NULL(map);
+
+    uint16_t start = hash_function(key, map->size);
+    for (uint16_t i = 0; i < map->size; ++i) {
+        uint16_t idx = (start + i) % map->size;
+        item_ptr slot = &map->table[idx];
+
+        if (!slot->is_occupied) {
+            return -1;
+        }
+
+        if (slot->key == key) {
+            return idx;
+        }
+    }
+
+    return -1;
+}
+
+/*
+    Describes the table layout for persistence: for every slot, the
+    position + 1 of its course in the catalog array, or 0 if it is empty.
+
+    Parameters:
+        map: pointer to the hash map.
+        array: catalog array holding the same courses.
+        slots: output, receives one entry per slot of the map.
+
+    Pre-conditions:
+        map and array must not be NULL; slots must hold map->size entries.
+
+    Post-conditions:
+        Courses of the array missing from the map are not referenced.
+
+    Returns:
+        None.
+*/
+void export_hash_map_layout(hash_map_ptr map, array_ptr array, uint16_t *slots) {
+    CHECK_NULL(map);
+    CHECK_NULL(array);
+    CHECK_NULL(slots);
+
+    memset(slots, 0, map->size * sizeof(*slots));
+    for (uint16_t i = 0; i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        int slot = get_course_slot(map, get_course_id(course));
+        if (slot >= 0 && map->table[slot].value == course) {
+            slots[slot] = (uint16_t)(i + 1);
+        }
+    }
+}
+
+/*
+    Checks that every entry of the table is found by get_course: the
+    slots from the home slot of its key up to its own slot are occupied,
+    and none of them holds the same key. A table written with another
+    hash function or size fails, and so does a table with a repeated key.
+
+    Parameters:
+        map: pointer to the hash map.
+
+    Returns:
+        bool: true if every key is reachable by probing from its home slot.
+*/
+static bool probe_chains_are_valid(hash_map_ptr map) {
+    for (uint16_t slot = 0; slot < map->size; slot++) {
+        if (!map->table[slot].is_occupied) continue;
+
+        uint16_t key = map->table[slot].key;
+        uint16_t idx = hash_function(key, map->size);
+        while (idx != slot) {
+            if (!map->table[idx].is_occupied || map->table[idx].key == key) return false;
+            idx = (uint16_t)((idx + 1) % map->size);
+        }
+    }
+    return true;
+}
+
+/*
+    Restores a table layout saved by export_hash_map_layout in one pass:
+    every slot is filled straight from the array, with no hashing or
+    probing. The layout is checked to reference each course exactly once,
+    and every course must then be reachable from the home slot of its id.
+
+    Parameters:
+        map: pointer to an empty hash map of the saved size.
+        array: catalog array in the saved order.
+        slots: saved layout, one entry per slot of the map.
+
+    Pre-conditions:
+        map, array and slots must not be NULL.
+
+    Post-conditions:
+        On success every course of the array is in its saved slot;
+        on failure the map is left empty.
+
+    Returns:
+        bool: false if the layout does not match the array.
+*/
+bool import_hash_map_layout(hash_map_ptr map, array_ptr array, const uint16_t *slots) {
+    CHECK_NULL(map);
+    CHECK_NULL(array);
+    CHECK_NULL(slots);
+
+    uint16_t courses = get_size(array);
+    if (map->count != 0 || courses > map->size) return false;
+
+    // one bit per array position, to catch a course placed twice
+    uint8_t *placed = mem_calloc(MEM_TAG_HASH_MAP, courses / 8 + 1, 1);
+    bool valid = true;
+    for (uint16_t slot = 0; slot < map->size && valid; slot++) {
+        uint16_t position = slots[slot];
+        if (!position) continue;
+
+        uint16_t i = (uint16_t)(position - 1);
+        uint8_t mask = (uint8_t)(1u << (i % 8));
+        if (position > courses || (placed[i / 8] & mask)) {
+            valid = false;
+            break;
+        }
+        placed[i / 8] |= mask;
+
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        map->table[slot].key = get_course_id(course);
+        map->table[slot].value = course;
+        map->table[slot].is_occupied = true;
+        map->count++;
+    }
+    mem_free(placed);
+
+    if (!valid || map->count != courses || !probe_chains_are_valid(map)) {
+        memset(map->table, 0, map->size * sizeof(*map->table));
+        map->count = 0;
+        return false;
+    }
+    return true;
+}
+
 /*
     Deletes the entire hash map and optionally all course objects it contains.
 
@@ -174,8 +441,8 @@ void delete_hash_map(hash_map_ptr map, bool delete_elements) {
     CHECK_NULL(map);
 
     if (!delete_elements) {
-        free(map->table);
-        free(map);
+        mem_free(map->table);
+        mem_free(map);
         return;
     }
 
@@ -185,6 +452,6 @@ void delete_hash_map(hash_map_ptr map, bool delete_elements) {
         }
     }
 
-    free(map->table);
-    free(map);
+    mem_free(map->table);
+    mem_free(map);
 }
\ No newline at end of file
@@ -16,6 +16,7 @@ struct linked_list {
 
 /*
     Allocates and initializes memory for a new linked list struct with head set to NULL and element count zero.
+    Lists and their nodes are session-scoped: inside a session they live in the session arena.
 
     parameters:
         none
@@ -30,8 +31,7 @@ struct linked_list {
         linked_list_ptr: pointer to the newly created list.
 */
 linked_list_ptr ll_create() {
-    struct linked_list* new_booking_list = malloc(sizeof(struct linked_list));
-    CHECK_NULL(new_booking_list);
+    struct linked_list* new_booking_list = session_alloc(MEM_TAG_LINKED_LIST, sizeof(struct linked_list));
 
     new_booking_list->head = NULL;
     new_booking_list->element_count = 0;
@@ -57,8 +57,7 @@ linked_list_ptr ll_create() {
         None
 */
 void ll_add(linked_list_ptr linked_list, void* element) {
-    struct node* new_booking = malloc(sizeof(struct node));
-    CHECK_NULL(new_booking);
+    struct node* new_booking = session_alloc(MEM_TAG_LINKED_LIST, sizeof(struct node));
     new_booking->element = element;
     new_booking->next = NULL;
 
@@ -220,7 +219,7 @@ void ll_delete_at(linked_list_ptr linked_list,
     if (delete_function) {
         delete_function(to_delete->element);
     }
-    free(to_delete);
+    session_free(to_delete);
     linked_list->element_count--;
 }
 
@@ -253,7 +252,7 @@ void ll_delete_element(linked_list_ptr linked_list,
     if (current != NULL && compare_function(current->element, element)) {
         linked_list->head = current->next;
         delete_function(current->element);
-        free(current);
+        session_free(current);
         linked_list->element_count--;
         return;
     }
@@ -263,7 +262,7 @@ void ll_delete_element(linked_list_ptr linked_list,
             struct node* to_delete = current->next;
             current->next = to_delete->next;
             delete_function(to_delete->element);
-            free(to_delete);
+            session_free(to_delete);
             linked_list->element_count--;
             return;
         }
@@ -290,7 +289,7 @@ void ll_delete_element(linked_list_ptr linked_list,
 */
 void ll_delete_list(linked_list_ptr linked_list, void (*delete_function)(void* element)) {
     if (!delete_function) {
-        free(linked_list);
+        session_free(linked_list);
         return;
     }
     
@@ -300,10 +299,10 @@ void ll_delete_list(linked_list_ptr linked_list, void (*delete_function)(void* e
         struct node* to_delete = current;
         current = current->next;
         delete_function(to_delete->element);
-        free(to_delete);
+        session_free(to_delete);
     }
 
-    free(linked_list);
+    session_free(linked_list);
 }
 
 /*
@@ -330,4 +329,30 @@ void ll_print(linked_list_ptr linked_list,  FILE* file, void (*print_function)(F
         print_function(file, current->element);
         current = current->next;
     }
-}
\ No newline at end of file
+}
+
+/*
+    Walks through each node in the list and uses the provided write function to append the element.
+
+    parameters:
+        linked_list: valid (non-NULL) pointer to the list.
+        out: output buffer in which the write function appends.
+        write_function: valid function pointer to write a node's element.
+
+    pre-condition:
+        All parameters must be valid and non-NULL.
+
+    post-condition:
+        The list is unchanged; output is appended to the buffer.
+
+    return:
+        None
+*/
+void ll_write(linked_list_ptr linked_list, out_buffer_ptr out, void (*write_function)(out_buffer_ptr out, void* element)) {
+    struct node* current = linked_list->head;
+
+    while (current != NULL) {
+        write_function(out, current->element);
+        current = current->next;
+    }
+}
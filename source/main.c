@@ -11,6 +11,11 @@ int main(void){
     linked_list_ptr booked_list = NULL;
     linked_list_ptr history_list = NULL;
 
+    // Print per-subsystem memory usage at exit when requested
+    if (getenv("MYFITNESS_MEM_STATS")) {
+        mem_dump_stats_at_exit();
+    }
+
     int action = 0;
     printf("Select action:\n");
     printf("1. Register new user\n");
@@ -22,26 +27,43 @@ int main(void){
     }
     getchar(); // consume newline
 
+    // All users live in one indexed store
+    user_store_ptr store = user_store_open(USER_STORE_PATH, USER_INDEX_PATH);
+
     if (action == 1) {
-        registration_user();
+        registration_user(store);
         // After registration, proceed to login
     }
 
     char *username = NULL;
     while (!username) {
-        username = login_user();
+        username = login_user(store);
         if (!username) {
             printf("Login failed. Try again.\n");
         }
     }
 
     // Load courses and logged user data
-    load_courses(COURSE_PATH, &array, &hash_map);
+    load_catalog(COURSE_SNAPSHOT_PATH, COURSE_PATH, &array, &hash_map);
+    if (!seat_counters_open(SEAT_COUNTERS_PATH, COURSE_PATH, array)) {
+        fprintf(stderr, "Seat counters unavailable, the catalog will be saved in full.\n");
+    }
+    // Edits to the text catalog are applied between menu actions
+    catalog_watch_open(COURSE_PATH);
 
-    char user_filepath[192] = {0};
-    snprintf(user_filepath, sizeof(user_filepath), "%s%s.txt", USERS_PATH, username);
-    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
-    free(username);
+    uint32_t user_stamp;
+    user = load_user_from_store(store, username, &booked_list, &history_list, &hash_map, &user_stamp);
+
+    // Redo what a crashed session did not save, then log the new session
+    char log_filepath[512] = {0};
+    if (!user_file_path(log_filepath, sizeof(log_filepath), USERS_PATH, username, BOOKING_LOG_SUFFIX)
+        || !user_file_dirs(USERS_PATH, username)) {
+        fprintf(stderr, "Cannot create the user directory of %s.\n", username);
+        exit(1);
+    }
+    replay_booking_log(log_filepath, user_stamp, booked_list, history_list, hash_map, user);
+    booking_log_open(log_filepath, user_stamp);
+    mem_free(username);
 
     int choice;
     do {
@@ -53,6 +75,8 @@ int main(void){
         printf("5. Cancel a booked course\n");
         printf("6. Check if subscription is valid\n");
         printf("7. Show last report\n");
+        printf("8. Back up in the background\n");
+        printf("9. Manage courses\n");
         printf("0. Exit\n");
         printf("Enter your choice: ");
         scanf("%d", &choice);
@@ -61,20 +85,27 @@ int main(void){
         switch (choice) {
         case 1: action_print_all_courses(array);       break;
         case 2: action_show_booked_courses(booked_list, user);  break;
-        case 3: action_show_history(history_list);    break;
+        case 3: action_show_history(history_list, user);    break;
         case 4:
             uint16_t course_id;
             printf("Enter course ID to book: ");
             if (scanf("%hu", &course_id) != 1) { getchar(); exit(1); }
             getchar(); 
 
+            // the durability future is not waited on: the menu never blocks on the disk
             action_book_course(course_id, booked_list, history_list, hash_map, user); break;
-        case 5: action_cancel_course(booked_list, history_list); break;
+        case 5: action_cancel_course(booked_list, history_list, user); break;
         case 6: action_check_subscription(user);      break;
         case 7: action_show_last_report(user);        break;
-        case 0: action_exit_and_save(hash_map, array, booked_list, history_list, user); break;
+        case 8: action_background_backup(hash_map, array, booked_list, history_list, user); break;
+        case 9: action_manage_courses(hash_map, array, user); break;
+        case 0: action_exit_and_save(store, hash_map, array, booked_list, history_list, user); break;
         default: printf("Invalid choice. Try again.\n");
         }
+        if (choice != 0) {
+            catalog_reload_tick(COURSE_PATH, hash_map, array);
+            background_backup_tick(hash_map, array, booked_list, history_list, user);
+        }
     } while (choice != 0); 
     return 0;
 }
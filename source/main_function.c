@@ -1,127 +1,306 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "main_functions.h"
 
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Catalog the course names of the history are taken from, set by load_user */
+static hash_map_ptr history_catalog;
+
+/* Session state the background backup is taken from, and when the last one started */
+static struct {
+    array_ptr array;
+    hash_map_ptr map;
+    linked_list_ptr booked;
+    linked_list_ptr history;
+    user_ptr user;
+} backup_source;
+static time_t last_backup;
+
+/* Hot reload of the text catalog: the watch and the hash of the line each
+   live course was read from (by id, 0 for none) */
+static file_watch_ptr catalog_watch;
+static uint32_t *catalog_lines;
+
+/* The body of the text catalog as last applied, with its count of records
+   and the cap of its header: the next reload only parses the lines between
+   the first and the last that differ from it; not valid once the courses
+   are administered */
+static char *catalog_text;
+static size_t catalog_text_length;
+static uint32_t catalog_text_records;
+static uint32_t catalog_text_limit;
+static bool catalog_text_valid;
+
+/* Courses were administered during the session: the text catalog is
+   written at exit */
+static bool catalog_administered;
+
+/* Tells whether a history line uses "id:count," pairs rather than the old "id,name,times," triples */
+static bool is_pair_history(const char *text, size_t length){
+    const char *end = csv_find_delimiter(text, text + length, CSV_DELIMS_LIST);
+    return memchr(text, ':', (size_t)(end - text)) != NULL;
+}
+
+/* Parses a history line of "id:count," pairs; "id,name,times," triples of older files are accepted too */
+static void parse_history(record_reader_ptr reader, linked_list_ptr history_list){
+    char delim = ',';
+    while (delim != '\n' && delim != '\0'){
+        str_view id_hist = record_reader_field(reader, &delim, CSV_DELIMS_LIST);
+        if (!id_hist.length && delim != ',')
+            break; // trailing newline
+        uint32_t course_id;
+        uint32_t times_booked;
+        char *name = NULL;
+
+        const char *colon = memchr(id_hist.data, ':', id_hist.length);
+        if (colon){
+            str_view id_view = { id_hist.data, (size_t)(colon - id_hist.data) };
+            str_view times_view = { colon + 1, id_hist.length - id_view.length - 1 };
+            if (!csv_parse_uint(id_view, UINT16_MAX, &course_id)
+                || !csv_parse_uint(times_view, UINT16_MAX, &times_booked)){
+                fprintf(stderr, "Malformed history\n");
+                exit(1);
+            }
+        } else {
+            if (!csv_parse_uint(id_hist, UINT16_MAX, &course_id) || delim != ','){
+                fprintf(stderr, "Malformed history\n");
+                exit(1);
+            }
+
+            // the saved name is only kept for courses no longer in the catalog
+            str_view name_hist = record_reader_field(reader, &delim, CSV_DELIMS_FIELD);
+            if (delim != ','){
+                fprintf(stderr, "Malformed history\n");
+                exit(1);
+            }
+            if (!history_catalog || !get_course(history_catalog, (uint16_t)course_id))
+                name = str_intern_n(name_hist.data, name_hist.length);
+
+            // leggo times
+            if (!csv_parse_uint(record_reader_field(reader, &delim, CSV_DELIMS_LIST), UINT16_MAX, &times_booked)){
+                fprintf(stderr, "Malformed history\n");
+                exit(1);
+            }
+        }
+
+        // "0:0," (or "0,,0,") only marks an empty history
+        if (!times_booked)
+            continue;
+        if (!name){
+            course_ptr course = history_catalog ? get_course(history_catalog, (uint16_t)course_id) : NULL;
+            name = course ? get_course_name(course) : str_intern("");
+        }
+
+        frequentation_ptr frequentation = create_frequentation(
+            (uint16_t)course_id,
+            name,
+            (uint16_t)times_booked);
+
+        ll_add(history_list, frequentation);
+    }
+}
+
+/* Builds the history list from the line kept by load_user, the first time it is needed */
+static void materialize_history(user_ptr user, linked_list_ptr history_list){
+    size_t length;
+    char *text = get_user_history_text(user, &length);
+    if (!text)
+        return;
+
+    record_reader_ptr reader = record_reader_from_memory(text, length);
+    parse_history(reader, history_list);
+    record_reader_close(reader);
+    set_user_history_text(user, NULL, 0);
+    session_free(text);
+}
+
 /* 1. Print all available courses */
 void action_print_all_courses(array_ptr array) {
     printf("\n--- Available Courses ---\n");
     array_print(array, stdout, print_course_callback);
 }
 
+/* Booked lists hold course handles, stored in the element pointer itself */
+static void *booked_element(course_ptr course){
+    return (void *)(uintptr_t)get_course_handle(course);
+}
+
+/* The course of a booked list element, NULL once it left the catalog */
+static course_ptr booked_course(void *element){
+    return resolve_course_handle((course_handle)(uintptr_t)element);
+}
+
+/* ll_search comparator: a booked list element against a course id */
+static int compare_booked_id(void *element, void *course_id){
+    course_ptr course = booked_course(element);
+    return course && get_course_id(course) == *(uint16_t *)course_id;
+}
+
+/* Prints a booked course, bookings of removed courses are skipped */
+static void print_booked_callback(FILE *file, void *element){
+    course_ptr course = booked_course(element);
+    if (course)
+        print_course_callback(file, course);
+}
+
+/* Writes the id of a booked course, bookings of removed courses are dropped */
+static void save_booked_callback(out_buffer_ptr out, void *element){
+    course_ptr course = booked_course(element);
+    if (course)
+        save_booking_callback(out, course);
+}
+
 /* 2. Show my booked courses */
 void action_show_booked_courses(linked_list_ptr booked_list, user_ptr user) {
-    if (compare_datetime(get_datetime(),
+    struct datetime now;
+    init_datetime_now(&now);
+    if (compare_datetime(&now,
         get_subscription_end_date(get_user_subscription(user))) == 1)
     {
         printf("Subscription has expired.\n");
         return;
     }
     printf("\n--- Booked Courses ---\n");
-    ll_print(booked_list, stdout, print_course_callback);
+    ll_print(booked_list, stdout, print_booked_callback);
 }
 
 /* 3. Show course history */
-void action_show_history(linked_list_ptr history_list) {
+void action_show_history(linked_list_ptr history_list, user_ptr user) {
+    materialize_history(user, history_list);
     printf("\n--- Course History ---\n");
     ll_print(history_list, stdout, print_frequentation_callback);
 }
 
-/* 4. Book a course */
-void action_book_course(int course_id, 
+/* Books a course for the user: shared by action_book_course and log replay,
+   which leaves the seat alone when the sidecar already counts it */
+static void book_course(course_ptr course, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user, bool take_seat){
+    ll_add(booked_list, booked_element(course));
+    if (take_seat) {
+        set_course_seats_booked(course,
+            get_course_seats_booked(course) + 1);
+        seat_counters_mark(course);
+    }
+
+    /* Update history */
+    materialize_history(user, history_list);
+    int idx = ll_search(history_list, course, compare_course_id);
+    if (idx == -1) {
+        frequentation_ptr f = create_frequentation(
+            get_course_id(course),
+            get_course_name(course),
+            1
+        );
+        ll_add(history_list, f);
+    } else {
+        frequentation_ptr *fp =
+            (frequentation_ptr*)ll_get_at(history_list, idx);
+        set_frequentation_times_booked(
+           *fp,
+           get_frequentation_times_booked(*fp) + 1
+        );
+    }
+}
+
+/* Cancels the booking at idx: shared by action_cancel_course and log replay,
+   which leaves the seat alone when the sidecar already counts it */
+static void cancel_course(int idx, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user, bool free_seat){
+    course_ptr course = booked_course(*ll_get_at(booked_list, idx));
+    ll_delete_at(booked_list, idx, NULL);
+    if (free_seat) {
+        set_course_seats_booked(course,
+            get_course_seats_booked(course) - 1);
+        seat_counters_mark(course);
+    }
+
+    materialize_history(user, history_list);
+    int hidx = ll_search(history_list, course, compare_course_id);
+    if (hidx != -1) {
+        frequentation_ptr freq =
+            *(frequentation_ptr*)ll_get_at(history_list, hidx);
+        int times = get_frequentation_times_booked(freq) - 1;
+        set_frequentation_times_booked(freq, times);
+        if (times <= 0) {
+            ll_delete_at(history_list, hidx, delete_frequentation);
+        }
+    }
+}
+
+/* 4. Book a course, returns the durability future of the booking (0 if none) */
+booking_log_ticket action_book_course(int course_id, 
                         linked_list_ptr booked_list,
                         linked_list_ptr history_list,
                         hash_map_ptr hash_map,
                         user_ptr user)
 {
-    if (compare_datetime(get_datetime(),
+    struct datetime now;
+    init_datetime_now(&now);
+    if (compare_datetime(&now,
         get_subscription_end_date(get_user_subscription(user))) == 1)
     {
         printf("Subscription has expired.\n");
-        return;
+        return 0;
     }
 
     course_ptr course = get_course(hash_map, course_id);
     if (!course) {
         printf("Course ID not found.\n");
-        return;
+        return 0;
     }
 
     /* Check duplicate booking */
-    course_ptr tmp = create_course(course_id, "", NULL, 0, 0);
-    if (ll_search(booked_list, tmp, compare_course_id) != -1) {
+    uint16_t booked_id = (uint16_t)course_id;
+    if (ll_search(booked_list, &booked_id, compare_booked_id) != -1) {
         printf("You have already booked this course.\n");
-        delete_course(tmp);
-        return;
+        return 0;
     }
-    delete_course(tmp);
 
     /* Check availability */
     if (get_course_seats_booked(course) >= get_course_seats_total(course)) {
         printf("No available seats for this course.\n");
-        return;
+        return 0;
     }
 
     /* Book it */
-    ll_add(booked_list, course);
-    set_course_seats_booked(course,
-        get_course_seats_booked(course) + 1);
-
-    /* Update history */
-    int idx = ll_search(history_list, course, compare_course_id);
-    if (idx == -1) {
-        frequentation_ptr f = create_frequentation(
-            get_course_id(course),
-            get_course_name(course),
-            1
-        );
-        ll_add(history_list, f);
-    } else {
-        frequentation_ptr *fp =
-            (frequentation_ptr*)ll_get_at(history_list, idx);
-        set_frequentation_times_booked(
-           *fp,
-           get_frequentation_times_booked(*fp) + 1
-        );
-    }
+    book_course(course, booked_list, history_list, user, true);
+    booking_log_ticket ticket = booking_log_book(get_course_id(course));
 
     printf("Course booked successfully.\n");
+    return ticket;
 }
 
-/* 5. Cancel a booked course */
-void action_cancel_course(linked_list_ptr booked_list,
-                          linked_list_ptr history_list)
+/* 5. Cancel a booked course, returns the durability future of the cancellation (0 if none) */
+booking_log_ticket action_cancel_course(linked_list_ptr booked_list,
+                          linked_list_ptr history_list,
+                          user_ptr user)
 {
     uint16_t course_id;
     printf("Enter course ID to cancel: ");
-    if (scanf("%hu", &course_id) != 1) { getchar(); return; }
+    if (scanf("%hu", &course_id) != 1) { getchar(); return 0; }
     getchar();
 
-    int idx = ll_search(booked_list, &course_id, compare_course_id);
+    int idx = ll_search(booked_list, &course_id, compare_booked_id);
     if (idx == -1) {
         printf("You have not booked this course.\n");
-        return;
+        return 0;
     }
 
-    course_ptr course = *(course_ptr*)ll_get_at(booked_list, idx);
-    ll_delete_at(booked_list, idx, NULL);
-    set_course_seats_booked(course,
-        get_course_seats_booked(course) - 1);
-
-    int hidx = ll_search(history_list, course, compare_course_id);
-    if (hidx != -1) {
-        frequentation_ptr freq =
-            *(frequentation_ptr*)ll_get_at(history_list, hidx);
-        int times = get_frequentation_times_booked(freq) - 1;
-        set_frequentation_times_booked(freq, times);
-        if (times <= 0) {
-            ll_delete_at(history_list, hidx, delete_frequentation);
-        }
-    }
+    cancel_course(idx, booked_list, history_list, user, true);
+    booking_log_ticket ticket = booking_log_cancel(course_id);
 
     printf("Course cancellation successful.\n");
+    return ticket;
 }
 
 /* 6. Check subscription and optionally renew */
 void action_check_subscription(user_ptr user) {
-    if (compare_datetime(get_datetime(),
+    struct datetime today;
+    init_datetime_now(&today);
+    if (compare_datetime(&today,
                          get_subscription_end_date(get_user_subscription(user)))
         < 1)
     {
@@ -147,6 +326,10 @@ void action_check_subscription(user_ptr user) {
             get_user_subscription(user),
             start, end
         );
+        booking_log_renew(start, end);
+        delete_datetime(start);
+        delete_datetime(end);
+        delete_datetime(now);
         printf("Subscription renewed.\n");
     }
 }
@@ -164,48 +347,238 @@ void action_show_last_report(user_ptr user) {
     fseek(fp, 0, SEEK_END);
     long sz = ftell(fp);
     rewind(fp);
-    char *buf = malloc(sz+1);
-    CHECK_NULL(buf);
+    char *buf = mem_alloc(MEM_TAG_IO, sz+1);
     fread(buf, 1, sz, fp);
     buf[sz] = '\0';
     fclose(fp);
 
     printf("Here is your monthly report:\n%s\n", buf);
-    free(buf);
+    mem_free(buf);
+}
+
+/* Writes the backup from the child of a background save: catalog, its snapshot and the user;
+   a failure is returned to the parent, the child must not exit through the parent's atexit handlers */
+static bool write_backup(void *context){
+    (void)context;
+    char user_filepath[512];
+    if ((mkdir(BACKUP_PATH, 0777) != 0 && errno != EEXIST)
+        || (mkdir(BACKUP_USERS_PATH, 0777) != 0 && errno != EEXIST)
+        || !user_file_path(user_filepath, sizeof(user_filepath), BACKUP_USERS_PATH,
+                           get_user_username(backup_source.user), USER_FILE_SUFFIX)
+        || !user_file_dirs(BACKUP_USERS_PATH, get_user_username(backup_source.user))) {
+        fprintf(stderr, "Cannot create the backup directories: %s\n", strerror(errno));
+        return false;
+    }
+
+    // one thread: the child must not start workers from a forked process
+    return save_courses_parallel(BACKUP_COURSE_PATH, backup_source.array, 1)
+        && save_catalog_snapshot_stamped(BACKUP_SNAPSHOT_PATH, BACKUP_COURSE_PATH, backup_source.array, backup_source.map)
+        && save_user(user_filepath, backup_source.booked, backup_source.history, backup_source.user);
+}
+
+/* Reports a finished background backup on stderr */
+static void report_backup(const background_save_stats *stats){
+    if (stats->success) {
+        fprintf(stderr, "Background backup done in %.3f ms, %llu pages copied on write.\n",
+                stats->duration_ms, (unsigned long long)stats->cow_pages);
+    } else {
+        fprintf(stderr, "Background backup failed.\n");
+    }
+}
+
+/* Backup interval in seconds, from MYFITNESS_BACKUP_INTERVAL_S (0 disables periodic backups) */
+static unsigned int backup_interval(void){
+    const char *value = getenv(BACKUP_INTERVAL_ENV);
+    uint32_t seconds;
+    str_view view = { value, value ? strlen(value) : 0 };
+    if (!value || !csv_parse_uint(view, UINT32_MAX, &seconds))
+        return BACKUP_INTERVAL_S;
+    return seconds;
+}
+
+/* Forks the child writing a backup of the session */
+static bool start_backup(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user){
+    background_save_stats stats;
+    if (background_save_poll(&stats)) report_backup(&stats);
+
+    backup_source.array = array;
+    backup_source.map = map;
+    backup_source.booked = booked;
+    backup_source.history = history;
+    backup_source.user = user;
+    if (!background_save_start(write_backup, NULL)) return false;
+    last_backup = time(NULL);
+    return true;
+}
+
+/* 8. Background backup: a forked child saves the session while the menu keeps running */
+bool action_background_backup(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user){
+    if (!start_backup(map, array, booked, history, user)) {
+        printf("A backup is already running.\n");
+        return false;
+    }
+    printf("Backup started in the background.\n");
+    return true;
+}
+
+/* Called after every menu action: reports a finished backup and starts one every backup_interval seconds */
+void background_backup_tick(hash_map_ptr map, array_ptr array, linked_list_ptr booked, linked_list_ptr history, user_ptr user){
+    background_save_stats stats;
+    if (background_save_poll(&stats)) report_backup(&stats);
+
+    unsigned int interval = backup_interval();
+    time_t now = time(NULL);
+    if (last_backup == 0) last_backup = now;
+    if (interval == 0 || background_save_in_progress() || now - last_backup < (time_t)interval) return;
+    start_backup(map, array, booked, history, user);
+}
+
+/* Flushes the dirty seat counters, logging the generation they are written with first */
+static void flush_seat_counters(void){
+    uint32_t generation = seat_counters_reserve();
+    if (generation)
+        booking_log_wait(booking_log_seats(generation));
+    seat_counters_flush();
 }
 
 /* 0. Exit: saving is easiest from main still */
-void action_exit_and_save(hash_map_ptr map,
+void action_exit_and_save(user_store_ptr store,
+                          hash_map_ptr map,
                           array_ptr array,
                           linked_list_ptr booked,
                           linked_list_ptr history,
                           user_ptr user)
 {
-    char user_filepath[192] = {0};
-    snprintf(user_filepath, sizeof(user_filepath), "assets/users/%s.txt", get_user_username(user));
-
     char report_filepath[256] = {0};
     snprintf(report_filepath, sizeof(report_filepath), "assets/report/%s_report.txt", get_user_username(user));
 
+    // a backup still running is finished before the session is torn down
+    background_save_stats stats;
+    if (background_save_wait(&stats)) report_backup(&stats);
+
     report(report_filepath, user, history);
-    save_user(user_filepath, booked, history, user);
-    save_course(COURSE_PATH, array);
+    // The seats go first, then the user record, then the log is emptied: a
+    // crash in between leaves a log whose seats record tells replay which
+    // seat changes the sidecar holds already. Unless courses were
+    // administered, only seat counters change during a session: the dirty
+    // ones are written in place instead of rewriting the catalog. A
+    // catalog written with the flushed counts and not stamped yet only
+    // makes the next open rebuild the sidecar with the same counts.
+    if (seat_counters_is_open())
+        flush_seat_counters();
+    if (catalog_administered || !seat_counters_is_open()) {
+        if (!save_course(COURSE_PATH, array))
+            exit(1);
+        save_catalog_snapshot_stamped(COURSE_SNAPSHOT_PATH, COURSE_PATH, array, map);
+        if (seat_counters_is_open() && !seat_counters_restamp(COURSE_PATH, array))
+            fprintf(stderr, "Seat counters not stamped, they are rebuilt from the catalog.\n");
+    }
+    seat_counters_close();
+    save_user_to_store(store, booked, history, user);
+    // everything logged is now in the full save
+    booking_log_checkpoint();
+    booking_log_close();
+    user_store_close(store);
     array_delete(array, NULL);
     ll_delete_list(booked, NULL);
     ll_delete_list(history, NULL);
     delete_hash_map(map, true);
+    course_slab_clear();
+    catalog_watch_close();
+    catalog_administered = false;
+    history_catalog = NULL;
+    session_close();
+    str_intern_clear();
     printf("Exiting program and saving courses.\n");
 }
 
 
-char *login_user(void) {
+/* Reads a whole text file into a null-terminated buffer (NULL if it cannot be opened) */
+static char *read_text_file(const char *filepath, size_t *length){
+    FILE *fp = fopen(filepath, "r");
+    if (!fp)
+        return NULL;
+
+    char *text = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    for (;;){
+        if (capacity - size < LINE_READ_BUFFER){
+            capacity = capacity ? capacity * 2 : 4 * LINE_READ_BUFFER;
+            text = mem_realloc(text, MEM_TAG_IO, capacity);
+        }
+        size_t n = fread(text + size, 1, capacity - size - 1, fp);
+        size += n;
+        if (n == 0)
+            break;
+    }
+    fclose(fp);
+
+    text[size] = '\0';
+    if (length)
+        *length = size;
+    return text;
+}
+
+/* Takes the next line of a text, newline included; false at the end of the text */
+static bool next_text_line(str_view *text, str_view *line){
+    if (!text->length)
+        return false;
+    const char *newline = memchr(text->data, '\n', text->length);
+    size_t length = newline ? (size_t)(newline - text->data) + 1 : text->length;
+    line->data = text->data;
+    line->length = length;
+    text->data += length;
+    text->length -= length;
+    return true;
+}
+
+/* Number of places a user of the old one-file-per-user layout can be kept in */
+#define LEGACY_USER_LAYOUTS 2
+
+/* Path of a user file of the old layout: the sharded tree (layout 0) or,
+   if migrate_users was never run, the flat one (layout 1) */
+static bool legacy_user_path(char *filepath, size_t size, const char *username, int layout){
+    if (layout == 0)
+        return user_file_path(filepath, size, USERS_PATH, username, USER_FILE_SUFFIX);
+    return (size_t)snprintf(filepath, size, "%s%s%s", USERS_PATH, username, USER_FILE_SUFFIX) < size;
+}
+
+/* Tells whether a user is still kept as a file of the old layout */
+static bool legacy_user_exists(const char *username){
+    char filepath[512];
+    for (int layout = 0; layout < LEGACY_USER_LAYOUTS; layout++){
+        FILE *file = legacy_user_path(filepath, sizeof(filepath), username, layout)
+            ? fopen(filepath, "r") : NULL;
+        if (file){
+            fclose(file);
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Moves a user still kept in the old one-file-per-user layout into the store */
+static bool import_legacy_user(user_store_ptr store, const char *username){
+    char filepath[512];
+    size_t length;
+    char *text = NULL;
+    for (int layout = 0; !text && layout < LEGACY_USER_LAYOUTS; layout++){
+        if (legacy_user_path(filepath, sizeof(filepath), username, layout))
+            text = read_text_file(filepath, &length);
+    }
+    if (!text)
+        return false;
+    user_store_put(store, username, text, length);
+    mem_free(text);
+    return true;
+}
+
+char *login_user(user_store_ptr store) {
     char input_buf[256];
     char *username = NULL;
     char password[MAX_INPUT_USER];
     char stored_password[MAX_INPUT_USER];
-    char filepath[512];
-    FILE *file;
-    char linebuf[1024];
 
     printf("=== User Login ===\n");
 
@@ -219,73 +592,59 @@ char *login_user(void) {
     input_buf[strcspn(input_buf, "\n")] = '\0';
 
     // Allocate and copy username
-    username = malloc(strlen(input_buf) + 1);
-    if (!username) {
-        perror("malloc");
-        return NULL;
-    }
-    strcpy(username, input_buf);
+    username = str_dup(input_buf);
 
     // Read password
     printf("Enter password: ");
     if (fgets(password, sizeof(password), stdin) == NULL) {
         fprintf(stderr, "Failed to read password.\n");
-        free(username);
+        mem_free(username);
         return NULL;
     }
     password[strcspn(password, "\n")] = '\0';
 
-    // Build path to user file
-    snprintf(filepath, sizeof(filepath),
-             "assets/users/%s.txt", username);
-
-    file = fopen(filepath, "r");
-    if (!file) {
+    // Look the user up in the store, importing an old per-user file once
+    size_t length;
+    char *record = user_store_get(store, username, &length);
+    if (!record && import_legacy_user(store, username))
+        record = user_store_get(store, username, &length);
+    if (!record) {
         fprintf(stderr, "User '%s' not found.\n", username);
-        free(username);
-        return NULL;
-    }
-
-    // Skip the first line (e.g. header)
-    if (fgets(linebuf, sizeof(linebuf), file) == NULL) {
-        fprintf(stderr, "Error reading user file.\n");
-        fclose(file);
-        free(username);
+        mem_free(username);
         return NULL;
     }
 
-    // Read the second line, which contains the comma‐separated fields
-    if (fgets(linebuf, sizeof(linebuf), file) == NULL) {
-        fprintf(stderr, "Error reading user file.\n");
-        fclose(file);
-        free(username);
+    // Skip the first line (e.g. header) and take the second one,
+    // which contains the comma-separated fields
+    str_view text = { record, length };
+    str_view line;
+    if (!next_text_line(&text, &line) || !next_text_line(&text, &line)) {
+        fprintf(stderr, "Error reading user record.\n");
+        mem_free(record);
+        mem_free(username);
         return NULL;
     }
-    fclose(file);
 
     // Extract the 5th field (index 4) as the stored password
     {
-        int field = 0;
-        char *token = strtok(linebuf, ",");
-        while (token && field < 4) {
-            token = strtok(NULL, ",");
-            field++;
-        }
-        if (!token) {
-            fprintf(stderr, "Malformed user file.\n");
-            free(username);
+        str_view fields[5];
+        if (csv_read_line(&line, fields, 5) != 5) {
+            fprintf(stderr, "Malformed user record.\n");
+            mem_free(record);
+            mem_free(username);
             return NULL;
         }
-        // Copy and strip newline
-        strncpy(stored_password, token, MAX_INPUT_USER - 1);
-        stored_password[MAX_INPUT_USER - 1] = '\0';
-        stored_password[strcspn(stored_password, "\n")] = '\0';
+        // Copy the span (delimiters and newline are already excluded)
+        size_t field_length = fields[4].length < MAX_INPUT_USER - 1 ? fields[4].length : MAX_INPUT_USER - 1;
+        memcpy(stored_password, fields[4].data, field_length);
+        stored_password[field_length] = '\0';
     }
+    mem_free(record);
 
     // Verify password
     if (strcmp(password, stored_password) != 0) {
         fprintf(stderr, "Incorrect password.\n");
-        free(username);
+        mem_free(username);
         return NULL;
     }
 
@@ -293,230 +652,1136 @@ char *login_user(void) {
     return username;
 }
 
+/* Course fields parsed by a loader worker, before any object is created */
+struct course_record {
+    uint16_t id;
+    uint16_t seats_total;
+    uint16_t seats_booked;
+    str_view name;
+    struct datetime datetime;
+};
+
+/* A range of lines of the catalog parsed by one loader thread */
+struct load_chunk {
+    str_view text;
+    uint32_t limit;
+    struct course_record *records;
+    uint32_t count;
+    uint32_t capacity;
+    int error;
+};
+
+#define LOAD_ERROR_RECORD 1
+#define LOAD_ERROR_DATETIME 2
+
+/* Parses the next catalog line of text into record, returns 0 or a LOAD_ERROR code */
+static int parse_course_line(str_view *text, struct course_record *record){
+    str_view fields[5];
+
+    // Split CSV: id,name,HH:MM DD/MM/YY,seats_total,seats_booked
+    int field_count = csv_read_line(text, fields, 5);
+
+    // convert fields
+    uint32_t id, seats_total, seats_booked;
+    if (field_count < 5 ||
+        !csv_parse_uint(fields[0], UINT16_MAX, &id) ||
+        !csv_parse_uint(fields[3], UINT16_MAX, &seats_total) ||
+        !csv_parse_uint(fields[4], UINT16_MAX, &seats_booked)){
+        return LOAD_ERROR_RECORD;
+    }
+
+    // Parse datetime "HH:MM DD/MM/YYYY" from a small terminated copy
+    char dt_buf[32];
+    size_t dt_length = fields[2].length < sizeof(dt_buf) - 1 ? fields[2].length : sizeof(dt_buf) - 1;
+    memcpy(dt_buf, fields[2].data, dt_length);
+    dt_buf[dt_length] = '\0';
+
+    int hh, mm, dd, mo, yyyy;
+    if (sscanf(dt_buf, "%2d:%2d %2d/%2d/%4d", &hh, &mm, &dd, &mo, &yyyy) != 5){
+        return LOAD_ERROR_DATETIME;
+    }
+
+    record->id = (uint16_t)id;
+    record->seats_total = (uint16_t)seats_total;
+    record->seats_booked = (uint16_t)seats_booked;
+    record->name = fields[1];
+    init_datetime(&record->datetime, mm, hh, dd, mo, yyyy);
+    return 0;
+}
+
+/* Worker: parse every line of the chunk into its own record buffer (no shared state) */
+static void *parse_course_chunk(void *arg){
+    struct load_chunk *chunk = arg;
+
+    while (chunk->text.length && chunk->count < chunk->limit){
+        // blank lines (e.g. a trailing one) are not records
+        while (chunk->text.length && isspace((unsigned char)*chunk->text.data)){
+            chunk->text.data++;
+            chunk->text.length--;
+        }
+        if (!chunk->text.length)
+            break;
+        if (chunk->count == chunk->capacity){
+            chunk->capacity = chunk->capacity ? chunk->capacity * 2 : 64;
+            chunk->records = mem_realloc(chunk->records, MEM_TAG_IO,
+                chunk->capacity * sizeof(struct course_record));
+        }
+
+        chunk->error = parse_course_line(&chunk->text, &chunk->records[chunk->count]);
+        if (chunk->error)
+            return NULL;
+        chunk->count++;
+    }
+    return NULL;
+}
+
+/* Thread count for catalog load and save, from MYFITNESS_LOAD_THREADS (default 1) */
+static unsigned int catalog_threads(void){
+    const char *value = getenv(LOAD_THREADS_ENV);
+    uint32_t threads;
+    str_view view = { value, value ? strlen(value) : 0 };
+    if (!value || !csv_parse_uint(view, MAX_LOAD_THREADS, &threads) || threads == 0)
+        return 1;
+    return threads;
+}
+
+/* Skips the optional course count header, returns the line number of the first record */
+static uint32_t skip_catalog_header(str_view *file, uint32_t *num_of_courses){
+    // The course count header is optional: a first line holding one number
+    // caps the courses read, without it every record is read
+    str_view first_line = *file;
+    char delim;
+    uint32_t first_record_line = 1;
+    *num_of_courses = UINT16_MAX;
+    str_view count_field = csv_next_field(&first_line, &delim, CSV_DELIMS_FIELD);
+    if (delim != ',' && csv_parse_uint(count_field, UINT16_MAX, num_of_courses)){
+        *file = first_line;
+        first_record_line = 2;
+    }
+    while (file->length && isspace((unsigned char)*file->data)){
+        file->data++;
+        file->length--;
+    }
+    return first_record_line;
+}
+
 void load_courses(const char *filepath, array_ptr *array, hash_map_ptr *hash_map){
-    FILE *fp = fopen(filepath, "r");
-    CHECK_NULL(fp);
+    load_courses_parallel(filepath, array, hash_map, catalog_threads());
+}
 
-    // Read number of courses
-    uint16_t num_of_courses;
-    if (fscanf(fp, "%hu\n", &num_of_courses) != 1){
-        fprintf(stderr, "Failed to read course count\n");
-        fclose(fp);
-        exit(1);
+void load_courses_parallel(const char *filepath, array_ptr *array, hash_map_ptr *hash_map, unsigned int threads){
+    // Map the file and tokenize it in place: fields are views into the mapping
+    size_t file_size = 0;
+    const char *base = map_file(filepath, &file_size);
+    CHECK_NULL(base);
+    str_view file = { base, file_size };
+
+    uint32_t num_of_courses;
+    uint32_t first_record_line = skip_catalog_header(&file, &num_of_courses);
+    bool has_header = first_record_line == 2;
+
+    // Split the body at line boundaries, small files are not worth a thread
+    if (threads < 1) threads = 1;
+    if (threads > MAX_LOAD_THREADS) threads = MAX_LOAD_THREADS;
+    if (threads > file.length / MIN_LOAD_CHUNK_BYTES + 1)
+        threads = file.length / MIN_LOAD_CHUNK_BYTES + 1;
+
+    struct load_chunk chunks[MAX_LOAD_THREADS];
+    const char *end = file.data + file.length;
+    const char *chunk_start = file.data;
+    for (unsigned int t = 0; t < threads; t++){
+        const char *chunk_end = end;
+        if (t + 1 < threads){
+            const char *p = file.data + (file.length / threads) * (t + 1);
+            if (p < chunk_start) p = chunk_start;
+            const char *newline = memchr(p, '\n', (size_t)(end - p));
+            chunk_end = newline ? newline + 1 : end;
+        }
+        memset(&chunks[t], 0, sizeof(chunks[t]));
+        chunks[t].text.data = chunk_start;
+        chunks[t].text.length = (size_t)(chunk_end - chunk_start);
+        chunks[t].limit = num_of_courses;
+        chunk_start = chunk_end;
     }
 
+    // Parse: chunk 0 on this thread, the others on workers
+    pthread_t workers[MAX_LOAD_THREADS];
+    for (unsigned int t = 1; t < threads; t++){
+        if (pthread_create(&workers[t], NULL, parse_course_chunk, &chunks[t]) != 0){
+            fprintf(stderr, "Failed to start loader thread\n");
+            exit(1);
+        }
+    }
+    parse_course_chunk(&chunks[0]);
+    for (unsigned int t = 1; t < threads; t++){
+        pthread_join(workers[t], NULL);
+    }
+
+    // Without a header the catalog is every record read; a bad record
+    // counts as one more so that it is reported like a missing one
+    if (!has_header){
+        uint32_t records = 0;
+        bool truncated = false;
+        for (unsigned int t = 0; t < threads; t++){
+            records += chunks[t].count;
+            if (chunks[t].error){
+                records++;
+                break;
+            }
+            truncated = truncated || chunks[t].text.length > 0;
+        }
+        if (truncated || records > UINT16_MAX){
+            fprintf(stderr, "Catalog has more than %u courses, the rest is ignored\n", UINT16_MAX);
+            records = UINT16_MAX;
+        }
+        num_of_courses = records;
+    }
+
+    // Merge the per-thread records in file order
+    // The index gets twice the course count in slots (capped by the key range)
+    // so that linear probing does not degrade to a full scan on bulk insert
+    uint32_t index_size = num_of_courses ? 2u * num_of_courses : 1;
     *array = array_create(num_of_courses);
-    *hash_map = create_hash_map(num_of_courses);
+    *hash_map = create_hash_map(index_size > UINT16_MAX ? UINT16_MAX : (uint16_t)index_size);
+
+    uint32_t loaded = 0;
+    for (unsigned int t = 0; t < threads && loaded < num_of_courses; t++){
+        for (uint32_t r = 0; r < chunks[t].count && loaded < num_of_courses; r++, loaded++){
+            struct course_record *record = &chunks[t].records[r];
+            // a repeated id overrides the earlier line, as it always did,
+            // but in place so the array and the handles stay valid
+            course_ptr duplicate = get_course(*hash_map, record->id);
+            if (duplicate){
+                fprintf(stderr, "Duplicate course %u on line: %u, it replaces the earlier one\n",
+                        record->id, loaded + first_record_line);
+                update_course(duplicate, record->name.data, record->name.length,
+                              &record->datetime, record->seats_total);
+                set_course_seats_booked(duplicate, record->seats_booked);
+                continue;
+            }
+            datetime_ptr datetime = create_datetime(
+                record->datetime.minute,
+                record->datetime.hour,
+                record->datetime.day,
+                record->datetime.month,
+                record->datetime.year);
+
+            // Allocate course (the name view is interned straight from the mapping)
+            course_ptr course = create_course(
+                record->id,
+                str_intern_n(record->name.data, record->name.length),
+                datetime,
+                record->seats_total,
+                record->seats_booked);
+            // add course to array (already sorted in file);
+            set_course_position(course, get_size(*array));
+            array_add(*array, course);
+            // add course to hash map
+            insert_course(*hash_map, get_course_id(course), course);
+        }
 
-    char line[LINE_READ_BUFFER];
+        if (chunks[t].error && loaded < num_of_courses){
+            if (chunks[t].error == LOAD_ERROR_DATETIME)
+                fprintf(stderr, "Bad datetime format on line: %u\n", loaded + first_record_line);
+            else
+                fprintf(stderr, "Bad course record on line: %u\n", loaded + first_record_line);
+            exit(1);
+        }
+    }
+    if (loaded < num_of_courses){
+        fprintf(stderr, "Unexpected EOF at line %u\n", loaded + first_record_line);
+    }
+
+    for (unsigned int t = 0; t < threads; t++){
+        mem_free(chunks[t].records);
+    }
+    unmap_file(base, file_size);
+}
+
+/* Load the catalog from the binary snapshot, or from the text file re-exporting the snapshot */
+void load_catalog(const char *snapshot_path, const char *text_path, array_ptr *array, hash_map_ptr *hash_map){
+    if (catalog_snapshot_is_fresh(snapshot_path, text_path) &&
+        load_catalog_snapshot(snapshot_path, array, hash_map)) {
+        return;
+    }
+
+    load_courses(text_path, array, hash_map);
+    save_catalog_snapshot_stamped(snapshot_path, text_path, *array, *hash_map);
+}
+
+/* Hash of the fields a reload applies (id, name, datetime, seats_total), never 0
+   (0 marks an id without a line); seats_booked is left out since the live
+   count, from the sidecar or the snapshot, is never taken from the text */
+static uint32_t catalog_line_hash(str_view line){
+    str_view rest = line;
+    str_view fields[4];
+    if (csv_read_line(&rest, fields, 4) == 4)
+        line.length = (size_t)(fields[3].data + fields[3].length - line.data);
+    while (line.length && (line.data[line.length - 1] == '\n' || line.data[line.length - 1] == '\r'))
+        line.length--;
+    uint32_t hash = crc32c(0, line.data, line.length);
+    return hash ? hash : 1;
+}
+
+/* Reads the course id at the start of a catalog line */
+static bool catalog_line_id(str_view line, uint16_t *id){
+    char delim;
+    uint32_t value;
+    if (!csv_parse_uint(csv_next_field(&line, &delim, CSV_DELIMS_FIELD), UINT16_MAX, &value))
+        return false;
+    *id = (uint16_t)value;
+    return true;
+}
+
+/* Tells whether a catalog line holds only blanks, which are not records */
+static bool is_blank_line(str_view line){
+    for (size_t i = 0; i < line.length; i++){
+        if (!isspace((unsigned char)line.data[i]))
+            return false;
+    }
+    return true;
+}
+
+/* Number of records (non-blank lines) of a catalog text */
+static uint32_t count_records(str_view text){
+    str_view line;
+    uint32_t records = 0;
+    while (next_text_line(&text, &line)){
+        if (!is_blank_line(line))
+            records++;
+    }
+    return records;
+}
+
+/* The records of a catalog body the load reads: the first limit non-blank lines */
+static str_view catalog_records(str_view body, uint32_t limit){
+    str_view rest = body;
+    str_view line;
+    uint32_t records = 0;
+    while (records < limit && next_text_line(&rest, &line)){
+        if (!is_blank_line(line))
+            records++;
+    }
+    body.length = (size_t)(rest.data - body.data);
+    return body;
+}
+
+/* Keeps a copy of the body last applied, which the next reload diffs against */
+static void keep_catalog_text(str_view body, uint32_t records, uint32_t limit){
+    catalog_text = mem_realloc(catalog_text, MEM_TAG_IO, body.length ? body.length : 1);
+    memcpy(catalog_text, body.data, body.length);
+    catalog_text_length = body.length;
+    catalog_text_records = records;
+    catalog_text_limit = limit;
+    catalog_text_valid = true;
+}
+
+/* Line number of a line of the records, counted only to report an error */
+static uint32_t catalog_line_number(str_view records, const char *line, uint32_t first_record_line){
+    uint32_t number = first_record_line;
+    for (const char *p = records.data; p < line; p++){
+        if (*p == '\n')
+            number++;
+    }
+    return number;
+}
+
+/* Tells whether pos starts a line of a text */
+static bool starts_line(const char *text, size_t pos){
+    return pos == 0 || text[pos - 1] == '\n';
+}
+
+/* Narrows the old and new records to the lines between their common first
+   and last lines; everything outside is unchanged and is not parsed again */
+static void changed_window(str_view *old_text, str_view *new_text){
+    size_t shorter = old_text->length < new_text->length ? old_text->length : new_text->length;
+    size_t prefix = 0;
+    while (prefix < shorter && old_text->data[prefix] == new_text->data[prefix])
+        prefix++;
+    while (prefix > 0 && old_text->data[prefix - 1] != '\n')
+        prefix--;
+
+    size_t suffix = 0;
+    while (suffix < shorter - prefix
+           && old_text->data[old_text->length - suffix - 1] == new_text->data[new_text->length - suffix - 1])
+        suffix++;
+    while (suffix > 0 && !(starts_line(old_text->data, old_text->length - suffix)
+                           && starts_line(new_text->data, new_text->length - suffix)))
+        suffix--;
+
+    old_text->data += prefix;
+    old_text->length -= prefix + suffix;
+    new_text->data += prefix;
+    new_text->length -= prefix + suffix;
+}
+
+void catalog_watch_open(const char *text_path){
+    if (catalog_watch)
+        return;
+    catalog_watch = file_watch_open(text_path);
+    if (!catalog_watch){
+        fprintf(stderr, "Cannot watch %s, courses are not reloaded.\n", text_path);
+        return;
+    }
+
+    // The hash of every line the catalog was loaded from, and the text
+    // itself, to diff against
+    if (!catalog_lines)
+        catalog_lines = mem_calloc(MEM_TAG_IO, UINT16_MAX + 1, sizeof(*catalog_lines));
+    size_t file_size = 0;
+    const char *base = map_file(text_path, &file_size);
+    if (!base)
+        return;
+    str_view file = { base, file_size };
+    uint32_t limit;
+    skip_catalog_header(&file, &limit);
+    str_view records = catalog_records(file, limit);
+    str_view rest = records;
+    str_view line;
+    uint16_t id;
+    while (next_text_line(&rest, &line)){
+        if (catalog_line_id(line, &id))
+            catalog_lines[id] = catalog_line_hash(line);
+    }
+    keep_catalog_text(file, count_records(file), limit);
+    unmap_file(base, file_size);
+}
 
-    for (uint16_t i = 0; i < num_of_courses; i++){
-        if (!fgets(line, sizeof line, fp)){
-            fprintf(stderr, "Unexpected EOF at line %u\n", i + 2);
+/* A line of the new catalog that differs from the loaded one */
+struct course_change {
+    struct course_record record;
+    uint32_t hash;
+};
+
+bool reload_courses(const char *filepath, hash_map_ptr map, array_ptr array){
+    size_t file_size = 0;
+    const char *base = map_file(filepath, &file_size);
+    if (!base){
+        fprintf(stderr, "Cannot read %s, the courses are unchanged.\n", filepath);
+        return false;
+    }
+    if (!catalog_lines)
+        catalog_lines = mem_calloc(MEM_TAG_IO, UINT16_MAX + 1, sizeof(*catalog_lines));
+
+    str_view file = { base, file_size };
+    uint32_t limit;
+    uint32_t first_record_line = skip_catalog_header(&file, &limit);
+
+    // 1) Only the lines between the first and the last that changed since
+    //    the last load are looked at, and the records of the file are
+    //    counted from the old count and those lines. Without the old text
+    //    (the courses were administered since), or when the header caps
+    //    the records read, every line is compared with the loaded one by id.
+    bool by_window = catalog_text_valid && catalog_text_records <= catalog_text_limit;
+    str_view old_window = { catalog_text, by_window ? catalog_text_length : 0 };
+    str_view new_window = file;
+    uint32_t records = 0;
+    if (by_window){
+        changed_window(&old_window, &new_window);
+        records = catalog_text_records - count_records(old_window) + count_records(new_window);
+        by_window = records <= limit;
+    }
+    if (!by_window){
+        old_window.length = 0;
+        new_window = catalog_records(file, limit);
+        records = count_records(file);
+    }
+
+    // ids the old window held: the courses that may have been removed
+    uint8_t *old_ids = mem_calloc(MEM_TAG_IO, (UINT16_MAX + 1) / 8, 1);
+    uint16_t *old_list = NULL;
+    uint32_t old_count = 0;
+    uint32_t old_capacity = 0;
+    str_view line;
+    uint16_t id;
+    while (next_text_line(&old_window, &line)){
+        if (!is_blank_line(line) && catalog_line_id(line, &id)){
+            old_ids[id / 8] |= (uint8_t)(1u << (id % 8));
+            if (old_count == old_capacity){
+                old_capacity = old_capacity ? old_capacity * 2 : 16;
+                old_list = mem_realloc(old_list, MEM_TAG_IO, old_capacity * sizeof(*old_list));
+            }
+            old_list[old_count++] = id;
+        }
+    }
+
+    // 2) Parse only the lines that differ from the loaded ones; nothing is
+    //    applied until the whole file is known to be valid
+    uint8_t *seen = mem_calloc(MEM_TAG_IO, (UINT16_MAX + 1) / 8, 1);
+    struct course_change *changes = NULL;
+    uint32_t change_count = 0;
+    uint32_t change_capacity = 0;
+    uint32_t kept_live = 0;
+    int error = 0;
+    while (next_text_line(&new_window, &line)){
+        if (is_blank_line(line))
+            continue;
+        if (!catalog_line_id(line, &id)){
+            error = LOAD_ERROR_RECORD;
             break;
         }
+        uint8_t mask = (uint8_t)(1u << (id % 8));
+        // outside the window every line is unchanged, so a live id the old
+        // window did not hold is on one of those lines
+        if ((seen[id / 8] & mask) || (by_window && !(old_ids[id / 8] & mask) && get_course(map, id))){
+            fprintf(stderr, "Duplicate course %u on line: %u\n", id,
+                    catalog_line_number(file, line.data, first_record_line));
+            error = LOAD_ERROR_RECORD;
+            break;
+        }
+        seen[id / 8] |= mask;
 
-        // Split CSV: id,name,HH:MM DD/MM/YY,seats_total,seats_booked
-        char *p = line;
-        char *id_str = str_sep(&p, ",");
-        char *name_str = str_sep(&p, ",");
-        char *dt_str = str_sep(&p, ",");
-        char *total_str = str_sep(&p, ",");
-        char *booked_str = str_sep(&p, ",;\n");
-
-        // convert fields
-        uint16_t id = (uint16_t)atoi(id_str);
-        uint16_t seats_total = (uint16_t)atoi(total_str);
-        uint16_t seats_booked = (uint16_t)atoi(booked_str);
-
-        datetime_ptr datetime;
-        // Parse datetime "HH:MM DD/MM/YYYY"
-        int hh, mm, dd, mo, yyyy;
-        if (sscanf(dt_str, "%2d:%2d %2d/%2d/%4d", &hh, &mm, &dd, &mo, &yyyy) == 5){
-            datetime = create_datetime(mm, hh, dd, mo, yyyy);
+        // an id whose line is unchanged is live, a changed one is looked up
+        uint32_t hash = catalog_line_hash(line);
+        if (catalog_lines[id] == hash){
+            kept_live++;
+            continue;
         }
-        else{
-            fprintf(stderr, "Bad datetime format on line: %u\n", i + 2);
-            exit(1);
+        if (get_course(map, id))
+            kept_live++;
+        if (change_count == change_capacity){
+            change_capacity = change_capacity ? change_capacity * 2 : 16;
+            changes = mem_realloc(changes, MEM_TAG_IO, change_capacity * sizeof(*changes));
         }
+        error = parse_course_line(&line, &changes[change_count].record);
+        if (error)
+            break;
+        changes[change_count++].hash = hash;
+    }
+    if (error){
+        fprintf(stderr, "Bad course record on line: %u, the courses are unchanged.\n",
+                catalog_line_number(file, line.data, first_record_line));
+        mem_free(changes);
+        mem_free(seen);
+        mem_free(old_list);
+        mem_free(old_ids);
+        unmap_file(base, file_size);
+        return false;
+    }
 
-        // Allocate course
-        course_ptr course = create_course(
-            id,
-            str_dup(name_str),
-            datetime,
-            seats_total,
-            seats_booked);
-        // add course to array (already sorted in file);
-        array_add(*array, course);
-        // add course to hash map
-        insert_course(*hash_map, get_course_id(course), course);
+    // 3) Courses missing from the file are removed first, freeing their
+    //    slots: the ids of the old window not seen again, each found by id
+    //    and replaced by the last course of the array. Without a window
+    //    every course not seen is missing, and the catalog is compacted.
+    uint32_t removed = 0;
+    if (by_window){
+        for (uint32_t i = 0; i < old_count; i++){
+            uint16_t course_id = old_list[i];
+            if (seen[course_id / 8] & (1u << (course_id % 8)))
+                continue;
+            course_ptr course = remove_course(map, course_id);
+            if (!course)
+                continue;
+            uint16_t position = get_course_position(course);
+            array_swap_remove(array, position);
+            if (position < get_size(array))
+                set_course_position(*(course_ptr*)get_at(array, position), position);
+            // the handles held by booked lists stop resolving
+            catalog_lines[course_id] = 0;
+            seat_counters_forget(course);
+            delete_course(course);
+            removed++;
+        }
+    } else if (kept_live < get_size(array)){
+        uint16_t kept = 0;
+        for (uint16_t i = 0; i < get_size(array); i++){
+            course_ptr course = *(course_ptr*)get_at(array, i);
+            uint16_t course_id = get_course_id(course);
+            if (seen[course_id / 8] & (1u << (course_id % 8))){
+                set_course_position(course, kept);
+                set_at(array, kept++, course);
+                continue;
+            }
+            remove_course(map, course_id);
+            catalog_lines[course_id] = 0;
+            seat_counters_forget(course);
+            delete_course(course);
+            removed++;
+        }
+        array_truncate(array, kept);
     }
 
-    fclose(fp);
+    // 4) Changed courses are updated in place, so their handles stay valid
+    uint32_t added = 0;
+    uint32_t changed = 0;
+    for (uint32_t c = 0; c < change_count; c++){
+        struct course_record *record = &changes[c].record;
+        course_ptr course = get_course(map, record->id);
+        if (course){
+            update_course(course, record->name.data, record->name.length,
+                          &record->datetime, record->seats_total);
+            changed++;
+        } else if (get_size(array) < UINT16_MAX){
+            datetime_ptr datetime = create_datetime(
+                record->datetime.minute,
+                record->datetime.hour,
+                record->datetime.day,
+                record->datetime.month,
+                record->datetime.year);
+            course = create_course(
+                record->id,
+                str_intern_n(record->name.data, record->name.length),
+                datetime,
+                record->seats_total,
+                record->seats_booked);
+            set_course_position(course, get_size(array));
+            array_add(array, course);
+            insert_course(map, record->id, course);
+            added++;
+        } else {
+            fprintf(stderr, "Catalog is full, course %u is not added.\n", record->id);
+            continue;
+        }
+        catalog_lines[record->id] = changes[c].hash;
+    }
+
+    keep_catalog_text(file, records, limit);
+    mem_free(changes);
+    mem_free(seen);
+    mem_free(old_list);
+    mem_free(old_ids);
+    unmap_file(base, file_size);
+
+    // The sidecar is stamped with the new file, keeping the counts on disk
+    // for the courses whose changes are not flushed yet
+    if (seat_counters_is_open() && !seat_counters_restamp(filepath, array)){
+        seat_counters_close();
+        fprintf(stderr, "Seat counters unavailable, the catalog will be saved in full.\n");
+    }
+    if (!added && !changed && !removed)
+        return false;
+    fprintf(stderr, "Courses reloaded: %u added, %u changed, %u removed.\n", added, changed, removed);
+    return true;
 }
 
-user_ptr load_user(const char *filepath, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map){
-    FILE *fp = fopen(filepath, "r");
-    CHECK_NULL(fp);
+bool catalog_reload_tick(const char *text_path, hash_map_ptr map, array_ptr array){
+    if (!catalog_watch || !file_watch_changed(catalog_watch))
+        return false;
+    return reload_courses(text_path, map, array);
+}
+
+void catalog_watch_close(void){
+    if (catalog_watch){
+        file_watch_close(catalog_watch);
+        catalog_watch = NULL;
+    }
+    mem_free(catalog_lines);
+    catalog_lines = NULL;
+    mem_free(catalog_text);
+    catalog_text = NULL;
+    catalog_text_length = 0;
+    catalog_text_valid = false;
+}
+
+/* The catalog no longer matches the text file: it is saved in full at exit */
+static void catalog_changed(uint16_t course_id){
+    catalog_administered = true;
+    // a reload brings the line of the file back, comparing every line
+    // by id since the courses no longer match the text kept
+    if (catalog_lines)
+        catalog_lines[course_id] = 0;
+    catalog_text_valid = false;
+}
+
+bool admin_add_course(hash_map_ptr map, array_ptr array, uint16_t id, const char *name, datetime_ptr datetime, uint16_t seats_total){
+    if (get_course(map, id) || get_size(array) == UINT16_MAX)
+        return false;
+
+    course_ptr course = create_course(
+        id,
+        name,
+        create_datetime(datetime->minute, datetime->hour, datetime->day, datetime->month, datetime->year),
+        seats_total,
+        0);
+    set_course_position(course, get_size(array));
+    array_add(array, course);
+    insert_course(map, id, course);
+    // the counter of the id may be left from a deleted course
+    seat_counters_mark(course);
+    catalog_changed(id);
+    return true;
+}
+
+bool admin_update_course(hash_map_ptr map, uint16_t id, const char *name, datetime_ptr datetime, uint16_t seats_total){
+    course_ptr course = get_course(map, id);
+    if (!course)
+        return false;
 
+    update_course(course, name, strlen(name), datetime, seats_total);
+    catalog_changed(id);
+    return true;
+}
+
+bool admin_delete_course(hash_map_ptr map, array_ptr array, uint16_t id){
+    course_ptr course = remove_course(map, id);
+    if (!course)
+        return false;
+
+    // the last course takes its place, the full save at exit writes the
+    // catalog in array order
+    uint16_t position = get_course_position(course);
+    array_swap_remove(array, position);
+    if (position < get_size(array))
+        set_course_position(*(course_ptr*)get_at(array, position), position);
+
+    // bookings hold the handle of the course, which stops resolving
+    seat_counters_forget(course);
+    catalog_changed(id);
+    delete_course(course);
+    return true;
+}
+
+/* Reads a course typed as a catalog line, the name is copied into name */
+static bool read_admin_course(struct course_record *record, char *name, size_t name_size){
     char line[LINE_READ_BUFFER];
+    printf("Enter id,name,HH:MM DD/MM/YYYY,seats_total,seats_booked: ");
+    if (fgets(line, sizeof(line), stdin) == NULL)
+        return false;
+
+    str_view text = { line, strlen(line) };
+    if (parse_course_line(&text, record) || record->name.length >= name_size){
+        printf("Invalid course.\n");
+        return false;
+    }
+    memcpy(name, record->name.data, record->name.length);
+    name[record->name.length] = '\0';
+    return true;
+}
+
+/* 9. Manage courses: add, update or delete a course of the running catalog */
+void action_manage_courses(hash_map_ptr map, array_ptr array, user_ptr user){
+    const char *admin = getenv(ADMIN_ENV);
+    if (!admin || strcmp(admin, get_user_username(user)) != 0){
+        printf("Only the administrator can manage courses.\n");
+        return;
+    }
+
+    int choice;
+    printf("1. Add a course\n");
+    printf("2. Update a course\n");
+    printf("3. Delete a course\n");
+    printf("Enter your choice: ");
+    if (scanf("%d", &choice) != 1) { getchar(); return; }
+    getchar();
+
+    struct course_record record;
+    char name[MAX_INPUT_USER];
+    switch (choice){
+    case 1:
+        if (!read_admin_course(&record, name, sizeof(name)))
+            return;
+        if (!admin_add_course(map, array, record.id, name, &record.datetime, record.seats_total)){
+            printf("Course ID already exists.\n");
+            return;
+        }
+        printf("Course added.\n");
+        break;
+    case 2:
+        if (!read_admin_course(&record, name, sizeof(name)))
+            return;
+        if (!admin_update_course(map, record.id, name, &record.datetime, record.seats_total)){
+            printf("Course ID not found.\n");
+            return;
+        }
+        printf("Course updated.\n");
+        break;
+    case 3: {
+        uint16_t course_id;
+        printf("Enter course ID to delete: ");
+        if (scanf("%hu", &course_id) != 1) { getchar(); return; }
+        getchar();
+        if (!admin_delete_course(map, array, course_id)){
+            printf("Course ID not found.\n");
+            return;
+        }
+        printf("Course deleted.\n");
+        break;
+    }
+    default:
+        printf("Invalid choice.\n");
+    }
+}
+
+/* Parses a user record from a reader: line by line for the user data, field by field for the lists */
+static user_ptr parse_user(record_reader_ptr reader, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map){
+    // Everything owned by the logged user lives in the session arena
+    session_open();
+    history_catalog = *hash_map;
 
     // 1) Read last report date
-    if (!fgets(line, sizeof(line), fp)){
+    char *line = record_reader_line(reader, NULL);
+    if (!line){
         fprintf(stderr, "Failed to read report date\n");
-        fclose(fp);
         exit(1);
     }
     int hh, mm, dd, mo, yyyy;
     if (sscanf(line, "%2d:%2d %2d/%2d/%4d", &hh, &mm, &dd, &mo, &yyyy) != 5){
         fprintf(stderr, "Invalid datetime format\n");
-        fclose(fp);
         exit(1);
     }
-    datetime_ptr last_report_date = create_datetime(mm, hh, dd, mo, yyyy);
+    struct datetime last_report_date;
+    init_datetime(&last_report_date, mm, hh, dd, mo, yyyy);
 
     // 2) Read user data
-    if (!fgets(line, sizeof(line), fp)){
+    size_t line_length;
+    line = record_reader_line(reader, &line_length);
+    if (!line){
         fprintf(stderr, "Failed to read user data\n");
-        fclose(fp);
         exit(1);
     }
-    char *p = line;
-    char *cf_str = str_sep(&p, ",");
-    char *first_name_str = str_sep(&p, ",");
-    char *last_name_str = str_sep(&p, ",");
-    char *username_str = str_sep(&p, ",");
-    char *password_str = str_sep(&p, ",");
-    char *sub_start = str_sep(&p, ",");
-    char *sub_end = str_sep(&p, ",;\n");
-
+    // CF,first_name,last_name,username,password,sub_start,sub_end
+    str_view rest = { line, line_length };
+    str_view fields[7];
+    if (csv_read_line(&rest, fields, 7) != 7){
+        fprintf(stderr, "Malformed user data\n");
+        exit(1);
+    }
+    // terminate every field in place, the line buffer is ours
+    for (int i = 0; i < 7; i++){
+        line[(fields[i].data - line) + fields[i].length] = '\0';
+    }
+    char *cf_str = line + (fields[0].data - line);
+    char *first_name_str = line + (fields[1].data - line);
+    char *last_name_str = line + (fields[2].data - line);
+    char *username_str = line + (fields[3].data - line);
+    char *password_str = line + (fields[4].data - line);
+    char *sub_start = line + (fields[5].data - line);
+    char *sub_end = line + (fields[6].data - line);
+
+    // dates and subscription live on the stack, create_user copies them inline
+    struct datetime sub_start_date;
+    struct datetime sub_end_date;
     sscanf(sub_start, "%2d:%2d %2d/%2d/%4d", &hh, &mm, &dd, &mo, &yyyy);
-    datetime_ptr sub_start_date = create_datetime(mm, hh, dd, mo, yyyy);
+    init_datetime(&sub_start_date, mm, hh, dd, mo, yyyy);
     sscanf(sub_end, "%2d:%2d %2d/%2d/%4d", &hh, &mm, &dd, &mo, &yyyy);
-    datetime_ptr sub_end_date = create_datetime(mm, hh, dd, mo, yyyy);
+    init_datetime(&sub_end_date, mm, hh, dd, mo, yyyy);
 
-    subscription_ptr subscription = create_subscription(sub_start_date, sub_end_date);
+    struct subscription subscription;
+    init_subscription(&subscription, &sub_start_date, &sub_end_date);
 
     // inizializza le liste
     *booked_list = ll_create();
     *history_list = ll_create();
 
     user_ptr user = create_user(
-        str_dup(cf_str),
-        str_dup(first_name_str),
-        str_dup(last_name_str),
-        str_dup(username_str),
-        str_dup(password_str),
-        subscription,
-        last_report_date);
-
-    // 3) Read booked course IDs
-    if (!fgets(line, sizeof(line), fp)){
+        cf_str,
+        first_name_str,
+        last_name_str,
+        username_str,
+        password_str,
+        &subscription,
+        &last_report_date);
+
+    // 3) Read booked course IDs, one field at a time
+    if (record_reader_eof(reader)){
         fprintf(stderr, "Failed to read booked courses\n");
-        fclose(fp);
         exit(1);
     }
-    p = line;
-    while (p && *p){
-        char *course_id = str_sep(&p, ",;\n");
-        course_ptr course_reference = get_course(*hash_map, (uint16_t)atoi(course_id));
+    char delim = ',';
+    while (delim != '\n' && delim != '\0'){
+        uint32_t course_id;
+        // empty or invalid ids (e.g. the trailing field) are skipped
+        if (!csv_parse_uint(record_reader_field(reader, &delim, CSV_DELIMS_LIST), UINT16_MAX, &course_id))
+            continue;
+        course_ptr course_reference = get_course(*hash_map, (uint16_t)course_id);
 
         if (course_reference)
         {
-            ll_add(*booked_list, course_reference);
+            ll_add(*booked_list, booked_element(course_reference));
         }
     }
 
-    // 4) Read history as flat CSV: every 3 elementi -> (id, name, times)
-    if (!fgets(line, sizeof(line), fp)){
+    // 4) Keep the history line as it is, it is parsed on first use
+    size_t history_length;
+    char *history = record_reader_line(reader, &history_length);
+    if (!history){
         fprintf(stderr, "Failed to read history\n");
-        fclose(fp);
         exit(1);
     }
-    p = line;
-    while (p && *p){
-        char *id_hist = str_sep(&p, ",");
-        if (!id_hist || !*id_hist)
-            exit(1);
-        uint16_t course_id = (uint16_t)atoi(id_hist);
+    while (history_length && (history[history_length - 1] == '\n' || history[history_length - 1] == '\r'))
+        history_length--;
+    if (history_length){
+        char *text = session_alloc(MEM_TAG_FREQUENTATION, history_length);
+        memcpy(text, history, history_length);
+        set_user_history_text(user, text, history_length);
+    }
 
-        char *name_hist = str_sep(&p, ",");
-        if (!name_hist)
-            exit(1);
+    return user;
+}
 
-        // leggo times
-        char *times_hist = str_sep(&p, ",;\n");
-        if (!times_hist)
-            exit(1);
-        uint16_t times_booked = (uint16_t)atoi(times_hist);
+user_ptr load_user(const char *filepath, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map){
+    record_reader_ptr reader = record_reader_open(filepath);
+    CHECK_NULL(reader);
 
-        frequentation_ptr frequentation = create_frequentation(course_id, str_dup(name_hist), times_booked);
+    user_ptr user = parse_user(reader, booked_list, history_list, hash_map);
+    record_reader_close(reader);
+    return user;
+}
 
-        ll_add(*history_list, frequentation);
+user_ptr load_user_from_store(user_store_ptr store, const char *username, linked_list_ptr *booked_list, linked_list_ptr *history_list, hash_map_ptr *hash_map, uint32_t *stamp){
+    size_t length;
+    char *text = user_store_get(store, username, &length);
+    CHECK_NULL(text);
+    // the booking log is stamped with the record it applies to
+    *stamp = crc32c(0, text, length);
+
+    record_reader_ptr reader = record_reader_from_memory(text, length);
+    user_ptr user = parse_user(reader, booked_list, history_list, hash_map);
+    record_reader_close(reader);
+    mem_free(text);
+    return user;
+}
+
+/* Where the seats records of a log are, found before it is replayed */
+struct seats_records {
+    uint32_t index;
+    uint32_t count;
+    uint32_t flushed_until;
+};
+
+/* Replay callback finding the last seats record whose flush completed:
+   the seat changes logged before it are in the sidecar already */
+static void find_seats_record(const booking_log_record *record, void *context){
+    struct seats_records *found = context;
+    if (record->type == BOOKING_LOG_SEATS){
+        found->count++;
+        if (seat_counters_flushed(record->generation))
+            found->flushed_until = found->index;
     }
+    found->index++;
+}
 
-    fclose(fp);
-    return user;
+/* State the booking log is replayed on */
+struct replay_state {
+    linked_list_ptr booked_list;
+    linked_list_ptr history_list;
+    hash_map_ptr hash_map;
+    user_ptr user;
+    struct seats_records *seats;
+};
+
+/* Tells whether the seat change of the record being replayed is in the
+   sidecar already: a seats record whose flush completed follows it */
+static bool seat_is_flushed(struct replay_state *state){
+    return state->seats->index < state->seats->flushed_until;
+}
+
+/* Applies one logged mutation; records that no longer apply are skipped */
+static void apply_log_record(const booking_log_record *record, void *context){
+    struct replay_state *state = context;
+    uint16_t course_id = record->course_id;
+
+    switch (record->type){
+    case BOOKING_LOG_BOOK: {
+        course_ptr course = get_course(state->hash_map, course_id);
+        bool flushed = course && seat_is_flushed(state);
+        if (!course
+            || ll_search(state->booked_list, &course_id, compare_booked_id) != -1
+            || (!flushed && get_course_seats_booked(course) >= get_course_seats_total(course)))
+            break;
+        book_course(course, state->booked_list, state->history_list, state->user, !flushed);
+        break;
+    }
+    case BOOKING_LOG_CANCEL: {
+        int idx = ll_search(state->booked_list, &course_id, compare_booked_id);
+        if (idx != -1)
+            cancel_course(idx, state->booked_list, state->history_list, state->user,
+                          !seat_is_flushed(state));
+        break;
+    }
+    case BOOKING_LOG_RENEW: {
+        struct datetime start, end;
+        booking_log_to_datetime(&start, &record->start);
+        booking_log_to_datetime(&end, &record->end);
+        set_subscription_renew(get_user_subscription(state->user), &start, &end);
+        break;
+    }
+    case BOOKING_LOG_SEATS:
+        break;
+    default:
+        fprintf(stderr, "Unknown booking log record type %u\n", record->type);
+        exit(1);
+    }
+    state->seats->index++;
 }
 
-void save_user(char* filepath, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user){
-    FILE *file = fopen(filepath, "w");
-    CHECK_NULL(file);
+void replay_booking_log(const char *filepath, uint32_t stamp, linked_list_ptr booked_list, linked_list_ptr history_list, hash_map_ptr hash_map, user_ptr user){
+    struct seats_records seats = { 0, 0, 0 };
+    booking_log_replay(filepath, stamp, find_seats_record, &seats);
+    seats.index = 0;
+
+    struct replay_state state = { booked_list, history_list, hash_map, user, &seats };
+    uint32_t replayed = booking_log_replay(filepath, stamp, apply_log_record, &state) - seats.count;
+    if (replayed)
+        printf("Recovered %u unsaved operations from the booking log.\n", replayed);
+}
 
+/* Writes a history entry as "id:count,", or as the old "id,name,times," triple
+   when its course is no longer in the catalog so the saved name is not lost */
+static void save_history_callback(out_buffer_ptr out, void *element){
+    frequentation_ptr frequentation = element;
+    uint16_t course_id = get_frequentation_id(frequentation);
+    const char *name = get_frequentation_name(frequentation);
+    if (!*name || (history_catalog && get_course(history_catalog, course_id))){
+        save_frequentation_callback(out, frequentation);
+        return;
+    }
+    out_append_uint(out, course_id);
+    out_append_char(out, ',');
+    out_append_string(out, name);
+    out_append_char(out, ',');
+    out_append_uint(out, get_frequentation_times_booked(frequentation));
+    out_append_char(out, ',');
+}
+
+/* Writes the text of a user record: report date, user data, booked ids, history */
+static void format_user(out_buffer_ptr out, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user){
     // 1) Last report date
-    print_datetime(file, get_user_last_report_date(user));
-    fprintf(file, "\n");
+    out_append_datetime(out, get_user_last_report_date(user));
+    out_append_char(out, '\n');
 
     // 2) User data
-    fprintf(file, "%s,%s,%s,%s,%s,",
+    const char *user_fields[] = {
         get_user_CF(user),
         get_user_first_name(user),
         get_user_last_name(user),
         get_user_username(user),
-        get_user_password(user));
-    print_datetime(file, get_subscription_start_date(get_user_subscription(user)));
-    fprintf(file, ",");
-    print_datetime(file, get_subscription_end_date(get_user_subscription(user)));
-    fprintf(file, "\n");
-
-    // 3) Booked courses (if the user is being created write 0,)
-    if (ll_get_element_count(booked_list) == 0) {
-        fprintf(file, "0,");
+        get_user_password(user)
+    };
+    for (size_t i = 0; i < sizeof(user_fields) / sizeof(user_fields[0]); i++) {
+        out_append_string(out, user_fields[i]);
+        out_append_char(out, ',');
+    }
+    out_append_datetime(out, get_subscription_start_date(get_user_subscription(user)));
+    out_append_char(out, ',');
+    out_append_datetime(out, get_subscription_end_date(get_user_subscription(user)));
+    out_append_char(out, '\n');
+
+    // 3) Booked courses (if there are none write 0,)
+    size_t booked_start = out_buffer_length(out);
+    ll_write(booked_list, out, save_booked_callback);
+    if (out_buffer_length(out) == booked_start) {
+        out_append_string(out, "0,");
+    }
+    out_append_char(out, '\n');
+
+    // 4) Booked history (if the user is being created write "0:0,"),
+    // a history never accessed is written back as it was read
+    // unless it still has the old id,name,times encoding
+    size_t history_length;
+    const char *history_text = get_user_history_text(user, &history_length);
+    if (history_text && !is_pair_history(history_text, history_length)) {
+        materialize_history(user, history_list);
+        history_text = NULL;
+    }
+    if (history_text) {
+        out_append_bytes(out, history_text, history_length);
+    } else if (ll_get_element_count(history_list) == 0) {
+        out_append_string(out, "0:0,");
     } else {
-        ll_print(booked_list, file, save_booking_callback);
+        ll_write(history_list, out, save_history_callback);
     }
-    fprintf(file, "\n");
+}
 
-    // 4) Booked history (if the user is being created write "0,,0,")
-    if (ll_get_element_count(history_list) == 0) {
-        fprintf(file, "0,"",0,");
-    } else {
-        ll_print(history_list, file, save_frequentation_callback);
+bool save_user(char* filepath, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user){
+    out_buffer_ptr out = out_buffer_open(filepath);
+    if (!out){
+        fprintf(stderr, "Failed to open %s: %s\n", filepath, strerror(errno));
+        return false;
     }
+    format_user(out, booked_list, history_list, user);
+    return out_buffer_close(out);
+}
 
-    fclose(file);
+void save_user_to_store(user_store_ptr store, linked_list_ptr booked_list, linked_list_ptr history_list, user_ptr user){
+    out_buffer_ptr out = out_buffer_create(LINE_READ_BUFFER);
+    format_user(out, booked_list, history_list, user);
+    user_store_put(store, get_user_username(user), out_buffer_data(out), out_buffer_length(out));
+    out_buffer_close(out);
 }
 
-void save_course(char* filepath, array_ptr array){    
-    FILE *file = fopen(filepath, "w");
-    CHECK_NULL(file);
+bool save_course(char* filepath, array_ptr array){
+    return save_courses_parallel(filepath, array, catalog_threads());
+}
 
-    fprintf(file, "%d\n", get_size(array));
+/* A range of courses formatted by one save thread */
+struct save_chunk {
+    array_ptr array;
+    uint16_t begin;
+    uint16_t end;
+    out_buffer_ptr out;
+};
+
+/* Save worker: formats the courses of a range into the chunk buffer */
+static void *format_course_chunk(void *arg){
+    struct save_chunk *chunk = arg;
+    for (uint16_t i = chunk->begin; i < chunk->end; i++){
+        save_course_callback(chunk->out, *get_at(chunk->array, i));
+    }
+    return NULL;
+}
+
+bool save_courses_parallel(const char *filepath, array_ptr array, unsigned int threads){
+    uint16_t size = get_size(array);
+
+    // Split the catalog in ranges, small catalogs are not worth a thread
+    if (threads < 1) threads = 1;
+    if (threads > MAX_LOAD_THREADS) threads = MAX_LOAD_THREADS;
+    if (threads > size / MIN_SAVE_CHUNK_COURSES + 1u)
+        threads = size / MIN_SAVE_CHUNK_COURSES + 1u;
+
+    struct save_chunk chunks[MAX_LOAD_THREADS];
+    for (unsigned int t = 0; t < threads; t++){
+        chunks[t].array = array;
+        chunks[t].begin = (uint16_t)((uint32_t)size * t / threads);
+        chunks[t].end = (uint16_t)((uint32_t)size * (t + 1) / threads);
+        chunks[t].out = out_buffer_create((size_t)(chunks[t].end - chunks[t].begin) * 64 + 64);
+    }
+
+    // Format: chunk 0 on this thread, the others on workers; a chunk whose
+    // worker cannot start is formatted here too
+    pthread_t workers[MAX_LOAD_THREADS];
+    bool started[MAX_LOAD_THREADS] = { false };
+    for (unsigned int t = 1; t < threads; t++){
+        started[t] = pthread_create(&workers[t], NULL, format_course_chunk, &chunks[t]) == 0;
+        if (!started[t])
+            format_course_chunk(&chunks[t]);
+    }
+    format_course_chunk(&chunks[0]);
+    for (unsigned int t = 1; t < threads; t++){
+        if (started[t])
+            pthread_join(workers[t], NULL);
+    }
 
-    array_print(array, file, print_course_file_callback);
+    // Write the count line and every chunk in order with a single writev
+    bool saved = false;
+    out_buffer_ptr out = out_buffer_open(filepath);
+    if (out){
+        out_append_uint(out, size);
+        out_append_char(out, '\n');
 
-    fclose(file);
+        out_buffer_ptr parts[MAX_LOAD_THREADS];
+        for (unsigned int t = 0; t < threads; t++){
+            parts[t] = chunks[t].out;
+        }
+        out_buffer_writev(out, parts, (int)threads);
+        saved = out_buffer_close(out);
+    } else {
+        fprintf(stderr, "Failed to open %s: %s\n", filepath, strerror(errno));
+    }
+
+    for (unsigned int t = 0; t < threads; t++){
+        out_buffer_close(chunks[t].out);
+    }
+    return saved;
 }
 
-void registration_user() {
+void registration_user(user_store_ptr store) {
     char cf[MAX_INPUT_USER];
     char first_name[MAX_INPUT_USER];
     char last_name[MAX_INPUT_USER];
     char username[MAX_INPUT_USER];
     char password[MAX_INPUT_USER];
-    char filepath[192];
-    FILE *file;
 
     printf("=== New User Registration ===\n");
 
@@ -552,11 +1817,8 @@ void registration_user() {
     }
     username[strcspn(username, "\n")] = '\0';
 
-    // Check if username already exists
-    snprintf(filepath, sizeof(filepath), "%s%s.txt", USERS_PATH, username);
-    file = fopen(filepath, "r");
-    if (file) {
-        fclose(file);
+    // Check if username already exists, in the store or as an old per-user file
+    if (user_store_contains(store, username) || legacy_user_exists(username)) {
         fprintf(stderr, "Error: Username '%s' already exists.\n", username);
         exit(1);
     }
@@ -586,27 +1848,29 @@ void registration_user() {
         (get_datetime_field(now, "month") + 1) % 12,
         get_datetime_field(now, "year")
     );
-    subscription_ptr sub = create_subscription(start, end);
+    struct subscription sub;
+    init_subscription(&sub, start, end);
 
     // Create user struct
     user_ptr new_user = create_user(
-        str_dup(cf),
-        str_dup(first_name),
-        str_dup(last_name),
-        str_dup(username),
-        str_dup(password),
-        sub,
+        cf,
+        first_name,
+        last_name,
+        username,
+        password,
+        &sub,
         now
     );
+    delete_datetime(start);
+    delete_datetime(end);
+    delete_datetime(now);
 
     // Initialize empty lists
     linked_list_ptr booked_list = ll_create();
     linked_list_ptr history_list = ll_create();
-    
-    char user_filepath[192] = {0};
-    snprintf(user_filepath, sizeof(user_filepath), "assets/users/%s.txt", get_user_username(new_user));
-    // Save to file
-    save_user(user_filepath, booked_list, history_list, new_user);
+
+    // Save to the store
+    save_user_to_store(store, booked_list, history_list, new_user);
 
     printf("Registration successful. User '%s' created.\n", username);
     
@@ -633,11 +1897,17 @@ void report(char* filepath, user_ptr user, linked_list_ptr frequentation_linked_
         <
         get_datetime_field(current_datetime, "month");
     
-    if (!flag_year || !flag_month) return;
+    if (!flag_year || !flag_month) {
+        delete_datetime(current_datetime);
+        delete_datetime(now);
+        return;
+    }
     
     // create flag
-    FILE* file = fopen(filepath, "w");
-    CHECK_NULL(file);
+    out_buffer_ptr out = out_buffer_open(filepath);
+    CHECK_NULL(out);
+
+    materialize_history(user, frequentation_linked_list);
 
     int array_size = ll_get_element_count(frequentation_linked_list);
     array_ptr temp_array = array_create(array_size);
@@ -658,24 +1928,26 @@ void report(char* filepath, user_ptr user, linked_list_ptr frequentation_linked_
     set_user_last_report_date(user, current_datetime);
 
     // print datetime for this report
-    print_datetime(file, current_datetime);
-    fprintf(file, "\n");
+    out_append_datetime(out, current_datetime);
+    out_append_char(out, '\n');
 
     int i = 0;
     frequentation_ptr* fr;
-    fprintf(file, "Top three courses followed:\n");
+    out_append_string(out, "Top three courses followed:\n");
     while(i < array_size && i < 3) {
         fr = (frequentation_ptr*)get_at(temp_array, i);
-        print_frequentation_callback(file, *fr);
+        report_frequentation_callback(out, *fr);
         i++;
     }
-    fprintf(file, "Other courses:\n");
+    out_append_string(out, "Other courses:\n");
     while(i < array_size) {
         fr = (frequentation_ptr*)get_at(temp_array, i);
-        print_frequentation_callback(file, *fr);
+        report_frequentation_callback(out, *fr);
         i++;
     }
 
     array_delete(temp_array, NULL);
-    fclose(file);
+    delete_datetime(current_datetime);
+    delete_datetime(now);
+    out_buffer_close(out);
 }
\ No newline at end of file
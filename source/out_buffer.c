@@ -0,0 +1,436 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "out_buffer.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#define TEMP_SUFFIX ".tmp"
+
+/* Parts per writev call; POSIX guarantees at least 16 */
+#ifndef IOV_MAX
+#define IOV_MAX 16
+#endif
+
+struct out_buffer {
+    int fd;
+    char *path;
+    char *temp_path;
+    char *data;
+    size_t length;
+    size_t capacity;
+    // a write failed: the rest of the text is dropped and close fails
+    bool failed;
+};
+
+/* Two decimal digits for every value 0..99 */
+static const char digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/*
+    Binds a new buffer to a file. The text goes to a temporary file next
+    to it, which replaces the file only when the buffer is closed, so a
+    crash never leaves a truncated or half-written file behind.
+
+    Parameters:
+        filepath: path of the file to write.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Post-conditions:
+        The temporary file is open for writing and empty.
+
+    Returns:
+        out_buffer_ptr: the buffer, or NULL if the file cannot be created.
+*/
+out_buffer_ptr out_buffer_open(const char *filepath) {
+    CHECK_NULL(filepath);
+    size_t length = strlen(filepath);
+    char *temp_path = mem_alloc(MEM_TAG_IO, length + sizeof(TEMP_SUFFIX));
+    memcpy(temp_path, filepath, length);
+    memcpy(temp_path + length, TEMP_SUFFIX, sizeof(TEMP_SUFFIX));
+
+    int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        mem_free(temp_path);
+        return NULL;
+    }
+
+    out_buffer_ptr out = mem_alloc(MEM_TAG_IO, sizeof(*out));
+    out->fd = fd;
+    out->path = str_dup(filepath);
+    out->temp_path = temp_path;
+    out->length = 0;
+    out->capacity = OUT_BUFFER_CAPACITY;
+    out->failed = false;
+    out->data = mem_alloc(MEM_TAG_IO, out->capacity);
+    return out;
+}
+
+/*
+    Creates a memory-only buffer that grows as text is appended.
+
+    Parameters:
+        capacity: initial capacity in bytes.
+
+    Returns:
+        out_buffer_ptr: the new buffer.
+*/
+out_buffer_ptr out_buffer_create(size_t capacity) {
+    out_buffer_ptr out = mem_alloc(MEM_TAG_IO, sizeof(*out));
+    out->fd = -1;
+    out->path = NULL;
+    out->temp_path = NULL;
+    out->length = 0;
+    out->capacity = capacity ? capacity : 64;
+    out->failed = false;
+    out->data = mem_alloc(MEM_TAG_IO, out->capacity);
+    return out;
+}
+
+/*
+    Makes room for at least needed more bytes: a file buffer is flushed,
+    a memory buffer is grown.
+
+    Parameters:
+        out: the buffer.
+        needed: number of bytes about to be appended.
+
+    Returns:
+        None.
+*/
+static void out_reserve(out_buffer_ptr out, size_t needed) {
+    if (out->capacity - out->length >= needed) return;
+
+    if (out->fd >= 0) {
+        out_flush(out);
+        if (out->capacity >= needed) return;
+    }
+
+    size_t capacity = out->capacity;
+    while (capacity - out->length < needed) capacity *= 2;
+    out->data = mem_realloc(out->data, MEM_TAG_IO, capacity);
+    out->capacity = capacity;
+}
+
+/*
+    Appends raw bytes.
+
+    Parameters:
+        out: destination buffer.
+        data: bytes to append.
+        length: number of bytes.
+
+    Pre-conditions:
+        out must not be NULL, data must hold length readable bytes.
+*/
+void out_append_bytes(out_buffer_ptr out, const void *data, size_t length) {
+    CHECK_NULL(out);
+    out_reserve(out, length);
+    memcpy(out->data + out->length, data, length);
+    out->length += length;
+}
+
+/*
+    Appends a null-terminated string (without the terminator).
+
+    Parameters:
+        out: destination buffer.
+        string: text to append.
+
+    Pre-conditions:
+        out and string must not be NULL.
+*/
+void out_append_string(out_buffer_ptr out, const char *string) {
+    CHECK_NULL(string);
+    out_append_bytes(out, string, strlen(string));
+}
+
+/*
+    Appends a single character.
+
+    Parameters:
+        out: destination buffer.
+        c: character to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_char(out_buffer_ptr out, char c) {
+    CHECK_NULL(out);
+    out_reserve(out, 1);
+    out->data[out->length++] = c;
+}
+
+/*
+    Appends an unsigned integer in decimal, as "%u" would.
+    Digits are produced two at a time from the pair table, right to left.
+
+    Parameters:
+        out: destination buffer.
+        value: number to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_uint(out_buffer_ptr out, uint32_t value) {
+    char digits[10];
+    char *p = digits + sizeof(digits);
+
+    while (value >= 100) {
+        const char *pair = &digit_pairs[(value % 100) * 2];
+        value /= 100;
+        *--p = pair[1];
+        *--p = pair[0];
+    }
+    if (value >= 10) {
+        *--p = digit_pairs[value * 2 + 1];
+        *--p = digit_pairs[value * 2];
+    } else {
+        *--p = (char)('0' + value);
+    }
+
+    out_append_bytes(out, p, (size_t)(digits + sizeof(digits) - p));
+}
+
+/*
+    Appends a signed integer in decimal, as "%d" would.
+
+    Parameters:
+        out: destination buffer.
+        value: number to append.
+
+    Pre-conditions:
+        out must not be NULL.
+*/
+void out_append_int(out_buffer_ptr out, int value) {
+    if (value < 0) {
+        out_append_char(out, '-');
+        out_append_uint(out, 0u - (uint32_t)value);
+    } else {
+        out_append_uint(out, (uint32_t)value);
+    }
+}
+
+/*
+    Appends a datetime with the same text print_datetime writes,
+    including the padding quirk on single-digit minutes.
+
+    Parameters:
+        out: destination buffer.
+        datetime: datetime to append.
+
+    Pre-conditions:
+        out and datetime must not be NULL.
+*/
+void out_append_datetime(out_buffer_ptr out, datetime_ptr datetime) {
+    CHECK_NULL(datetime);
+
+    // time
+    if (datetime->hour < 10) out_append_char(out, '0');
+    out_append_int(out, datetime->hour);
+    out_append_char(out, ':');
+    out_append_int(out, datetime->minute);
+    if (datetime->minute < 10) out_append_char(out, '0');
+
+    // date
+    out_append_char(out, ' ');
+    out_append_int(out, datetime->day);
+    out_append_char(out, '/');
+    out_append_int(out, datetime->month);
+    out_append_char(out, '/');
+    out_append_int(out, datetime->year);
+}
+
+/*
+    Returns the buffered bytes not yet flushed.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Returns:
+        const char*: start of the buffered text (not null-terminated).
+*/
+const char *out_buffer_data(out_buffer_ptr out) {
+    CHECK_NULL(out);
+    return out->data;
+}
+
+/*
+    Returns the number of buffered bytes not yet flushed.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Returns:
+        size_t: buffered length.
+*/
+size_t out_buffer_length(out_buffer_ptr out) {
+    CHECK_NULL(out);
+    return out->length;
+}
+
+/*
+    Marks a file buffer as failed after a write error: the error is
+    reported once and nothing more is written.
+
+    Parameters:
+        out: the buffer.
+
+    Returns:
+        None.
+*/
+static void out_fail(out_buffer_ptr out) {
+    if (!out->failed) fprintf(stderr, "Failed to write %s: %s\n", out->path, strerror(errno));
+    out->failed = true;
+}
+
+/*
+    Writes the buffered bytes to the bound file and empties the buffer,
+    resuming after short writes. Does nothing for memory-only buffers.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Post-conditions:
+        The buffer is empty. If the write fails the error is reported,
+        the buffer is marked failed and out_buffer_close returns false.
+
+    Returns:
+        bool: false if the buffer has failed.
+*/
+bool out_flush(out_buffer_ptr out) {
+    CHECK_NULL(out);
+    if (out->fd < 0) return true;
+
+    size_t written = 0;
+    while (!out->failed && written < out->length) {
+        ssize_t n = write(out->fd, out->data + written, out->length - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            out_fail(out);
+            break;
+        }
+        written += (size_t)n;
+    }
+    out->length = 0;
+    return !out->failed;
+}
+
+/*
+    Writes the text buffered in a file buffer followed by the text of
+    memory buffers, in order, with as few writev calls as possible.
+
+    Parameters:
+        out: buffer bound to a file.
+        parts: memory buffers to append.
+        count: number of parts.
+
+    Pre-conditions:
+        out must be bound to a file; parts must hold count memory buffers.
+
+    Post-conditions:
+        The parts are written; they are left unchanged. If the write
+        fails the error is reported and the buffer is marked failed.
+
+    Returns:
+        bool: false if the buffer has failed.
+*/
+bool out_buffer_writev(out_buffer_ptr out, out_buffer_ptr *parts, int count) {
+    CHECK_NULL(out);
+    CHECK_NULL(parts);
+
+    // the text still buffered in out goes first
+    struct iovec *iov = mem_alloc(MEM_TAG_IO, (size_t)(count + 1) * sizeof(*iov));
+    struct iovec *next = iov;
+    iov[0].iov_base = out->data;
+    iov[0].iov_len = out->length;
+    for (int i = 0; i < count; i++) {
+        iov[i + 1].iov_base = parts[i]->data;
+        iov[i + 1].iov_len = parts[i]->length;
+    }
+
+    int remaining = count + 1;
+    while (!out->failed && remaining > 0) {
+        int batch = remaining < IOV_MAX ? remaining : IOV_MAX;
+        ssize_t written = writev(out->fd, next, batch);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            out_fail(out);
+            break;
+        }
+        while (remaining > 0 && (size_t)written >= next->iov_len) {
+            written -= (ssize_t)next->iov_len;
+            next++;
+            remaining--;
+        }
+        if (remaining > 0) {
+            next->iov_base = (char *)next->iov_base + written;
+            next->iov_len -= (size_t)written;
+        }
+    }
+    out->length = 0;
+    mem_free(iov);
+    return !out->failed;
+}
+
+/*
+    Flushes the buffer and frees it. A file buffer is synced and its
+    temporary file atomically renamed over the target path; if anything
+    failed the temporary file is removed and the target is left as it was.
+
+    Parameters:
+        out: the buffer.
+
+    Pre-conditions:
+        out must not be NULL.
+
+    Post-conditions:
+        The buffer is freed and must not be used anymore.
+
+    Returns:
+        bool: true if the file was replaced (always for memory buffers).
+*/
+bool out_buffer_close(out_buffer_ptr out) {
+    CHECK_NULL(out);
+    bool saved = out_flush(out);
+    if (out->fd >= 0) {
+        if (saved && (fdatasync(out->fd) != 0 || rename(out->temp_path, out->path) != 0)) {
+            fprintf(stderr, "Failed to save %s: %s\n", out->path, strerror(errno));
+            saved = false;
+        }
+        close(out->fd);
+        if (!saved) unlink(out->temp_path);
+        mem_free(out->path);
+        mem_free(out->temp_path);
+    }
+    mem_free(out->data);
+    mem_free(out);
+    return saved;
+}
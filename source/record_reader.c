@@ -0,0 +1,264 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "record_reader.h"
+#include "csv.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+struct record_reader {
+    // source: a file descriptor, or a memory block when fd is -1
+    int fd;
+    const char *memory;
+    size_t memory_length;
+    size_t memory_offset;
+    bool exhausted;
+    // bytes read and not consumed yet are data[start, end)
+    char *data;
+    size_t start;
+    size_t end;
+    size_t capacity;
+    // reusable buffer returned by record_reader_line
+    char *line;
+    size_t line_capacity;
+};
+
+/*
+    Allocates a reader with empty buffers.
+
+    Parameters:
+        fd: descriptor to read, or -1 for a memory source.
+
+    Returns:
+        record_reader_ptr: the reader.
+*/
+static record_reader_ptr reader_create(int fd) {
+    record_reader_ptr reader = mem_calloc(MEM_TAG_IO, 1, sizeof(*reader));
+    reader->fd = fd;
+    reader->capacity = RECORD_READER_CHUNK;
+    reader->data = mem_alloc(MEM_TAG_IO, reader->capacity);
+    return reader;
+}
+
+/*
+    Opens a reader on a file.
+
+    Parameters:
+        filepath: path of the file.
+
+    Pre-conditions:
+        filepath must be a valid string.
+
+    Returns:
+        record_reader_ptr: the reader, or NULL if the file cannot be opened.
+*/
+record_reader_ptr record_reader_open(const char *filepath) {
+    CHECK_NULL(filepath);
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return NULL;
+    return reader_create(fd);
+}
+
+/*
+    Creates a reader over text already in memory.
+
+    Parameters:
+        data: text to read.
+        length: number of bytes.
+
+    Pre-conditions:
+        data must stay valid and unchanged until the reader is closed.
+
+    Returns:
+        record_reader_ptr: the reader.
+*/
+record_reader_ptr record_reader_from_memory(const char *data, size_t length) {
+    CHECK_NULL(data);
+    record_reader_ptr reader = reader_create(-1);
+    reader->memory = data;
+    reader->memory_length = length;
+    return reader;
+}
+
+/*
+    Reads more input after the unconsumed bytes. The unconsumed bytes are
+    moved to the front of the buffer first, and the buffer is doubled only
+    when they fill it, so its size is bounded by the longest token read.
+
+    Parameters:
+        reader: the reader.
+
+    Post-conditions:
+        Offsets into data are relative to start; the program exits on a
+        read error.
+
+    Returns:
+        bool: false at the end of the input.
+*/
+static bool reader_fill(record_reader_ptr reader) {
+    if (reader->exhausted) return false;
+
+    if (reader->start > 0) {
+        memmove(reader->data, reader->data + reader->start, reader->end - reader->start);
+        reader->end -= reader->start;
+        reader->start = 0;
+    }
+    if (reader->end == reader->capacity) {
+        reader->capacity *= 2;
+        reader->data = mem_realloc(reader->data, MEM_TAG_IO, reader->capacity);
+    }
+
+    size_t room = reader->capacity - reader->end;
+    size_t added;
+    if (reader->fd >= 0) {
+        ssize_t n;
+        do {
+            n = read(reader->fd, reader->data + reader->end, room);
+        } while (n < 0 && errno == EINTR);
+        if (n < 0) {
+            fprintf(stderr, "Failed to read file: %s\n", strerror(errno));
+            exit(1);
+        }
+        added = (size_t)n;
+    } else {
+        size_t left = reader->memory_length - reader->memory_offset;
+        added = left < room ? left : room;
+        memcpy(reader->data + reader->end, reader->memory + reader->memory_offset, added);
+        reader->memory_offset += added;
+    }
+
+    reader->end += added;
+    if (added == 0) reader->exhausted = true;
+    return added > 0;
+}
+
+/*
+    Reads the rest of the current line.
+
+    Parameters:
+        reader: the reader.
+        length: output, receives the line length, newline included (may be NULL).
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Post-conditions:
+        The reader is at the start of the next line.
+
+    Returns:
+        char*: the null-terminated line, valid until the next line read;
+        the caller may modify it. NULL at the end of the input.
+*/
+char *record_reader_line(record_reader_ptr reader, size_t *length) {
+    CHECK_NULL(reader);
+
+    size_t scanned = 0;
+    size_t line_length;
+    for (;;) {
+        const char *from = reader->data + reader->start + scanned;
+        const char *newline = memchr(from, '\n', reader->end - reader->start - scanned);
+        if (newline) {
+            line_length = (size_t)(newline - (reader->data + reader->start)) + 1;
+            break;
+        }
+        scanned = reader->end - reader->start;
+        if (!reader_fill(reader)) {
+            line_length = reader->end - reader->start;
+            if (line_length == 0) return NULL;
+            break;
+        }
+    }
+
+    if (line_length + 1 > reader->line_capacity) {
+        reader->line_capacity = line_length + 1;
+        reader->line = mem_realloc(reader->line, MEM_TAG_IO, reader->line_capacity);
+    }
+    memcpy(reader->line, reader->data + reader->start, line_length);
+    reader->line[line_length] = '\0';
+    reader->start += line_length;
+
+    if (length) *length = line_length;
+    return reader->line;
+}
+
+/*
+    Reads the next field of the current line.
+
+    Parameters:
+        reader: the reader.
+        delim: output, receives the delimiter that ended the field
+               (',', ';', '\n'), or '\0' at the end of the input.
+        delims: delimiter set ending the field (see csv.h).
+
+    Pre-conditions:
+        reader and delim must not be NULL.
+
+    Post-conditions:
+        The reader is past the field and its delimiter.
+
+    Returns:
+        str_view: the field (possibly empty), valid until the next read.
+*/
+str_view record_reader_field(record_reader_ptr reader, char *delim, csv_delims delims) {
+    CHECK_NULL(reader);
+    CHECK_NULL(delim);
+
+    size_t scanned = 0;
+    for (;;) {
+        const char *field = reader->data + reader->start;
+        const char *end = reader->data + reader->end;
+        const char *found = csv_find_delimiter(field + scanned, end, delims);
+        if (found != end) {
+            str_view view = { field, (size_t)(found - field) };
+            *delim = *found;
+            reader->start += view.length + 1;
+            return view;
+        }
+        scanned = reader->end - reader->start;
+        if (!reader_fill(reader)) {
+            str_view view = { reader->data + reader->start, reader->end - reader->start };
+            *delim = '\0';
+            reader->start = reader->end;
+            return view;
+        }
+    }
+}
+
+/*
+    Tells whether the whole input has been read.
+
+    Parameters:
+        reader: the reader.
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Returns:
+        bool: true if no byte is left.
+*/
+bool record_reader_eof(record_reader_ptr reader) {
+    CHECK_NULL(reader);
+    return reader->start == reader->end && !reader_fill(reader);
+}
+
+/*
+    Closes the reader and frees its buffers.
+
+    Parameters:
+        reader: the reader.
+
+    Pre-conditions:
+        reader must not be NULL.
+
+    Post-conditions:
+        The reader must not be used anymore.
+*/
+void record_reader_close(record_reader_ptr reader) {
+    CHECK_NULL(reader);
+    if (reader->fd >= 0) close(reader->fd);
+    mem_free(reader->data);
+    mem_free(reader->line);
+    mem_free(reader);
+}
@@ -0,0 +1,758 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "seat_counters.h"
+#include "crc32c.h"
+#include "out_buffer.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define SEAT_COUNTERS_MAGIC "MFSC"
+
+/* Generations handed out but never written that the header remembers */
+#define SEAT_COUNTERS_FAILED 32
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t catalog_size;
+    int64_t catalog_mtime_sec;
+    int64_t catalog_mtime_nsec;
+    uint32_t entries;
+    uint32_t generation;
+    uint32_t completed;
+    uint32_t failed_count;
+    uint32_t failed[SEAT_COUNTERS_FAILED];
+    uint32_t checksum;
+} seat_counters_header;
+
+/* Counters of SEAT_COUNTERS_BLOCK consecutive course IDs and their CRC32C */
+typedef struct {
+    uint16_t counters[SEAT_COUNTERS_BLOCK];
+    uint32_t checksum;
+} seat_counters_block;
+
+/* Journal of a flush, after the blocks: the blocks it writes, then their
+   place in the table; checksum covers both and the two counts */
+typedef struct {
+    uint32_t generation;
+    uint32_t blocks;
+    uint32_t checksum;
+} seat_counters_journal;
+
+/* Descriptor and path of the open sidecar, -1 when none is open */
+static int counters_fd = -1;
+static char *counters_path;
+static uint32_t counters_entries;
+
+/* Header of the open sidecar, and the generation the next flush writes (0 for none yet) */
+static seat_counters_header counters_header;
+static uint32_t flush_generation;
+
+/* Copy of the blocks on disk, so a changed block is rewritten without reading it */
+static seat_counters_block *blocks;
+
+/* Dirty set: courses in marking order, plus one bit per course ID */
+static course_ptr *dirty_courses;
+static uint32_t dirty_count;
+static uint32_t dirty_capacity;
+static uint8_t dirty_bits[(UINT16_MAX + 1) / 8];
+
+/*
+    Fills the catalog stamp of a header from the text catalog.
+
+    Parameters:
+        header: header to fill.
+        catalog_path: path of the text catalog.
+
+    Returns:
+        bool: false if the catalog cannot be stat'ed.
+*/
+static bool stamp_catalog(seat_counters_header *header, const char *catalog_path) {
+    struct stat st;
+    if (stat(catalog_path, &st) != 0) return false;
+    header->catalog_size = (uint64_t)st.st_size;
+    header->catalog_mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    header->catalog_mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    return true;
+}
+
+/*
+    Returns the number of counters needed by a catalog.
+
+    Parameters:
+        array: catalog.
+
+    Returns:
+        uint32_t: highest course ID + 1.
+*/
+static uint32_t counters_for(array_ptr array) {
+    uint32_t entries = 1;
+    for (uint16_t i = 0; i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        if ((uint32_t)get_course_id(course) + 1 > entries) entries = get_course_id(course) + 1u;
+    }
+    return entries;
+}
+
+/*
+    Returns the number of counter slots of a sidecar for a catalog.
+
+    Parameters:
+        array: catalog.
+
+    Returns:
+        uint32_t: counters_for rounded up to whole blocks.
+*/
+static uint32_t entries_for(array_ptr array) {
+    return (counters_for(array) + SEAT_COUNTERS_BLOCK - 1) / SEAT_COUNTERS_BLOCK * SEAT_COUNTERS_BLOCK;
+}
+
+/*
+    Computes the checksum of a block.
+
+    Parameters:
+        block: the block (its checksum field is ignored).
+
+    Returns:
+        uint32_t: CRC32C of the counters.
+*/
+static uint32_t block_checksum(const seat_counters_block *block) {
+    return crc32c(0, block->counters, sizeof(block->counters));
+}
+
+/*
+    Computes the checksum of a header.
+
+    Parameters:
+        header: the header (its checksum field is ignored).
+
+    Returns:
+        uint32_t: CRC32C of the fields before checksum.
+*/
+static uint32_t header_checksum(const seat_counters_header *header) {
+    return crc32c(0, header, offsetof(seat_counters_header, checksum));
+}
+
+/*
+    Returns the file offset of a block.
+
+    Parameters:
+        index: block number.
+
+    Returns:
+        off_t: offset of the block.
+*/
+static off_t block_offset(uint32_t index) {
+    return (off_t)sizeof(seat_counters_header) + (off_t)index * (off_t)sizeof(seat_counters_block);
+}
+
+/*
+    Writes a whole buffer at a given offset of the open sidecar.
+
+    Parameters:
+        fd: open sidecar.
+        data: bytes to write.
+        length: number of bytes.
+        offset: file offset.
+
+    Returns:
+        bool: false on a write error.
+*/
+static bool write_at(int fd, const void *data, size_t length, off_t offset) {
+    return pwrite(fd, data, length, offset) == (ssize_t)length;
+}
+
+/*
+    Writes the header of the open sidecar in place and syncs the file.
+
+    Returns:
+        None; exits the program on a write error.
+*/
+static void write_header(void) {
+    counters_header.checksum = header_checksum(&counters_header);
+    if (!write_at(counters_fd, &counters_header, sizeof(counters_header), 0) || fdatasync(counters_fd) != 0) {
+        fprintf(stderr, "Failed to update seat counters: %s\n", strerror(errno));
+        exit(1);
+    }
+}
+
+/*
+    Copies the seats_booked counter of every course into the blocks whose
+    flag is set, and recomputes their checksum.
+
+    Parameters:
+        array: catalog.
+        selected: one flag per block, or NULL for all the blocks.
+
+    Returns:
+        None.
+*/
+static void fill_blocks(array_ptr array, const bool *selected) {
+    for (uint16_t i = 0; i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        uint16_t id = get_course_id(course);
+        if (selected && !selected[id / SEAT_COUNTERS_BLOCK]) continue;
+        blocks[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK] = get_course_seats_booked(course);
+    }
+    for (uint32_t b = 0; b < counters_entries / SEAT_COUNTERS_BLOCK; b++) {
+        if (!selected || selected[b]) blocks[b].checksum = block_checksum(&blocks[b]);
+    }
+}
+
+/*
+    Writes a new sidecar with the counters of the catalog, keeping the
+    generations of the header in memory; the file is replaced atomically.
+
+    Parameters:
+        filepath: path of the sidecar.
+        catalog_path: path of the text catalog.
+        array: catalog.
+
+    Returns:
+        bool: false if the catalog cannot be stamped or the file created.
+*/
+static bool write_sidecar(const char *filepath, const char *catalog_path, array_ptr array) {
+    memcpy(counters_header.magic, SEAT_COUNTERS_MAGIC, sizeof(counters_header.magic));
+    counters_header.version = SEAT_COUNTERS_VERSION;
+    counters_header.entries = entries_for(array);
+    if (!stamp_catalog(&counters_header, catalog_path)) return false;
+    counters_header.checksum = header_checksum(&counters_header);
+
+    uint32_t block_count = counters_header.entries / SEAT_COUNTERS_BLOCK;
+    mem_free(blocks);
+    blocks = mem_calloc(MEM_TAG_IO, block_count, sizeof(*blocks));
+    counters_entries = counters_header.entries;
+    fill_blocks(array, NULL);
+
+    out_buffer_ptr out = out_buffer_open(filepath);
+    if (!out) {
+        mem_free(blocks);
+        blocks = NULL;
+        return false;
+    }
+    out_append_bytes(out, &counters_header, sizeof(counters_header));
+    out_append_bytes(out, blocks, block_count * sizeof(*blocks));
+    if (!out_buffer_close(out)) {
+        mem_free(blocks);
+        blocks = NULL;
+        return false;
+    }
+    return true;
+}
+
+/*
+    Reads the header of an existing sidecar.
+
+    Parameters:
+        fd: open sidecar.
+        header: output, the header read.
+
+    Returns:
+        bool: true if the file is an intact sidecar of this version.
+*/
+static bool read_header(int fd, seat_counters_header *header) {
+    if (pread(fd, header, sizeof(*header), 0) != (ssize_t)sizeof(*header)) return false;
+    if (memcmp(header->magic, SEAT_COUNTERS_MAGIC, sizeof(header->magic)) != 0) return false;
+    if (header->version != SEAT_COUNTERS_VERSION) return false;
+    if (header->checksum != header_checksum(header)) return false;
+    return header->entries <= UINT16_MAX + 1u && header->entries % SEAT_COUNTERS_BLOCK == 0
+        && header->failed_count <= SEAT_COUNTERS_FAILED;
+}
+
+/*
+    Checks that a sidecar belongs to the current text catalog and fits
+    the courses.
+
+    Parameters:
+        header: header of the sidecar.
+        catalog_path: path of the text catalog.
+        array: catalog.
+
+    Returns:
+        bool: true if the counters of the sidecar can be applied.
+*/
+static bool header_is_current(const seat_counters_header *header, const char *catalog_path, array_ptr array) {
+    seat_counters_header expected;
+    if (!stamp_catalog(&expected, catalog_path)) return false;
+    if (header->catalog_size != expected.catalog_size
+        || header->catalog_mtime_sec != expected.catalog_mtime_sec
+        || header->catalog_mtime_nsec != expected.catalog_mtime_nsec) return false;
+    return header->entries >= entries_for(array);
+}
+
+/*
+    Finishes the flush of a crashed session. A journal that is intact
+    and belongs to the last generation handed out is written again in
+    place (writing it twice is harmless); otherwise that generation never
+    reached the blocks and is remembered as failed, so replay applies the
+    seat changes logged before it.
+
+    Parameters:
+        fd: open sidecar, its header in counters_header.
+
+    Returns:
+        bool: false if the file cannot be written.
+*/
+static bool recover_flush(int fd) {
+    if (counters_header.completed == counters_header.generation) return true;
+
+    off_t offset = block_offset(counters_header.entries / SEAT_COUNTERS_BLOCK);
+    seat_counters_journal journal;
+    bool replayed = false;
+    if (pread(fd, &journal, sizeof(journal), offset) == (ssize_t)sizeof(journal)
+        && journal.generation == counters_header.generation
+        && journal.blocks <= counters_header.entries / SEAT_COUNTERS_BLOCK) {
+        size_t length = journal.blocks * (sizeof(seat_counters_block) + sizeof(uint32_t));
+        char *entries = mem_alloc(MEM_TAG_IO, length ? length : 1);
+        if (pread(fd, entries, length, offset + (off_t)sizeof(journal)) == (ssize_t)length
+            && crc32c(crc32c(0, &journal, offsetof(seat_counters_journal, checksum)), entries, length) == journal.checksum) {
+            const seat_counters_block *written = (const seat_counters_block*)entries;
+            const uint32_t *indexes = (const uint32_t*)(entries + journal.blocks * sizeof(seat_counters_block));
+            replayed = true;
+            for (uint32_t i = 0; replayed && i < journal.blocks; i++) {
+                replayed = indexes[i] < counters_header.entries / SEAT_COUNTERS_BLOCK
+                        && write_at(fd, &written[i], sizeof(written[i]), block_offset(indexes[i]));
+            }
+        }
+        mem_free(entries);
+    }
+
+    if (!replayed) {
+        if (counters_header.failed_count == SEAT_COUNTERS_FAILED) {
+            memmove(counters_header.failed, counters_header.failed + 1,
+                    (SEAT_COUNTERS_FAILED - 1) * sizeof(*counters_header.failed));
+            counters_header.failed_count--;
+        }
+        counters_header.failed[counters_header.failed_count++] = counters_header.generation;
+    }
+    counters_header.completed = counters_header.generation;
+    counters_header.checksum = header_checksum(&counters_header);
+    return write_at(fd, &counters_header, sizeof(counters_header), 0) && fdatasync(fd) == 0;
+}
+
+/*
+    Applies the blocks of a sidecar to the catalog. A block failing its
+    checksum is reported and rewritten with the values of the catalog;
+    the other blocks are still applied.
+
+    Parameters:
+        fd: open sidecar.
+        filepath: path of the sidecar, for messages.
+        header: its header.
+        array: catalog.
+
+    Returns:
+        bool: true if the counters were applied.
+*/
+static bool apply_blocks(int fd, const char *filepath, const seat_counters_header *header, array_ptr array) {
+    uint32_t block_count = header->entries / SEAT_COUNTERS_BLOCK;
+    size_t table_size = block_count * sizeof(*blocks);
+    mem_free(blocks);
+    blocks = mem_alloc(MEM_TAG_IO, table_size);
+    bool *damaged = mem_calloc(MEM_TAG_IO, block_count, sizeof(*damaged));
+    bool any_damaged = false;
+    bool valid = pread(fd, blocks, table_size, sizeof(*header)) == (ssize_t)table_size;
+    for (uint32_t b = 0; valid && b < block_count; b++) {
+        if (block_checksum(&blocks[b]) == blocks[b].checksum) continue;
+        fprintf(stderr, "Seat counters: block %u of %s fails its checksum, "
+                "courses %u-%u keep the catalog values\n", b, filepath,
+                b * SEAT_COUNTERS_BLOCK, (b + 1) * SEAT_COUNTERS_BLOCK - 1);
+        damaged[b] = true;
+        any_damaged = true;
+    }
+    for (uint16_t i = 0; valid && i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        uint16_t id = get_course_id(course);
+        if (damaged[id / SEAT_COUNTERS_BLOCK]) continue;
+        valid = blocks[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK] <= get_course_seats_total(course);
+    }
+    for (uint16_t i = 0; valid && i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        uint16_t id = get_course_id(course);
+        if (damaged[id / SEAT_COUNTERS_BLOCK]) continue;
+        set_course_seats_booked(course, blocks[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK]);
+    }
+
+    if (valid) {
+        counters_entries = header->entries;
+        if (any_damaged) {
+            fill_blocks(array, damaged);
+            for (uint32_t b = 0; valid && b < block_count; b++) {
+                if (!damaged[b]) continue;
+                valid = write_at(fd, &blocks[b], sizeof(blocks[b]), block_offset(b));
+            }
+            valid = valid && fdatasync(fd) == 0;
+        }
+    }
+    mem_free(damaged);
+    return valid;
+}
+
+/*
+    Replaces the open sidecar with a table of counters under the header
+    in memory; the file is replaced atomically and opened again.
+
+    Parameters:
+        table: the new blocks, owned by the sidecar from now on.
+        entries: number of counters of table.
+
+    Returns:
+        bool: false if the file cannot be written (table is freed, the
+        sidecar is left as it was).
+*/
+static bool replace_sidecar(seat_counters_block *table, uint32_t entries) {
+    uint32_t old_entries = counters_header.entries;
+    counters_header.entries = entries;
+    counters_header.checksum = header_checksum(&counters_header);
+
+    out_buffer_ptr out = out_buffer_open(counters_path);
+    bool written = out != NULL;
+    if (out) {
+        out_append_bytes(out, &counters_header, sizeof(counters_header));
+        out_append_bytes(out, table, entries / SEAT_COUNTERS_BLOCK * sizeof(*table));
+        written = out_buffer_close(out);
+    }
+    int fd = written ? open(counters_path, O_RDWR) : -1;
+    if (fd < 0) {
+        counters_header.entries = old_entries;
+        counters_header.checksum = header_checksum(&counters_header);
+        mem_free(table);
+        return false;
+    }
+
+    close(counters_fd);
+    counters_fd = fd;
+    mem_free(blocks);
+    blocks = table;
+    counters_entries = entries;
+    return true;
+}
+
+/*
+    Opens the sidecar of a catalog and applies its counters, or rebuilds
+    it from the loaded catalog if it is missing or stale.
+
+    Parameters:
+        filepath: path of the sidecar file.
+        catalog_path: path of the text catalog it belongs to.
+        array: loaded catalog.
+
+    Pre-conditions:
+        No sidecar is open; array must not be NULL.
+
+    Post-conditions:
+        On success seats_booked of every course holds the persisted value.
+
+    Returns:
+        bool: true if the sidecar is open, false if it cannot be used
+        (the catalog must then be saved in full).
+*/
+bool seat_counters_open(const char *filepath, const char *catalog_path, array_ptr array) {
+    CHECK_NULL(filepath);
+    CHECK_NULL(array);
+    if (counters_fd >= 0) {
+        fprintf(stderr, "Seat counters are already open\n");
+        exit(1);
+    }
+
+    int fd = open(filepath, O_RDWR);
+    bool read = fd >= 0 && read_header(fd, &counters_header) && recover_flush(fd);
+    if (!read) {
+        // a new file starts from the clock, past the generations a lost
+        // one may have handed out to logs still waiting to be replayed
+        memset(&counters_header, 0, sizeof(counters_header));
+        counters_header.generation = counters_header.completed = (uint32_t)time(NULL);
+    }
+    flush_generation = 0;
+
+    bool applied = read && header_is_current(&counters_header, catalog_path, array)
+                && apply_blocks(fd, filepath, &counters_header, array);
+    if (!applied) {
+        if (fd >= 0) close(fd);
+        if (!write_sidecar(filepath, catalog_path, array)) return false;
+        fd = open(filepath, O_RDWR);
+        if (fd < 0) return false;
+    }
+
+    counters_fd = fd;
+    counters_path = mem_alloc(MEM_TAG_IO, strlen(filepath) + 1);
+    strcpy(counters_path, filepath);
+    dirty_count = 0;
+    memset(dirty_bits, 0, sizeof(dirty_bits));
+    return true;
+}
+
+/*
+    Tells whether a sidecar is open.
+
+    Returns:
+        bool: true after a successful seat_counters_open.
+*/
+bool seat_counters_is_open(void) {
+    return counters_fd >= 0;
+}
+
+/*
+    Records that the seats_booked counter of a course changed.
+
+    Parameters:
+        course: the changed course.
+
+    Pre-conditions:
+        course must not be NULL and must stay alive until the next flush.
+
+    Post-conditions:
+        The course is in the dirty set once, however many times it is
+        marked; nothing happens if no sidecar is open. A course past the
+        end of the sidecar grows it, under the same catalog stamp.
+        Exits the program if the sidecar cannot be grown.
+*/
+void seat_counters_mark(course_ptr course) {
+    CHECK_NULL(course);
+    if (counters_fd < 0) return;
+
+    uint16_t id = get_course_id(course);
+    if (id >= counters_entries) {
+        uint32_t entries = (id / SEAT_COUNTERS_BLOCK + 1u) * SEAT_COUNTERS_BLOCK;
+        seat_counters_block *table = mem_calloc(MEM_TAG_IO, entries / SEAT_COUNTERS_BLOCK, sizeof(*table));
+        memcpy(table, blocks, counters_entries / SEAT_COUNTERS_BLOCK * sizeof(*table));
+        for (uint32_t b = counters_entries / SEAT_COUNTERS_BLOCK; b < entries / SEAT_COUNTERS_BLOCK; b++)
+            table[b].checksum = block_checksum(&table[b]);
+        if (!replace_sidecar(table, entries)) {
+            fprintf(stderr, "Failed to grow seat counters: %s\n", strerror(errno));
+            exit(1);
+        }
+    }
+    uint8_t mask = (uint8_t)(1u << (id % 8));
+    if (dirty_bits[id / 8] & mask) return;
+    dirty_bits[id / 8] |= mask;
+
+    if (dirty_count == dirty_capacity) {
+        dirty_capacity = dirty_capacity ? dirty_capacity * 2 : 16;
+        dirty_courses = mem_realloc(dirty_courses, MEM_TAG_IO, dirty_capacity * sizeof(*dirty_courses));
+    }
+    dirty_courses[dirty_count++] = course;
+}
+
+/*
+    Drops a course from the dirty set, before the course is freed. Its
+    counter is not written; the dirty set is small, so it is searched.
+
+    Parameters:
+        course: the course.
+
+    Pre-conditions:
+        course must not be NULL.
+
+    Post-conditions:
+        The dirty set no longer refers to the course.
+*/
+void seat_counters_forget(course_ptr course) {
+    CHECK_NULL(course);
+    uint16_t id = get_course_id(course);
+    uint8_t mask = (uint8_t)(1u << (id % 8));
+    if (!(dirty_bits[id / 8] & mask)) return;
+    dirty_bits[id / 8] &= (uint8_t)~mask;
+
+    for (uint32_t i = 0; i < dirty_count; i++) {
+        if (dirty_courses[i] == course) {
+            dirty_courses[i] = dirty_courses[--dirty_count];
+            return;
+        }
+    }
+}
+
+/*
+    Hands out the generation the next seat_counters_flush writes. The
+    generation is persisted before it is returned, so it is never handed
+    out again, even after a crash.
+
+    Post-conditions:
+        Calling it again before the flush returns the same generation.
+        Exits the program on a write error.
+
+    Returns:
+        uint32_t: the generation, 0 if no sidecar is open or no course
+        is dirty (the flush then writes nothing).
+*/
+uint32_t seat_counters_reserve(void) {
+    if (counters_fd < 0 || dirty_count == 0) return 0;
+    if (flush_generation) return flush_generation;
+
+    counters_header.generation++;
+    write_header();
+    flush_generation = counters_header.generation;
+    return flush_generation;
+}
+
+/*
+    Writes the counter of every dirty course and syncs the file. The
+    changed blocks go to a journal first, so the flush lands whole or
+    not at all; its generation is reserved first if seat_counters_reserve
+    was not called.
+
+    Post-conditions:
+        The dirty set is empty. Exits the program on a write error.
+
+    Returns:
+        uint32_t: number of counters written.
+*/
+uint32_t seat_counters_flush(void) {
+    uint32_t generation = seat_counters_reserve();
+    if (generation == 0) return 0;
+
+    // the changed blocks, each once, with their new counters and checksum
+    seat_counters_block *written = mem_alloc(MEM_TAG_IO, dirty_count * sizeof(*written));
+    uint32_t *indexes = mem_alloc(MEM_TAG_IO, dirty_count * sizeof(*indexes));
+    uint32_t block_count = 0;
+    for (uint32_t i = 0; i < dirty_count; i++) {
+        uint16_t id = get_course_id(dirty_courses[i]);
+        if (id >= counters_entries) {
+            fprintf(stderr, "Failed to update seat counter of course %u\n", id);
+            exit(1);
+        }
+        blocks[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK] = get_course_seats_booked(dirty_courses[i]);
+    }
+    for (uint32_t i = 0; i < dirty_count; i++) {
+        uint16_t id = get_course_id(dirty_courses[i]);
+        uint8_t mask = (uint8_t)(1u << (id % 8));
+        if (!(dirty_bits[id / 8] & mask)) continue;
+
+        uint32_t b = id / SEAT_COUNTERS_BLOCK;
+        blocks[b].checksum = block_checksum(&blocks[b]);
+        written[block_count] = blocks[b];
+        indexes[block_count++] = b;
+        // the whole block is clean now
+        memset(&dirty_bits[b * SEAT_COUNTERS_BLOCK / 8], 0, SEAT_COUNTERS_BLOCK / 8);
+    }
+
+    seat_counters_journal journal = { generation, block_count, 0 };
+    journal.checksum = crc32c(0, &journal, offsetof(seat_counters_journal, checksum));
+    journal.checksum = crc32c(journal.checksum, written, block_count * sizeof(*written));
+    journal.checksum = crc32c(journal.checksum, indexes, block_count * sizeof(*indexes));
+    off_t offset = block_offset(counters_entries / SEAT_COUNTERS_BLOCK);
+    bool valid = write_at(counters_fd, &journal, sizeof(journal), offset)
+              && write_at(counters_fd, written, block_count * sizeof(*written), offset + (off_t)sizeof(journal))
+              && write_at(counters_fd, indexes, block_count * sizeof(*indexes),
+                          offset + (off_t)(sizeof(journal) + block_count * sizeof(*written)))
+              && fdatasync(counters_fd) == 0;
+    for (uint32_t i = 0; valid && i < block_count; i++)
+        valid = write_at(counters_fd, &written[i], sizeof(written[i]), block_offset(indexes[i]));
+    mem_free(written);
+    mem_free(indexes);
+    if (!valid) {
+        fprintf(stderr, "Failed to update seat counters: %s\n", strerror(errno));
+        exit(1);
+    }
+    counters_header.completed = generation;
+    write_header();
+
+    uint32_t flushed = dirty_count;
+    dirty_count = 0;
+    flush_generation = 0;
+    return flushed;
+}
+
+/*
+    Tells whether the flush of a generation reached the sidecar.
+
+    Parameters:
+        generation: generation handed out by seat_counters_reserve.
+
+    Returns:
+        bool: true if every counter of that flush is on disk, false if
+        the flush was interrupted before its journal was complete, or no
+        sidecar is open.
+*/
+bool seat_counters_flushed(uint32_t generation) {
+    if (counters_fd < 0 || generation == 0 || generation > counters_header.completed) return false;
+    for (uint32_t i = 0; i < counters_header.failed_count; i++) {
+        if (counters_header.failed[i] == generation) return false;
+    }
+    return true;
+}
+
+/*
+    Stamps the open sidecar with a new text catalog, after the catalog
+    was written or reloaded. Each course gets the counter persisted for
+    it: its current value, or for a dirty course the value on disk, since
+    its changes are still to be flushed; courses no longer in the catalog
+    lose theirs. The file is replaced atomically.
+
+    Parameters:
+        catalog_path: path of the text catalog.
+        array: catalog.
+
+    Pre-conditions:
+        A sidecar is open; array must not be NULL.
+
+    Post-conditions:
+        The dirty set and the generations are kept.
+
+    Returns:
+        bool: false if the sidecar cannot be written; it is then left
+        stamped with the old catalog.
+*/
+bool seat_counters_restamp(const char *catalog_path, array_ptr array) {
+    CHECK_NULL(catalog_path);
+    CHECK_NULL(array);
+    seat_counters_header stamp = counters_header;
+    if (counters_fd < 0 || !stamp_catalog(&stamp, catalog_path)) return false;
+
+    uint32_t entries = entries_for(array);
+    seat_counters_block *table = mem_calloc(MEM_TAG_IO, entries / SEAT_COUNTERS_BLOCK, sizeof(*table));
+    for (uint16_t i = 0; i < get_size(array); i++) {
+        course_ptr course = *(course_ptr*)get_at(array, i);
+        uint16_t id = get_course_id(course);
+        uint16_t *slot = &table[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK];
+        if (!(dirty_bits[id / 8] & (1u << (id % 8))))
+            *slot = get_course_seats_booked(course);
+        else if (id < counters_entries)
+            *slot = blocks[id / SEAT_COUNTERS_BLOCK].counters[id % SEAT_COUNTERS_BLOCK];
+    }
+    for (uint32_t b = 0; b < entries / SEAT_COUNTERS_BLOCK; b++)
+        table[b].checksum = block_checksum(&table[b]);
+
+    seat_counters_header old = counters_header;
+    counters_header.catalog_size = stamp.catalog_size;
+    counters_header.catalog_mtime_sec = stamp.catalog_mtime_sec;
+    counters_header.catalog_mtime_nsec = stamp.catalog_mtime_nsec;
+    if (!replace_sidecar(table, entries)) {
+        counters_header = old;
+        return false;
+    }
+    return true;
+}
+
+/*
+    Closes the sidecar, dropping the dirty set and the journal of the
+    last flush.
+
+    Post-conditions:
+        No sidecar is open.
+*/
+void seat_counters_close(void) {
+    if (counters_fd < 0) return;
+    // the journal of a completed flush is not needed any more
+    if (counters_header.completed == counters_header.generation)
+        ftruncate(counters_fd, block_offset(counters_entries / SEAT_COUNTERS_BLOCK));
+    close(counters_fd);
+    counters_fd = -1;
+    mem_free(counters_path);
+    counters_path = NULL;
+    mem_free(blocks);
+    blocks = NULL;
+    mem_free(dirty_courses);
+    dirty_courses = NULL;
+    dirty_count = dirty_capacity = 0;
+    flush_generation = 0;
+}
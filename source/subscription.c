@@ -5,11 +5,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-struct subscription {
-    datetime_ptr start_date;
-    datetime_ptr end_date;
-};
-
 /*
     Creates a new subscription object with specified start and end dates.
 
@@ -19,7 +14,7 @@ struct subscription {
 
     Pre-conditions:
         start_date and end_date must not be NULL.
-        The datetime objects are managed externally (no internal copying).
+        The datetime values are copied; the caller keeps ownership of the arguments.
 
     Post-conditions:
         A new subscription object is allocated and initialized.
@@ -34,15 +29,44 @@ subscription_ptr create_subscription(
     CHECK_NULL(start_date);
     CHECK_NULL(end_date);
 
-    subscription_ptr new_subscription = malloc(sizeof(struct subscription));
-    CHECK_NULL(new_subscription);
+    subscription_ptr new_subscription = mem_alloc(MEM_TAG_SUBSCRIPTION, sizeof(struct subscription));
 
-    new_subscription->start_date = start_date;
-    new_subscription->end_date = end_date;
+    init_subscription(new_subscription, start_date, end_date);
 
     return new_subscription;
 }
 
+/*
+    Fills an existing subscription (for example one embedded in a user)
+    with copies of the given dates.
+
+    Parameters:
+        subscription: pointer to the subscription to fill.
+        start_date: pointer to an initialized datetime object.
+        end_date: pointer to an initialized datetime object.
+
+    Pre-conditions:
+        All parameters must not be NULL.
+
+    Post-conditions:
+        subscription holds copies of start_date and end_date.
+
+    Returns:
+        None.
+*/
+void init_subscription(
+    subscription_ptr subscription,
+    datetime_ptr start_date,
+    datetime_ptr end_date
+) {
+    CHECK_NULL(subscription);
+    CHECK_NULL(start_date);
+    CHECK_NULL(end_date);
+
+    subscription->start_date = *start_date;
+    subscription->end_date = *end_date;
+}
+
 /*
     Returns the start date of a subscription.
 
@@ -60,7 +84,7 @@ subscription_ptr create_subscription(
 */
 datetime_ptr get_subscription_start_date(subscription_ptr subscription) {
     CHECK_NULL(subscription);
-    return subscription->start_date;
+    return &subscription->start_date;
 }
 
 /*
@@ -80,7 +104,7 @@ datetime_ptr get_subscription_start_date(subscription_ptr subscription) {
 */
 datetime_ptr get_subscription_end_date(subscription_ptr subscription) {
     CHECK_NULL(subscription);
-    return subscription->end_date;
+    return &subscription->end_date;
 }
 
 /*
@@ -94,12 +118,12 @@ datetime_ptr get_subscription_end_date(subscription_ptr subscription) {
         subscription and start_date must not be NULL.
 
     Post-conditions:
-        The subscription's start date is updated.
+        The subscription's start date is updated with a copy of start_date.
 */
 void set_subscription_start_date(subscription_ptr subscription, datetime_ptr start_date) {
     CHECK_NULL(subscription);
     CHECK_NULL(start_date);
-    subscription->start_date = start_date;
+    subscription->start_date = *start_date;
 }
 
 /*
@@ -113,12 +137,12 @@ void set_subscription_start_date(subscription_ptr subscription, datetime_ptr sta
         subscription and end_date must not be NULL.
 
     Post-conditions:
-        The subscription's end date is updated.
+        The subscription's end date is updated with a copy of end_date.
 */
 void set_subscription_end_date(subscription_ptr subscription, datetime_ptr end_date) {
     CHECK_NULL(subscription);
     CHECK_NULL(end_date);
-    subscription->end_date = end_date;
+    subscription->end_date = *end_date;
 }
 
 /*
@@ -156,16 +180,16 @@ void print_subscription(subscription_ptr subscription) {
     CHECK_NULL(subscription);
 
     printf("Start Date: ");
-    print_datetime(stdout, subscription->start_date);
+    print_datetime(stdout, &subscription->start_date);
     printf("\n");
 
     printf("End Date: ");
-    print_datetime(stdout, subscription->end_date);
+    print_datetime(stdout, &subscription->end_date);
     printf("\n");
 }
 
 /*
-    Frees the memory allocated for a subscription, including its datetime objects.
+    Frees the memory allocated for a subscription; its dates are stored inline.
 
     Parameters:
         subscription: pointer to the subscription to free.
@@ -174,12 +198,9 @@ void print_subscription(subscription_ptr subscription) {
         subscription must not be NULL.
 
     Post-conditions:
-        Memory for the subscription and its datetime fields is deallocated.
+        Memory for the subscription is deallocated.
 */
 void delete_subscription(subscription_ptr subscription) {
     CHECK_NULL(subscription);
-
-    free(subscription->start_date);
-    free(subscription->end_date);
-    free(subscription);
+    mem_free(subscription);
 }
\ No newline at end of file
@@ -7,18 +7,29 @@
 #include <stdlib.h>
 #include <string.h>
 
+/*
+    A user is a single allocation: the subscription and last report date
+    are embedded by value and the five strings are packed one after the
+    other in the trailing `strings` buffer, with the pointers below
+    referring into it.
+*/
 struct user {
     char* CF;
     char* first_name;
     char* last_name;
     char* username;
     char* password;
-    subscription_ptr subscription;
-    datetime_ptr last_report_date;
+    struct subscription subscription;
+    struct datetime last_report_date;
+    // history line not parsed yet, NULL once the history list is built
+    char* history_text;
+    size_t history_length;
+    char strings[];
 };
 
 /*
-    Allocates and initializes a new user object with deep-copied strings.
+    Allocates and initializes a new user record in a single session-scoped block.
+    The strings, subscription and last report date are copied into it.
 
     Parameters:
         CF: user's codice fiscale (null-terminated string).
@@ -33,7 +44,8 @@ struct user {
         All string parameters and pointers must not be NULL.
 
     Post-conditions:
-        A new user is returned with duplicated strings; subscription and last_report_date are referenced.
+        A new user is returned holding copies of every argument;
+        the caller keeps ownership of the arguments.
 
     Returns:
         Pointer to the newly created user object.
@@ -55,26 +67,30 @@ user_ptr create_user(
     CHECK_NULL(subscription);
     CHECK_NULL(last_report_date);
 
-    user_ptr new_user = malloc(sizeof(struct user));
-    CHECK_NULL(new_user);
-
-    new_user->CF = str_dup(CF);
-    CHECK_NULL(new_user->CF);
-
-    new_user->first_name = str_dup(first_name);
-    CHECK_NULL(new_user->first_name);
-
-    new_user->last_name = str_dup(last_name);
-    CHECK_NULL(new_user->last_name);
-
-    new_user->username = str_dup(username);
-    CHECK_NULL(new_user->username);
-
-    new_user->password = str_dup(password);
-    CHECK_NULL(new_user->password);
-
-    new_user->subscription = subscription;
-    new_user->last_report_date = last_report_date;
+    size_t CF_size = strlen(CF) + 1;
+    size_t first_name_size = strlen(first_name) + 1;
+    size_t last_name_size = strlen(last_name) + 1;
+    size_t username_size = strlen(username) + 1;
+    size_t password_size = strlen(password) + 1;
+
+    user_ptr new_user = session_alloc(MEM_TAG_USER, sizeof(struct user)
+        + CF_size + first_name_size + last_name_size + username_size + password_size);
+
+    char* p = new_user->strings;
+    new_user->CF = memcpy(p, CF, CF_size);
+    p += CF_size;
+    new_user->first_name = memcpy(p, first_name, first_name_size);
+    p += first_name_size;
+    new_user->last_name = memcpy(p, last_name, last_name_size);
+    p += last_name_size;
+    new_user->username = memcpy(p, username, username_size);
+    p += username_size;
+    new_user->password = memcpy(p, password, password_size);
+
+    new_user->subscription = *subscription;
+    new_user->last_report_date = *last_report_date;
+    new_user->history_text = NULL;
+    new_user->history_length = 0;
 
     return new_user;
 }
@@ -192,11 +208,11 @@ char* get_user_password(user_ptr user) {
         None.
 
     Returns:
-        subscription_ptr: pointer to the user's subscription.
+        subscription_ptr: pointer to the subscription embedded in the user.
 */
 subscription_ptr get_user_subscription(user_ptr user) {
     CHECK_NULL(user);
-    return user->subscription;
+    return &user->subscription;
 }
 
 /*
@@ -213,11 +229,11 @@ subscription_ptr get_user_subscription(user_ptr user) {
 */
 datetime_ptr get_user_last_report_date(user_ptr user) {
     CHECK_NULL(user);
-    return user->last_report_date;
+    return &user->last_report_date;
 }
 
 /*
-    Updates the user's last report date, replacing the previous datetime.
+    Updates the user's last report date with a copy of the given datetime.
 
     Parameters:
         user: pointer to a valid user object.
@@ -227,16 +243,54 @@ datetime_ptr get_user_last_report_date(user_ptr user) {
         user and last_report must not be NULL.
 
     Post-conditions:
-        Replaces the old datetime (freed) with the new one.
+        The embedded last report date equals last_report;
+        the caller keeps ownership of last_report.
 */
 void set_user_last_report_date(user_ptr user, datetime_ptr last_report) {
     CHECK_NULL(user);
     CHECK_NULL(last_report);
 
-    if (user->last_report_date != last_report) {
-        free(user->last_report_date);
-    }
-    user->last_report_date = last_report;
+    user->last_report_date = *last_report;
+}
+
+/*
+    Keeps the serialized history of the user until it is first needed.
+
+    Parameters:
+        user: pointer to a valid user object.
+        text: history line, or NULL once the history list is built.
+        length: length of text.
+
+    Pre-conditions:
+        user must not be NULL; text must live as long as the user
+        (e.g. allocated in the session arena).
+
+    Post-conditions:
+        The user refers to text, which is not copied.
+*/
+void set_user_history_text(user_ptr user, char* text, size_t length) {
+    CHECK_NULL(user);
+    user->history_text = text;
+    user->history_length = text ? length : 0;
+}
+
+/*
+    Returns the serialized history not parsed yet.
+
+    Parameters:
+        user: pointer to a valid user object.
+        length: output, receives the length of the text (may be NULL).
+
+    Pre-conditions:
+        user must not be NULL.
+
+    Returns:
+        char*: the history line, or NULL if there is none pending.
+*/
+char* get_user_history_text(user_ptr user, size_t* length) {
+    CHECK_NULL(user);
+    if (length) *length = user->history_length;
+    return user->history_text;
 }
 
 /*
@@ -259,9 +313,9 @@ void print_user(user_ptr user) {
     printf("Username    : %s\n", user->username);
     printf("Password    : %s\n", user->password);
     printf("Subscription:\n");
-    print_subscription(user->subscription);
+    print_subscription(&user->subscription);
     printf("Last Report : ");
-    print_datetime(stdout, user->last_report_date);
+    print_datetime(stdout, &user->last_report_date);
     printf("\n");
 }
 
@@ -275,18 +329,9 @@ void print_user(user_ptr user) {
         user must not be NULL.
 
     Post-conditions:
-        All associated memory is freed.
+        The user record, including its inline strings and dates, is freed.
 */
 void delete_user(user_ptr user) {
     CHECK_NULL(user);
-
-    free(user->CF);
-    free(user->first_name);
-    free(user->last_name);
-    free(user->username);
-    free(user->password);
-
-    delete_subscription(user->subscription);
-    delete_datetime(user->last_report_date);
-    free(user);
+    session_free(user);
 }
\ No newline at end of file
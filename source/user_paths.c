@@ -0,0 +1,171 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "user_paths.h"
+#include "utils.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/*
+    Builds the path of a per-user file inside its shard directory.
+    The first level is the low byte of the username hash, the second
+    level the next byte.
+
+    Parameters:
+        buffer: destination of the path.
+        size: size of buffer.
+        users_path: root of the user tree, ending with '/'.
+        username: owner of the file.
+        suffix: file name suffix, e.g. ".txt".
+
+    Pre-conditions:
+        All pointers must not be NULL.
+
+    Returns:
+        bool: false if the path does not fit in buffer.
+*/
+bool user_file_path(char *buffer, size_t size, const char *users_path, const char *username, const char *suffix) {
+    CHECK_NULL(buffer);
+    CHECK_NULL(users_path);
+    CHECK_NULL(username);
+    CHECK_NULL(suffix);
+
+    uint32_t hash = str_hash(username, strlen(username));
+    int length = snprintf(buffer, size, "%s%02x/%02x/%s%s", users_path,
+                          (unsigned)(hash % USER_SHARD_FANOUT),
+                          (unsigned)(hash / USER_SHARD_FANOUT % USER_SHARD_FANOUT),
+                          username, suffix);
+    return length >= 0 && (size_t)length < size;
+}
+
+/*
+    Creates a directory, accepting one that already exists.
+
+    Parameters:
+        path: directory to create.
+
+    Returns:
+        bool: false if the directory cannot be created.
+*/
+static bool make_dir(const char *path) {
+    return mkdir(path, 0777) == 0 || errno == EEXIST;
+}
+
+/*
+    Creates the shard directories of a user if they do not exist.
+
+    Parameters:
+        users_path: root of the user tree, ending with '/'.
+        username: owner of the directories.
+
+    Pre-conditions:
+        users_path must exist.
+
+    Returns:
+        bool: false if a directory cannot be created.
+*/
+bool user_file_dirs(const char *users_path, const char *username) {
+    char path[512];
+    if (!user_file_path(path, sizeof(path), users_path, username, "")) return false;
+
+    // cut the path after each level in turn
+    size_t root = strlen(users_path);
+    path[root + 2] = '\0';
+    if (!make_dir(path)) return false;
+    path[root + 2] = '/';
+    path[root + 5] = '\0';
+    return make_dir(path);
+}
+
+/*
+    Returns the username a file name belongs to.
+
+    Parameters:
+        name: file name.
+        suffixes: recognised suffixes.
+        count: number of suffixes.
+        username: destination of the username.
+        size: size of username.
+
+    Returns:
+        int: index of the matching suffix, or -1 if the name has none.
+*/
+static int split_user_file(const char *name, const char *const *suffixes, int count, char *username, size_t size) {
+    size_t length = strlen(name);
+    for (int i = 0; i < count; i++) {
+        size_t suffix_length = strlen(suffixes[i]);
+        if (length <= suffix_length || length - suffix_length >= size) continue;
+        if (strcmp(name + length - suffix_length, suffixes[i]) != 0) continue;
+
+        memcpy(username, name, length - suffix_length);
+        username[length - suffix_length] = '\0';
+        return i;
+    }
+    return -1;
+}
+
+/*
+    Moves the per-user files left directly in the root of the user tree
+    into their shard directories. A file belongs to a user if its name is
+    the username followed by one of the suffixes; a file that already
+    exists in the shard is never overwritten.
+
+    Parameters:
+        users_path: root of the user tree, ending with '/'.
+        suffixes: recognised file name suffixes.
+        count: number of suffixes.
+
+    Pre-conditions:
+        No other process uses the files being moved.
+
+    Post-conditions:
+        Files that cannot be moved are reported on stderr and left in place.
+
+    Returns:
+        uint32_t: number of files moved.
+*/
+uint32_t migrate_user_files(const char *users_path, const char *const *suffixes, int count) {
+    CHECK_NULL(users_path);
+    CHECK_NULL(suffixes);
+
+    DIR *dir = opendir(users_path);
+    if (!dir) {
+        fprintf(stderr, "Cannot open %s: %s\n", users_path, strerror(errno));
+        return 0;
+    }
+
+    uint32_t moved = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        char username[256];
+        char source[512];
+        char target[512];
+        struct stat st;
+
+        int suffix = split_user_file(entry->d_name, suffixes, count, username, sizeof(username));
+        if (suffix < 0) continue;
+        if ((size_t)snprintf(source, sizeof(source), "%s%s", users_path, entry->d_name) >= sizeof(source)
+            || lstat(source, &st) != 0 || !S_ISREG(st.st_mode)) continue;
+
+        if (!user_file_path(target, sizeof(target), users_path, username, suffixes[suffix])
+            || !user_file_dirs(users_path, username)) {
+            fprintf(stderr, "Cannot create the directory of %s\n", source);
+            continue;
+        }
+        if (stat(target, &st) == 0) {
+            fprintf(stderr, "Not moving %s: %s already exists\n", source, target);
+            continue;
+        }
+        if (rename(source, target) != 0) {
+            fprintf(stderr, "Cannot move %s: %s\n", source, strerror(errno));
+            continue;
+        }
+        moved++;
+    }
+
+    closedir(dir);
+    return moved;
+}
@@ -0,0 +1,722 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "user_store.h"
+#include "crc32c.h"
+#include "out_buffer.h"
+#include "utils.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define USER_DATA_MAGIC "MFUD"
+#define USER_INDEX_MAGIC "MFUI"
+
+/* Page 0 of the data file; the rest of the page is zero */
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t page_size;
+    uint32_t reserved;
+} user_data_header;
+
+/*
+    Start of the first page of every record, followed by key and value;
+    checksum is the CRC32C of the other header fields, key and value.
+*/
+typedef struct {
+    uint32_t key_length;
+    uint32_t value_length;
+    uint32_t page_count;
+    uint32_t checksum;
+} user_record_header;
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t reserved;
+} user_index_header;
+
+/* Slot of the index; first_page 0 marks an empty slot (page 0 is the header) */
+typedef struct {
+    uint32_t hash;
+    uint32_t first_page;
+    uint32_t page_count;
+} user_index_entry;
+
+/* Run of consecutive free pages */
+typedef struct {
+    uint32_t first_page;
+    uint32_t page_count;
+} page_extent;
+
+struct user_store {
+    int data_fd;
+    int index_fd;
+    char *index_path;
+    uint32_t data_pages;
+    uint32_t capacity;
+    uint32_t count;
+    user_index_entry *entries;
+    // free runs sorted by first page, built on the first allocation
+    bool free_ready;
+    page_extent *free_runs;
+    uint32_t free_count;
+    uint32_t free_capacity;
+};
+
+/*
+    Prints an error about a store file and terminates the program.
+
+    Parameters:
+        action: what failed.
+        path: file involved (may be NULL).
+*/
+static void store_fail(const char *action, const char *path) {
+    fprintf(stderr, "User store: %s %s: %s\n", action, path ? path : "", strerror(errno));
+    exit(1);
+}
+
+/*
+    Reads exactly length bytes at an offset.
+
+    Returns:
+        bool: false on error or short file.
+*/
+static bool read_at(int fd, void *data, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pread(fd, (char *)data + done, length - done, offset + (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+/*
+    Writes exactly length bytes at an offset, terminating the program on error.
+*/
+static void write_at(int fd, const void *data, size_t length, off_t offset) {
+    size_t done = 0;
+    while (done < length) {
+        ssize_t n = pwrite(fd, (const char *)data + done, length - done, offset + (off_t)done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) store_fail("failed to write", NULL);
+        done += (size_t)n;
+    }
+}
+
+/*
+    Returns the file offset of an index slot.
+*/
+static off_t slot_offset(uint32_t slot) {
+    return (off_t)sizeof(user_index_header) + (off_t)slot * (off_t)sizeof(user_index_entry);
+}
+
+/*
+    Writes a complete index with the given entries to a new file that
+    atomically replaces the index, then reopens it.
+
+    Parameters:
+        store: the store (index_fd is replaced).
+        entries: slots to write.
+        capacity: number of slots.
+*/
+static void write_index(user_store_ptr store, const user_index_entry *entries, uint32_t capacity) {
+    user_index_header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, USER_INDEX_MAGIC, sizeof(header.magic));
+    header.version = USER_INDEX_VERSION;
+    header.capacity = capacity;
+
+    out_buffer_ptr out = out_buffer_open(store->index_path);
+    if (!out) store_fail("cannot create", store->index_path);
+    out_append_bytes(out, &header, sizeof(header));
+    out_append_bytes(out, entries, capacity * sizeof(*entries));
+    if (!out_buffer_close(out)) store_fail("cannot write", store->index_path);
+
+    if (store->index_fd >= 0) close(store->index_fd);
+    store->index_fd = open(store->index_path, O_RDWR);
+    if (store->index_fd < 0) store_fail("cannot open", store->index_path);
+}
+
+/*
+    Opens the data file, writing its header page if it is new.
+
+    Parameters:
+        store: the store (data_fd and data_pages are set).
+        data_path: path of the data file.
+*/
+static void open_data(user_store_ptr store, const char *data_path) {
+    store->data_fd = open(data_path, O_RDWR | O_CREAT, 0666);
+    if (store->data_fd < 0) store_fail("cannot open", data_path);
+
+    struct stat st;
+    if (fstat(store->data_fd, &st) != 0) store_fail("cannot stat", data_path);
+
+    char page[USER_STORE_PAGE_SIZE];
+    user_data_header header;
+    if (st.st_size == 0) {
+        memset(page, 0, sizeof(page));
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, USER_DATA_MAGIC, sizeof(header.magic));
+        header.version = USER_STORE_VERSION;
+        header.page_size = USER_STORE_PAGE_SIZE;
+        memcpy(page, &header, sizeof(header));
+        write_at(store->data_fd, page, sizeof(page), 0);
+        if (fdatasync(store->data_fd) != 0) store_fail("cannot sync", data_path);
+        store->data_pages = 1;
+        return;
+    }
+
+    if (!read_at(store->data_fd, &header, sizeof(header), 0)
+        || memcmp(header.magic, USER_DATA_MAGIC, sizeof(header.magic)) != 0
+        || header.version != USER_STORE_VERSION
+        || header.page_size != USER_STORE_PAGE_SIZE) {
+        fprintf(stderr, "User store: %s is not a user data file\n", data_path);
+        exit(1);
+    }
+    // a partial page left by an interrupted append is overwritten later
+    store->data_pages = (uint32_t)(st.st_size / USER_STORE_PAGE_SIZE);
+}
+
+/*
+    Loads the index into memory, creating an empty one if it is missing,
+    and checks that every entry points inside the data file.
+
+    Parameters:
+        store: the store (entries, capacity and count are set).
+*/
+static void open_index(user_store_ptr store) {
+    store->index_fd = open(store->index_path, O_RDWR);
+    if (store->index_fd < 0) {
+        if (errno != ENOENT) store_fail("cannot open", store->index_path);
+        store->capacity = USER_STORE_INITIAL_INDEX;
+        store->entries = mem_calloc(MEM_TAG_IO, store->capacity, sizeof(*store->entries));
+        store->count = 0;
+        write_index(store, store->entries, store->capacity);
+        return;
+    }
+
+    user_index_header header;
+    if (!read_at(store->index_fd, &header, sizeof(header), 0)
+        || memcmp(header.magic, USER_INDEX_MAGIC, sizeof(header.magic)) != 0
+        || header.version != USER_INDEX_VERSION
+        || header.capacity == 0 || (header.capacity & (header.capacity - 1)) != 0) {
+        fprintf(stderr, "User store: %s is not a user index file\n", store->index_path);
+        exit(1);
+    }
+
+    store->capacity = header.capacity;
+    store->entries = mem_alloc(MEM_TAG_IO, store->capacity * sizeof(*store->entries));
+    if (!read_at(store->index_fd, store->entries, store->capacity * sizeof(*store->entries), slot_offset(0))) {
+        fprintf(stderr, "User store: %s is truncated\n", store->index_path);
+        exit(1);
+    }
+
+    store->count = 0;
+    for (uint32_t i = 0; i < store->capacity; i++) {
+        user_index_entry *entry = &store->entries[i];
+        if (entry->first_page == 0) continue;
+        if (entry->page_count == 0 || entry->first_page >= store->data_pages
+            || entry->page_count > store->data_pages - entry->first_page) {
+            fprintf(stderr, "User store: %s points outside the data file\n", store->index_path);
+            exit(1);
+        }
+        store->count++;
+    }
+}
+
+/*
+    Computes the checksum of a record.
+
+    Parameters:
+        header: record header (its checksum field is ignored).
+        data: key immediately followed by value.
+
+    Returns:
+        uint32_t: CRC32C of the header fields before checksum, key and value.
+*/
+static uint32_t record_checksum(const user_record_header *header, const char *data) {
+    uint32_t crc = crc32c(0, header, offsetof(user_record_header, checksum));
+    return crc32c(crc, data, (size_t)header->key_length + header->value_length);
+}
+
+/*
+    Reads the whole page run of an indexed record.
+
+    Parameters:
+        store: the store.
+        entry: occupied index slot.
+        buffer: in/out, reusable buffer grown to the run size.
+        buffer_size: in/out, size of *buffer.
+        header: output, the record header.
+
+    Returns:
+        bool: false if the run cannot be read, its lengths do not fit in
+        it, or it fails its checksum.
+*/
+static bool read_record(user_store_ptr store, const user_index_entry *entry,
+                        char **buffer, size_t *buffer_size, user_record_header *header) {
+    size_t size = (size_t)entry->page_count * USER_STORE_PAGE_SIZE;
+    if (size > *buffer_size) {
+        *buffer_size = size;
+        *buffer = mem_realloc(*buffer, MEM_TAG_IO, size);
+    }
+
+    // one read per record
+    if (!read_at(store->data_fd, *buffer, size, (off_t)entry->first_page * USER_STORE_PAGE_SIZE)) return false;
+    memcpy(header, *buffer, sizeof(*header));
+    if (sizeof(*header) + (size_t)header->key_length + header->value_length > size) return false;
+    return record_checksum(header, *buffer + sizeof(*header)) == header->checksum;
+}
+
+/*
+    Opens a store, creating its files if they do not exist.
+
+    Parameters:
+        data_path: path of the data file.
+        index_path: path of the index file.
+
+    Pre-conditions:
+        Both paths must be valid strings.
+
+    Returns:
+        user_store_ptr: the store; exits the program if the files cannot
+        be created or are not a store.
+*/
+user_store_ptr user_store_open(const char *data_path, const char *index_path) {
+    CHECK_NULL(data_path);
+    CHECK_NULL(index_path);
+
+    user_store_ptr store = mem_calloc(MEM_TAG_IO, 1, sizeof(*store));
+    store->index_fd = -1;
+    store->index_path = str_dup(index_path);
+    open_data(store, data_path);
+    open_index(store);
+    return store;
+}
+
+/*
+    Tells whether the record starting at an index entry has the given key.
+
+    Parameters:
+        store: the store.
+        entry: occupied index slot.
+        key: username.
+        length: username length.
+
+    Returns:
+        bool: true if the stored key matches.
+*/
+static bool entry_matches(user_store_ptr store, const user_index_entry *entry, const char *key, size_t length) {
+    char stack[sizeof(user_record_header) + 64];
+    size_t needed = sizeof(user_record_header) + length;
+    char *buffer = needed <= sizeof(stack) ? stack : mem_alloc(MEM_TAG_IO, needed);
+
+    user_record_header header;
+    bool match = read_at(store->data_fd, buffer, needed, (off_t)entry->first_page * USER_STORE_PAGE_SIZE);
+    if (match) {
+        memcpy(&header, buffer, sizeof(header));
+        match = header.key_length == length
+             && memcmp(buffer + sizeof(header), key, length) == 0;
+    }
+
+    if (buffer != stack) mem_free(buffer);
+    return match;
+}
+
+/*
+    Finds the slot of a key: the slot holding it, or the empty slot where
+    it would be inserted.
+
+    Parameters:
+        store: the store.
+        key: username.
+        length: username length.
+        hash: hash of the username.
+        found: output, true if the key is in the store.
+
+    Returns:
+        uint32_t: the slot.
+*/
+static uint32_t find_slot(user_store_ptr store, const char *key, size_t length, uint32_t hash, bool *found) {
+    uint32_t mask = store->capacity - 1;
+    for (uint32_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        user_index_entry *entry = &store->entries[slot];
+        if (entry->first_page == 0) {
+            *found = false;
+            return slot;
+        }
+        if (entry->hash == hash && entry_matches(store, entry, key, length)) {
+            *found = true;
+            return slot;
+        }
+    }
+}
+
+/*
+    Reads the record of a user.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+        length: output, receives the value length (may be NULL).
+
+    Pre-conditions:
+        store and username must not be NULL.
+
+    Returns:
+        char*: a null-terminated copy of the value, to be released with
+        mem_free, or NULL if the user is not in the store. Exits the
+        program if the record fails its checksum.
+*/
+char *user_store_get(user_store_ptr store, const char *username, size_t *length) {
+    CHECK_NULL(store);
+    CHECK_NULL(username);
+
+    size_t key_length = strlen(username);
+    bool found;
+    uint32_t slot = find_slot(store, username, key_length, str_hash(username, key_length), &found);
+    if (!found) return NULL;
+
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+    user_record_header header;
+    if (!read_record(store, &store->entries[slot], &buffer, &buffer_size, &header)) {
+        fprintf(stderr, "User store: record of %s (page %u) is corrupt\n",
+                username, store->entries[slot].first_page);
+        exit(1);
+    }
+
+    // the value is moved to the front of the run and terminated in place
+    memmove(buffer, buffer + sizeof(header) + header.key_length, header.value_length);
+    buffer[header.value_length] = '\0';
+    if (length) *length = header.value_length;
+    return buffer;
+}
+
+/*
+    Tells whether a user is in the store, without reading the value.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+
+    Pre-conditions:
+        store and username must not be NULL.
+
+    Returns:
+        bool: true if the user has a record.
+*/
+bool user_store_contains(user_store_ptr store, const char *username) {
+    CHECK_NULL(store);
+    CHECK_NULL(username);
+
+    size_t key_length = strlen(username);
+    bool found;
+    find_slot(store, username, key_length, str_hash(username, key_length), &found);
+    return found;
+}
+
+/*
+    Compares two extents by first page, for qsort.
+*/
+static int compare_extents(const void *a, const void *b) {
+    uint32_t first_a = ((const page_extent *)a)->first_page;
+    uint32_t first_b = ((const page_extent *)b)->first_page;
+    return (first_a > first_b) - (first_a < first_b);
+}
+
+/*
+    Appends a free run at the end of the free list.
+*/
+static void push_free_run(user_store_ptr store, uint32_t first_page, uint32_t page_count) {
+    if (store->free_count == store->free_capacity) {
+        store->free_capacity = store->free_capacity ? store->free_capacity * 2 : 16;
+        store->free_runs = mem_realloc(store->free_runs, MEM_TAG_IO,
+                                       store->free_capacity * sizeof(*store->free_runs));
+    }
+    store->free_runs[store->free_count].first_page = first_page;
+    store->free_runs[store->free_count].page_count = page_count;
+    store->free_count++;
+}
+
+/*
+    Builds the free list from the gaps between the records of the index,
+    which also reclaims pages orphaned by an interrupted put.
+
+    Parameters:
+        store: the store.
+*/
+static void build_free_runs(user_store_ptr store) {
+    page_extent *used = mem_alloc(MEM_TAG_IO, (store->count + 1) * sizeof(*used));
+    uint32_t used_count = 0;
+    for (uint32_t i = 0; i < store->capacity; i++) {
+        if (store->entries[i].first_page == 0) continue;
+        used[used_count].first_page = store->entries[i].first_page;
+        used[used_count].page_count = store->entries[i].page_count;
+        used_count++;
+    }
+    qsort(used, used_count, sizeof(*used), compare_extents);
+
+    uint32_t next = 1;
+    for (uint32_t i = 0; i < used_count; i++) {
+        if (used[i].first_page > next) push_free_run(store, next, used[i].first_page - next);
+        next = used[i].first_page + used[i].page_count;
+    }
+    // trailing free pages are given back to the end of the file
+    store->data_pages = next;
+
+    mem_free(used);
+    store->free_ready = true;
+}
+
+/*
+    Allocates a run of pages: the first free run large enough, or new
+    pages at the end of the data file.
+
+    Parameters:
+        store: the store.
+        page_count: number of pages needed.
+
+    Returns:
+        uint32_t: first page of the run.
+*/
+static uint32_t allocate_pages(user_store_ptr store, uint32_t page_count) {
+    if (!store->free_ready) build_free_runs(store);
+
+    for (uint32_t i = 0; i < store->free_count; i++) {
+        page_extent *run = &store->free_runs[i];
+        if (run->page_count < page_count) continue;
+
+        uint32_t first = run->first_page;
+        run->first_page += page_count;
+        run->page_count -= page_count;
+        if (run->page_count == 0) {
+            memmove(run, run + 1, (store->free_count - i - 1) * sizeof(*run));
+            store->free_count--;
+        }
+        return first;
+    }
+
+    uint32_t first = store->data_pages;
+    store->data_pages += page_count;
+    return first;
+}
+
+/*
+    Returns a run of pages to the free list, merging it with its neighbours.
+
+    Parameters:
+        store: the store.
+        first_page: first page of the run.
+        page_count: number of pages.
+*/
+static void release_pages(user_store_ptr store, uint32_t first_page, uint32_t page_count) {
+    uint32_t i = 0;
+    while (i < store->free_count && store->free_runs[i].first_page < first_page) i++;
+
+    bool joins_previous = i > 0
+        && store->free_runs[i - 1].first_page + store->free_runs[i - 1].page_count == first_page;
+    bool joins_next = i < store->free_count
+        && first_page + page_count == store->free_runs[i].first_page;
+
+    if (joins_previous) {
+        store->free_runs[i - 1].page_count += page_count;
+        if (joins_next) {
+            store->free_runs[i - 1].page_count += store->free_runs[i].page_count;
+            memmove(&store->free_runs[i], &store->free_runs[i + 1],
+                    (store->free_count - i - 1) * sizeof(*store->free_runs));
+            store->free_count--;
+        }
+    } else if (joins_next) {
+        store->free_runs[i].first_page = first_page;
+        store->free_runs[i].page_count += page_count;
+    } else {
+        push_free_run(store, 0, 0);
+        memmove(&store->free_runs[i + 1], &store->free_runs[i],
+                (store->free_count - i - 1) * sizeof(*store->free_runs));
+        store->free_runs[i].first_page = first_page;
+        store->free_runs[i].page_count = page_count;
+    }
+}
+
+/*
+    Doubles the index and rewrites it with every entry rehashed.
+
+    Parameters:
+        store: the store.
+*/
+static void grow_index(user_store_ptr store) {
+    uint32_t capacity = store->capacity * 2;
+    uint32_t mask = capacity - 1;
+    user_index_entry *entries = mem_calloc(MEM_TAG_IO, capacity, sizeof(*entries));
+
+    for (uint32_t i = 0; i < store->capacity; i++) {
+        user_index_entry *entry = &store->entries[i];
+        if (entry->first_page == 0) continue;
+        uint32_t slot = entry->hash & mask;
+        while (entries[slot].first_page != 0) slot = (slot + 1) & mask;
+        entries[slot] = *entry;
+    }
+
+    write_index(store, entries, capacity);
+    mem_free(store->entries);
+    store->entries = entries;
+    store->capacity = capacity;
+}
+
+/*
+    Inserts or replaces the record of a user. The record is written to
+    free pages and synced before the index entry is repointed to it.
+
+    Parameters:
+        store: the store.
+        username: key of the record.
+        value: record value.
+        length: value length in bytes.
+
+    Pre-conditions:
+        store, username and value must not be NULL.
+
+    Post-conditions:
+        The record is durable when the function returns.
+        Exits the program on a write error.
+*/
+void user_store_put(user_store_ptr store, const char *username, const char *value, size_t length) {
+    CHECK_NULL(store);
+    CHECK_NULL(username);
+    CHECK_NULL(value);
+
+    size_t key_length = strlen(username);
+    size_t record_size = sizeof(user_record_header) + key_length + length;
+    if (record_size > (size_t)UINT32_MAX - USER_STORE_PAGE_SIZE) {
+        fprintf(stderr, "User store: record of %s is too large\n", username);
+        exit(1);
+    }
+
+    // new copy of the record, page-aligned and zero padded
+    user_record_header header;
+    header.key_length = (uint32_t)key_length;
+    header.value_length = (uint32_t)length;
+    header.page_count = (uint32_t)((record_size + USER_STORE_PAGE_SIZE - 1) / USER_STORE_PAGE_SIZE);
+    uint32_t hash = str_hash(username, key_length);
+
+    size_t padded = (size_t)header.page_count * USER_STORE_PAGE_SIZE;
+    char *record = mem_alloc(MEM_TAG_IO, padded);
+    memcpy(record + sizeof(header), username, key_length);
+    memcpy(record + sizeof(header) + key_length, value, length);
+    memset(record + record_size, 0, padded - record_size);
+    header.checksum = record_checksum(&header, record + sizeof(header));
+    memcpy(record, &header, sizeof(header));
+
+    uint32_t first_page = allocate_pages(store, header.page_count);
+    write_at(store->data_fd, record, padded, (off_t)first_page * USER_STORE_PAGE_SIZE);
+    mem_free(record);
+    if (fdatasync(store->data_fd) != 0) store_fail("cannot sync", "data file");
+
+    bool found;
+    uint32_t slot = find_slot(store, username, key_length, hash, &found);
+    if (!found && (store->count + 1) * 10 > store->capacity * 7) {
+        grow_index(store);
+        slot = find_slot(store, username, key_length, hash, &found);
+    }
+
+    user_index_entry previous = store->entries[slot];
+    user_index_entry *entry = &store->entries[slot];
+    entry->hash = hash;
+    entry->first_page = first_page;
+    entry->page_count = header.page_count;
+    write_at(store->index_fd, entry, sizeof(*entry), slot_offset(slot));
+    if (fdatasync(store->index_fd) != 0) store_fail("cannot sync", store->index_path);
+
+    if (found) release_pages(store, previous.first_page, previous.page_count);
+    else store->count++;
+}
+
+/*
+    Calls visit on every record of the store, in index order.
+
+    Parameters:
+        store: the store.
+        visit: function receiving username, value, value length and context.
+        context: passed through to visit.
+
+    Pre-conditions:
+        store and visit must not be NULL; visit must not modify the store.
+*/
+void user_store_scan(user_store_ptr store,
+                     void (*visit)(const char *username, const char *value, size_t length, void *context),
+                     void *context) {
+    CHECK_NULL(store);
+    CHECK_NULL(visit);
+
+    char *buffer = NULL;
+    size_t buffer_size = 0;
+    for (uint32_t i = 0; i < store->capacity; i++) {
+        user_index_entry *entry = &store->entries[i];
+        if (entry->first_page == 0) continue;
+
+        user_record_header header;
+        if (!read_record(store, entry, &buffer, &buffer_size, &header)) {
+            fprintf(stderr, "User store: record at page %u is corrupt\n", entry->first_page);
+            exit(1);
+        }
+
+        // key and value are moved down over the header to terminate both in place
+        char *key = buffer;
+        char *value = buffer + header.key_length + 1;
+        memmove(key, buffer + sizeof(header), header.key_length);
+        memmove(value, buffer + sizeof(header) + header.key_length, header.value_length);
+        key[header.key_length] = '\0';
+        value[header.value_length] = '\0';
+        visit(key, value, header.value_length, context);
+    }
+    mem_free(buffer);
+}
+
+/*
+    Returns the number of records in the store.
+
+    Parameters:
+        store: the store.
+
+    Pre-conditions:
+        store must not be NULL.
+
+    Returns:
+        uint32_t: record count.
+*/
+uint32_t user_store_count(user_store_ptr store) {
+    CHECK_NULL(store);
+    return store->count;
+}
+
+/*
+    Closes the store and frees it.
+
+    Parameters:
+        store: the store.
+
+    Pre-conditions:
+        store must not be NULL.
+
+    Post-conditions:
+        The store must not be used anymore.
+*/
+void user_store_close(user_store_ptr store) {
+    CHECK_NULL(store);
+    close(store->data_fd);
+    close(store->index_fd);
+    mem_free(store->index_path);
+    mem_free(store->entries);
+    mem_free(store->free_runs);
+    mem_free(store);
+}
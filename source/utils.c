@@ -1,6 +1,14 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include "utils.h"
+#include "allocator.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 /*
     Duplicates the given string by allocating new memory and copying the contents.
@@ -19,8 +27,7 @@
 */
 char *str_dup(const char *s) {
     size_t len = strlen(s) + 1;
-    char *dup = malloc(len);
-    CHECK_NULL(dup);
+    char *dup = mem_alloc(MEM_TAG_STRING, len);
     memcpy(dup, s, len);
     return dup;
 }
@@ -76,4 +83,457 @@ void ptr_swap(void **pp1, void **pp2) {
     void *tmp = *pp1;
     *pp1 = *pp2;
     *pp2 = tmp;
-}
\ No newline at end of file
+}
+
+#define INTERN_INITIAL_CAPACITY 64
+
+/*
+    Open addressing table holding one copy of every interned string.
+    Slots are NULL when empty; the table is grown when it is 3/4 full.
+*/
+static char **intern_table = NULL;
+static size_t intern_capacity = 0;
+static size_t intern_count = 0;
+
+/*
+    Computes the FNV-1a hash of the first len bytes of a string.
+
+    Parameters:
+        s: Pointer to the characters to hash.
+        len: Number of characters.
+
+    Pre-condition:
+        s must point to at least len readable bytes.
+
+    Post-condition:
+        None.
+
+    Returns:
+        uint32_t: the hash value of s.
+*/
+uint32_t str_hash(const char *s, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)s[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*
+    Doubles the capacity of the intern table (or creates it) and
+    reinserts every stored string.
+
+    Parameters:
+        None.
+
+    Pre-condition:
+        None.
+
+    Post-condition:
+        intern_table has a larger capacity and contains the same strings.
+
+    Returns:
+        None.
+*/
+static void intern_grow(void) {
+    size_t new_capacity = intern_capacity ? intern_capacity * 2 : INTERN_INITIAL_CAPACITY;
+    char **new_table = mem_calloc(MEM_TAG_STRING, new_capacity, sizeof(char *));
+
+    for (size_t i = 0; i < intern_capacity; i++) {
+        if (!intern_table[i]) continue;
+        size_t idx = str_hash(intern_table[i], strlen(intern_table[i])) & (new_capacity - 1);
+        while (new_table[idx]) {
+            idx = (idx + 1) & (new_capacity - 1);
+        }
+        new_table[idx] = intern_table[i];
+    }
+
+    mem_free(intern_table);
+    intern_table = new_table;
+    intern_capacity = new_capacity;
+}
+
+/*
+    Returns the canonical copy of a string, adding it to the intern
+    table the first time it is seen.
+
+    Parameters:
+        s: Pointer to a null-terminated string.
+
+    Pre-condition:
+        s must not be NULL.
+
+    Post-condition:
+        The intern table contains a copy of s.
+
+    Returns:
+        char*: Pointer to the shared copy. It must not be modified or freed.
+*/
+char *str_intern(const char *s) {
+    CHECK_NULL(s);
+    return str_intern_n(s, strlen(s));
+}
+
+/*
+    Same as str_intern for a string given by pointer and length, which
+    does not need to be null-terminated (e.g. a view into a file mapping).
+
+    Parameters:
+        s: Pointer to the first character.
+        len: Number of characters.
+
+    Pre-condition:
+        s must point to at least len readable bytes.
+
+    Post-condition:
+        The intern table contains a null-terminated copy of the string.
+
+    Returns:
+        char*: Pointer to the shared copy. It must not be modified or freed.
+*/
+char *str_intern_n(const char *s, size_t len) {
+    CHECK_NULL(s);
+
+    if ((intern_count + 1) * 4 > intern_capacity * 3) {
+        intern_grow();
+    }
+
+    size_t idx = str_hash(s, len) & (intern_capacity - 1);
+    while (intern_table[idx]) {
+        if (strncmp(intern_table[idx], s, len) == 0 && intern_table[idx][len] == '\0') {
+            return intern_table[idx];
+        }
+        idx = (idx + 1) & (intern_capacity - 1);
+    }
+
+    char *copy = mem_alloc(MEM_TAG_STRING, len + 1);
+    memcpy(copy, s, len);
+    copy[len] = '\0';
+
+    intern_table[idx] = copy;
+    intern_count++;
+    return copy;
+}
+
+/*
+    Frees every interned string and the intern table itself.
+
+    Parameters:
+        None.
+
+    Pre-condition:
+        No pointer returned by str_intern is used afterwards.
+
+    Post-condition:
+        The intern table is empty.
+
+    Returns:
+        None.
+*/
+void str_intern_clear(void) {
+    for (size_t i = 0; i < intern_capacity; i++) {
+        mem_free(intern_table[i]);
+    }
+    mem_free(intern_table);
+    intern_table = NULL;
+    intern_capacity = 0;
+    intern_count = 0;
+}
+
+
+#define ARENA_BLOCK_SIZE 65536
+#define ARENA_ALIGNMENT 16
+
+struct arena_block {
+    struct arena_block *next;
+    size_t used;
+    size_t capacity;
+    char *data;
+};
+
+struct arena {
+    struct arena_block *head;
+};
+
+/*
+    Arena backing the currently open session, NULL when no session is open.
+*/
+static arena_ptr session_arena = NULL;
+
+/*
+    Header in front of every object from session_alloc, telling
+    session_free in constant time whether it lives in the arena.
+    The union keeps the object aligned like malloc would.
+*/
+typedef union {
+    bool in_arena;
+    long double align;
+} session_header;
+
+/*
+    Allocates a new arena block able to hold at least `capacity` bytes.
+
+    Parameters:
+        capacity: Minimum number of usable bytes in the block.
+
+    Pre-condition:
+        None.
+
+    Post-condition:
+        A new empty block is allocated.
+
+    Returns:
+        struct arena_block*: Pointer to the new block.
+*/
+static struct arena_block *arena_block_create(size_t capacity) {
+    struct arena_block *block = mem_alloc(MEM_TAG_SESSION,
+        sizeof(struct arena_block) + capacity + ARENA_ALIGNMENT);
+    block->next = NULL;
+    block->used = 0;
+    block->capacity = capacity + ARENA_ALIGNMENT;
+    block->data = (char *)(block + 1);
+    return block;
+}
+
+/*
+    Creates an empty arena.
+
+    Parameters:
+        None.
+
+    Pre-condition:
+        None.
+
+    Post-condition:
+        A new arena with one free block is allocated.
+
+    Returns:
+        arena_ptr: Pointer to the new arena.
+*/
+arena_ptr arena_create(void) {
+    arena_ptr arena = mem_alloc(MEM_TAG_SESSION, sizeof(struct arena));
+    arena->head = arena_block_create(ARENA_BLOCK_SIZE);
+    return arena;
+}
+
+/*
+    Bump-allocates `size` bytes from the arena, adding a new block when
+    the current one is exhausted. Requests larger than a block get a
+    dedicated block.
+
+    Parameters:
+        arena: Pointer to the arena.
+        size: Number of bytes requested.
+
+    Pre-condition:
+        arena must not be NULL.
+
+    Post-condition:
+        The returned memory stays valid until arena_delete is called.
+
+    Returns:
+        void*: Pointer to memory aligned to ARENA_ALIGNMENT bytes.
+*/
+void *arena_alloc(arena_ptr arena, size_t size) {
+    CHECK_NULL(arena);
+
+    struct arena_block *block = arena->head;
+    uintptr_t base = (uintptr_t)(block->data + block->used);
+    size_t padding = (ARENA_ALIGNMENT - (base % ARENA_ALIGNMENT)) % ARENA_ALIGNMENT;
+
+    if (block->used + padding + size > block->capacity) {
+        block = arena_block_create(size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+        block->next = arena->head;
+        arena->head = block;
+        base = (uintptr_t)block->data;
+        padding = (ARENA_ALIGNMENT - (base % ARENA_ALIGNMENT)) % ARENA_ALIGNMENT;
+    }
+
+    void *ptr = block->data + block->used + padding;
+    block->used += padding + size;
+    return ptr;
+}
+
+/*
+    Releases every block of the arena and the arena itself.
+
+    Parameters:
+        arena: Pointer to the arena.
+
+    Pre-condition:
+        arena must not be NULL.
+
+    Post-condition:
+        All memory handed out by the arena is invalid.
+
+    Returns:
+        None.
+*/
+void arena_delete(arena_ptr arena) {
+    CHECK_NULL(arena);
+    struct arena_block *block = arena->head;
+    while (block) {
+        struct arena_block *next = block->next;
+        mem_free(block);
+        block = next;
+    }
+    mem_free(arena);
+}
+
+/*
+    Opens the session arena used for every user-scoped allocation.
+
+    Parameters:
+        None.
+
+    Pre-condition:
+        No session is currently open.
+
+    Post-condition:
+        session_alloc serves memory from the new session arena.
+
+    Returns:
+        None; exits the program if a session is already open.
+*/
+void session_open(void) {
+    if (session_arena) {
+        fprintf(stderr, "A session is already open\n");
+        exit(EXIT_FAILURE);
+    }
+    session_arena = arena_create();
+}
+
+/*
+    Releases in one call everything allocated during the session.
+
+    Parameters:
+        None.
+
+    Pre-condition:
+        No session-scoped object is used afterwards.
+
+    Post-condition:
+        No session is open; session_alloc falls back to mem_alloc.
+
+    Returns:
+        None.
+*/
+void session_close(void) {
+    if (!session_arena) return;
+    arena_delete(session_arena);
+    session_arena = NULL;
+}
+
+/*
+    Allocates memory for a session-scoped object.
+
+    Parameters:
+        tag: Subsystem the object belongs to.
+        size: Number of bytes requested.
+
+    Pre-condition:
+        None.
+
+    Post-condition:
+        If a session is open the memory belongs to it, otherwise it is
+        taken from the heap. Either way it is accounted under tag.
+
+    Returns:
+        void*: Pointer to the allocated memory.
+*/
+void *session_alloc(mem_tag tag, size_t size) {
+    session_header *header;
+    if (session_arena) {
+        mem_note_arena(tag, size);
+        header = arena_alloc(session_arena, sizeof(*header) + size);
+        header->in_arena = true;
+    } else {
+        header = mem_alloc(tag, sizeof(*header) + size);
+        header->in_arena = false;
+    }
+    return header + 1;
+}
+
+/*
+    Frees memory obtained from session_alloc. Memory owned by the open
+    session is left alone and released by session_close; the header in
+    front of the object tells which is which without searching the arena.
+
+    Parameters:
+        ptr: Pointer to free (may be NULL).
+
+    Pre-condition:
+        ptr was returned by session_alloc.
+
+    Post-condition:
+        Heap memory is freed; session memory is unchanged.
+
+    Returns:
+        None.
+*/
+void session_free(void *ptr) {
+    if (!ptr) return;
+    session_header *header = (session_header *)ptr - 1;
+    if (header->in_arena) return;
+    mem_free(header);
+}
+
+
+/*
+    Maps a whole file read-only in memory.
+
+    Parameters:
+        filepath: Path of the file.
+        size: Output, receives the file size in bytes.
+
+    Pre-condition:
+        size must not be NULL.
+
+    Post-condition:
+        On success the mapping stays valid until unmap_file.
+
+    Returns:
+        const char*: Start of the mapping, or NULL if the file cannot be
+        opened, is empty or cannot be mapped.
+*/
+const char *map_file(const char *filepath, size_t *size) {
+    CHECK_NULL(size);
+
+    int fd = open(filepath, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) return NULL;
+
+    posix_madvise(base, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+    *size = (size_t)st.st_size;
+    return base;
+}
+
+/*
+    Releases a mapping created by map_file.
+
+    Parameters:
+        base: Start of the mapping.
+        size: Size returned by map_file.
+
+    Pre-condition:
+        base was returned by map_file.
+
+    Post-condition:
+        Views into the mapping are no longer valid.
+
+    Returns:
+        None.
+*/
+void unmap_file(const char *base, size_t size) {
+    if (base) munmap((void *)base, size);
+}
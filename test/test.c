@@ -1,15 +1,51 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include "utils.h"
 #include "main_functions.h"
 
 #define MAX_LINE_LEN 1024
+#define TEST_PATH_LEN 256
+
+/* Course of the catalog the test cases from type 4 on build for themselves */
+typedef struct {
+    int id;
+    const char *name;
+    const char *time;
+    int seats;
+    int booked;
+} test_course;
+
+#define TEST_COURSES 5
+static const test_course test_catalog[TEST_COURSES] = {
+    { 1, "Yoga", "09:30 12/6/2025", 20, 5 },
+    { 2, "Pilates", "10:00 13/6/2025", 10, 10 },
+    { 3, "Spinning", "18:15 14/6/2025", 15, 0 },
+    { 4, "Boxing", "19:00 15/6/2025", 12, 3 },
+    { 5, "Zumba", "20:45 16/6/2025", 30, 29 },
+};
+static const test_course test_crossfit = { 6, "Crossfit", "07:15 17/6/2025", 8, 0 };
+
+// the test user has booked courses 1 and 4; the history is rewritten in
+// the id:count form once the user is saved
+#define TEST_USER "10:00 1/5/2025\n" \
+    "RSSMRA80A01H501U,Mario,Rossi,mrossi,pw123,00:00 1/5/2025,23:59 1/12/2030\n"
+#define TEST_BOOKED "1,4,"
+#define TEST_HISTORY "1,Yoga,3,4,Boxing,1,"
+#define TEST_SAVED_HISTORY "1:3,4:1,"
 
 int compare_files(const char *path1, const char *path2);
 void booking_test(int test_case_type, int id);
 void subscription_test(int test_case_type, int id);
 void report_test(int test_case_type, int id);
+void snapshot_test(int test_case_type, int id);
+void wal_replay_test(int test_case_type, int id);
+void sidecar_test(int test_case_type, int id);
+void user_store_test(int test_case_type, int id);
+void reload_test(int test_case_type, int id);
+void handle_test(int test_case_type, int id);
+void admin_test(int test_case_type, int id);
 
 int main(int argc, char* argv[]) {
     FILE *test_suite;
@@ -32,7 +68,12 @@ int main(int argc, char* argv[]) {
     }
     // printf("Test case type: %d\n", test_case_type);
     
+    // the test cases from type 4 on write their own inputs, so their
+    // directory may not be there yet
     char result_filepath[256];
+    sprintf(result_filepath, "test/%d", test_case_type);
+    mkdir("test", 0777);
+    mkdir(result_filepath, 0777);
     sprintf(result_filepath, "test/%d/%d_test_result.txt", test_case_type, test_case_type);
     FILE* result_file = fopen(result_filepath, "w");
     CHECK_NULL(result_file);
@@ -51,6 +92,27 @@ int main(int argc, char* argv[]) {
             case 3:
                 report_test(test_case_type, id);
                 break;
+            case 4:
+                snapshot_test(test_case_type, id);
+                break;
+            case 5:
+                wal_replay_test(test_case_type, id);
+                break;
+            case 6:
+                sidecar_test(test_case_type, id);
+                break;
+            case 7:
+                user_store_test(test_case_type, id);
+                break;
+            case 8:
+                reload_test(test_case_type, id);
+                break;
+            case 9:
+                handle_test(test_case_type, id);
+                break;
+            case 10:
+                admin_test(test_case_type, id);
+                break;
             default:
                 break;
         }
@@ -94,6 +156,55 @@ int compare_files(const char *path1, const char *path2) {
     return 0;
 }
 
+/* Builds the path of a file of a test case: test/<type>/<type>-<id>_<suffix> */
+static void test_path(char *path, int test_case_type, int id, const char *suffix) {
+    snprintf(path, TEST_PATH_LEN, "test/%d/%d-%d_%s", test_case_type, test_case_type, id, suffix);
+}
+
+/* Appends the outcome of a test case to the result file of its type */
+static void write_result(int test_case_type, int id, int passed) {
+    char result_filepath[TEST_PATH_LEN];
+    sprintf(result_filepath, "test/%d/%d_test_result.txt", test_case_type, test_case_type);
+    FILE* result_file = fopen(result_filepath, "a");
+    CHECK_NULL(result_file);
+    fprintf(result_file, "test:%d = %s\n", id, passed ? "PASS" : "NOT PASS");
+    fclose(result_file);
+}
+
+/* Writes a catalog in the text format, one course per line */
+static void write_catalog(const char *path, const test_course *courses, int count) {
+    FILE *file = fopen(path, "w");
+    CHECK_NULL(file);
+    fprintf(file, "%d\n", count);
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%d,%s,%s,%d,%d,\n", courses[i].id, courses[i].name,
+                courses[i].time, courses[i].seats, courses[i].booked);
+    }
+    fclose(file);
+}
+
+/* Writes the test user with the given booked and history lines */
+static void write_user(const char *path, const char *booked, const char *history) {
+    FILE *file = fopen(path, "w");
+    CHECK_NULL(file);
+    fprintf(file, "%s%s\n%s", TEST_USER, booked, history);
+    fclose(file);
+}
+
+/* Writes the catalog and the user expected once the course id is booked */
+static void write_booked_oracles(const char *course_path, const char *user_path, int id) {
+    test_course courses[TEST_COURSES];
+    memcpy(courses, test_catalog, sizeof(courses));
+    courses[id - 1].booked++;
+    write_catalog(course_path, courses, TEST_COURSES);
+
+    char booked[32];
+    sprintf(booked, "%s%d,", TEST_BOOKED, id);
+    char history[32];
+    sprintf(history, "%s%d:1,", TEST_SAVED_HISTORY, id);
+    write_user(user_path, booked, history);
+}
+
 void booking_test(int test_case_type, int id) {
     hash_map_ptr hash_map = NULL;
     array_ptr array = NULL;
@@ -128,6 +239,7 @@ void booking_test(int test_case_type, int id) {
     ll_delete_list(booked_list, NULL);
     ll_delete_list(history_list, NULL);
     delete_hash_map(hash_map, true);
+    session_close();
     
     // check if output equal oracle
     int course_test = !compare_files(course_output_filepath, course_oracle_filepath);
@@ -170,6 +282,7 @@ void subscription_test(int test_case_type, int id) {
     ll_delete_list(booked_list, NULL);
     ll_delete_list(history_list, NULL);
     delete_hash_map(hash_map, true);
+    session_close();
 
     // Compare output to oracle
     int subscription_test = !compare_files(user_oracle_filepath, user_output_filepath);
@@ -217,6 +330,7 @@ void report_test(int test_case_type, int id) {
     ll_delete_list(booked_list, NULL);
     ll_delete_list(history_list, NULL);
     delete_hash_map(hash_map, true);
+    session_close();
 
     // Compare output to oracle
     int report_test = !compare_files(report_oracle_filepath, report_output_filepath);
@@ -229,4 +343,490 @@ void report_test(int test_case_type, int id) {
     fprintf(result_file, "test:%d = %s\n", id, report_test && user_test ? "PASS" : "NOT PASS");
     fclose(result_file);
     
-}
\ No newline at end of file
+}
+
+void snapshot_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char snapshot_filepath[TEST_PATH_LEN];
+    test_path(snapshot_filepath, test_case_type, id, "course.bin");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+
+    // export the text catalog to a snapshot, then load it back
+    load_courses(course_filepath, &array, &hash_map);
+    save_catalog_snapshot(snapshot_filepath, array, hash_map);
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+
+    int loaded = load_catalog_snapshot(snapshot_filepath, &array, &hash_map);
+
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    write_catalog(course_oracle_filepath, test_catalog, TEST_COURSES);
+
+    int course_test = 0;
+    if (loaded) {
+        save_course(course_output_filepath, array);
+        array_delete(array, NULL);
+        delete_hash_map(hash_map, true);
+        course_test = !compare_files(course_output_filepath, course_oracle_filepath);
+    }
+
+    write_result(test_case_type, id, course_test);
+}
+
+/* Replay callback that leaves the records unapplied, they are only counted */
+static void skip_record(const booking_log_record *record, void *context) {
+    (void)record;
+    (void)context;
+}
+
+void wal_replay_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+    user_ptr user = NULL;
+    linked_list_ptr booked_list = NULL;
+    linked_list_ptr history_list = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char user_filepath[TEST_PATH_LEN];
+    test_path(user_filepath, test_case_type, id, "user.txt");
+    char log_filepath[TEST_PATH_LEN];
+    test_path(log_filepath, test_case_type, id, "user.log");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+    write_user(user_filepath, TEST_BOOKED, TEST_HISTORY);
+    remove(log_filepath);
+
+    // a session books the course and crashes before saving
+    const uint32_t saved_stamp = 1;
+    const uint32_t resaved_stamp = 2;
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    booking_log_open(log_filepath, saved_stamp);
+    action_book_course(id, booked_list, history_list, hash_map, user);
+    booking_log_close();
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // the next login redoes the booking on the saved user
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    replay_booking_log(log_filepath, saved_stamp, booked_list, history_list, hash_map, user);
+
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char user_oracle_filepath[TEST_PATH_LEN];
+    test_path(user_oracle_filepath, test_case_type, id, "user_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    char user_output_filepath[TEST_PATH_LEN];
+    test_path(user_output_filepath, test_case_type, id, "user_output.txt");
+    write_booked_oracles(course_oracle_filepath, user_oracle_filepath, id);
+
+    save_user(user_output_filepath, booked_list, history_list, user);
+    save_course(course_output_filepath, array);
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // once the user is saved again the log no longer applies: opening it
+    // for the new record empties it, and nothing is replayed twice
+    booking_log_open(log_filepath, resaved_stamp);
+    booking_log_close();
+    uint32_t stale = booking_log_replay(log_filepath, saved_stamp, skip_record, NULL)
+                   + booking_log_replay(log_filepath, resaved_stamp, skip_record, NULL);
+    remove(log_filepath);
+
+    // check if output equal oracle
+    int course_test = !compare_files(course_output_filepath, course_oracle_filepath);
+    int user_test = !compare_files(user_output_filepath, user_oracle_filepath);
+
+    write_result(test_case_type, id, course_test && user_test && stale == 0);
+}
+
+void sidecar_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+    user_ptr user = NULL;
+    linked_list_ptr booked_list = NULL;
+    linked_list_ptr history_list = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char user_filepath[TEST_PATH_LEN];
+    test_path(user_filepath, test_case_type, id, "user.txt");
+    char counters_filepath[TEST_PATH_LEN];
+    test_path(counters_filepath, test_case_type, id, "course.seats");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+    write_user(user_filepath, TEST_BOOKED, TEST_HISTORY);
+    remove(counters_filepath);
+
+    // the booking only reaches the sidecar, the text catalog is left as is
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    int opened = seat_counters_open(counters_filepath, course_filepath, array);
+    action_book_course(id, booked_list, history_list, hash_map, user);
+    seat_counters_flush();
+    seat_counters_close();
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // reopening the sidecar brings the booked seat back over the text value
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char user_oracle_filepath[TEST_PATH_LEN];
+    test_path(user_oracle_filepath, test_case_type, id, "user_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    write_booked_oracles(course_oracle_filepath, user_oracle_filepath, id);
+
+    load_courses(course_filepath, &array, &hash_map);
+    opened = opened && seat_counters_open(counters_filepath, course_filepath, array);
+    seat_counters_close();
+    save_course(course_output_filepath, array);
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+
+    // a damaged block is ignored: its courses keep the text catalog values
+    FILE *counters = fopen(counters_filepath, "r+b");
+    CHECK_NULL(counters);
+    fseek(counters, -1, SEEK_END);
+    int last = fgetc(counters);
+    fseek(counters, -1, SEEK_END);
+    fputc(last ^ 0xff, counters);
+    fclose(counters);
+
+    char damaged_oracle_filepath[TEST_PATH_LEN];
+    test_path(damaged_oracle_filepath, test_case_type, id, "course_damaged_oracle.txt");
+    char damaged_output_filepath[TEST_PATH_LEN];
+    test_path(damaged_output_filepath, test_case_type, id, "course_damaged_output.txt");
+    write_catalog(damaged_oracle_filepath, test_catalog, TEST_COURSES);
+
+    load_courses(course_filepath, &array, &hash_map);
+    seat_counters_open(counters_filepath, course_filepath, array);
+    seat_counters_close();
+    save_course(damaged_output_filepath, array);
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+    remove(counters_filepath);
+
+    // check if output equal oracle
+    int course_test = !compare_files(course_output_filepath, course_oracle_filepath);
+    int damaged_test = !compare_files(damaged_output_filepath, damaged_oracle_filepath);
+
+    write_result(test_case_type, id, opened && course_test && damaged_test);
+}
+
+void user_store_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+    user_ptr user = NULL;
+    linked_list_ptr booked_list = NULL;
+    linked_list_ptr history_list = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char user_filepath[TEST_PATH_LEN];
+    test_path(user_filepath, test_case_type, id, "user.txt");
+    char data_filepath[TEST_PATH_LEN];
+    test_path(data_filepath, test_case_type, id, "users.db");
+    char index_filepath[TEST_PATH_LEN];
+    test_path(index_filepath, test_case_type, id, "users.idx");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+    write_user(user_filepath, TEST_BOOKED, TEST_HISTORY);
+    remove(data_filepath);
+    remove(index_filepath);
+
+    // the user is stored, then stored again after the booking
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    user_store_ptr store = user_store_open(data_filepath, index_filepath);
+    save_user_to_store(store, booked_list, history_list, user);
+    action_book_course(id, booked_list, history_list, hash_map, user);
+    save_user_to_store(store, booked_list, history_list, user);
+    char *username = str_dup(get_user_username(user));
+    user_store_close(store);
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // after reopening, the store holds one record: the latest one
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char user_oracle_filepath[TEST_PATH_LEN];
+    test_path(user_oracle_filepath, test_case_type, id, "user_oracle.txt");
+    char user_output_filepath[TEST_PATH_LEN];
+    test_path(user_output_filepath, test_case_type, id, "user_output.txt");
+    write_booked_oracles(course_oracle_filepath, user_oracle_filepath, id);
+
+    uint32_t stamp;
+    store = user_store_open(data_filepath, index_filepath);
+    int store_test = user_store_count(store) == 1 && user_store_contains(store, username);
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user_from_store(store, username, &booked_list, &history_list, &hash_map, &stamp);
+    save_user(user_output_filepath, booked_list, history_list, user);
+    user_store_close(store);
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+    mem_free(username);
+    remove(data_filepath);
+    remove(index_filepath);
+
+    // check if output equal oracle
+    int user_test = !compare_files(user_output_filepath, user_oracle_filepath);
+
+    write_result(test_case_type, id, store_test && user_test);
+}
+
+void reload_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char repeated_filepath[TEST_PATH_LEN];
+    test_path(repeated_filepath, test_case_type, id, "course_repeated.txt");
+    char edited_filepath[TEST_PATH_LEN];
+    test_path(edited_filepath, test_case_type, id, "course_edited.txt");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+
+    // the first edit lists the course with the id of the test case twice
+    test_course edit[TEST_COURSES + 1];
+    memcpy(edit, test_catalog, sizeof(test_catalog));
+    edit[TEST_COURSES] = test_catalog[id - 1];
+    edit[TEST_COURSES].name = "Renamed";
+    write_catalog(repeated_filepath, edit, TEST_COURSES + 1);
+
+    // the second one drops that course, renames the next one, adds a new
+    // one and books seats by hand, ending with a blank line
+    int count = 0;
+    for (int i = 0; i < TEST_COURSES; i++) {
+        if (test_catalog[i].id == id) continue;
+        edit[count] = test_catalog[i];
+        if (test_catalog[i].id == id % TEST_COURSES + 1) edit[count].name = "Renamed";
+        edit[count++].booked = 0;
+    }
+    edit[count++] = test_crossfit;
+    write_catalog(edited_filepath, edit, count);
+    FILE *edited = fopen(edited_filepath, "a");
+    CHECK_NULL(edited);
+    fputc('\n', edited);
+    fclose(edited);
+
+    // the catalog is loaded and watched, then the edits are reloaded: the
+    // first one is rejected, the second one keeps the booked seats in memory
+    load_courses(course_filepath, &array, &hash_map);
+    catalog_watch_open(course_filepath);
+    int rejected = !reload_courses(repeated_filepath, hash_map, array);
+    int reloaded = reload_courses(edited_filepath, hash_map, array);
+
+    // the last course takes the place of the dropped one, the new one is
+    // added after it
+    test_course expected[TEST_COURSES];
+    for (int i = 0; i < TEST_COURSES - 1; i++) {
+        expected[i] = test_catalog[test_catalog[i].id == id ? TEST_COURSES - 1 : i];
+        if (expected[i].id == id % TEST_COURSES + 1) expected[i].name = "Renamed";
+    }
+    expected[TEST_COURSES - 1] = test_crossfit;
+
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    write_catalog(course_oracle_filepath, expected, TEST_COURSES);
+
+    save_course(course_output_filepath, array);
+    catalog_watch_close();
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+
+    // check if output equal oracle
+    int course_test = !compare_files(course_output_filepath, course_oracle_filepath);
+
+    write_result(test_case_type, id, rejected && reloaded && course_test);
+}
+
+void handle_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+    user_ptr user = NULL;
+    linked_list_ptr booked_list = NULL;
+    linked_list_ptr history_list = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char removed_filepath[TEST_PATH_LEN];
+    test_path(removed_filepath, test_case_type, id, "course_removed.txt");
+    char user_filepath[TEST_PATH_LEN];
+    test_path(user_filepath, test_case_type, id, "user.txt");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+    write_user(user_filepath, TEST_BOOKED, TEST_HISTORY);
+
+    // the removed catalog is the test one without the course of the test
+    // case; the last course takes its place in the array, and it comes
+    // back at the end when the catalog is restored
+    test_course expected[TEST_COURSES];
+    int count = 0;
+    for (int i = 0; i < TEST_COURSES; i++) {
+        if (test_catalog[i].id != id) expected[count++] = test_catalog[i];
+    }
+    write_catalog(removed_filepath, expected, count);
+    for (int i = 0; i < count; i++)
+        expected[i] = test_catalog[test_catalog[i].id == id ? TEST_COURSES - 1 : i];
+    expected[count++] = test_catalog[id - 1];
+
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    catalog_watch_open(course_filepath);
+
+    // the booked course with the id of the test case is removed, then a
+    // course with the same id comes back, likely in the same slab slot
+    course_handle handle = get_course_handle(get_course(hash_map, id));
+    reload_courses(removed_filepath, hash_map, array);
+    int removed_test = resolve_course_handle(handle) == NULL;
+    reload_courses(course_filepath, hash_map, array);
+    int restored_test = resolve_course_handle(handle) == NULL && get_course(hash_map, id) != NULL;
+
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char user_oracle_filepath[TEST_PATH_LEN];
+    test_path(user_oracle_filepath, test_case_type, id, "user_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    char user_output_filepath[TEST_PATH_LEN];
+    test_path(user_output_filepath, test_case_type, id, "user_output.txt");
+    write_catalog(course_oracle_filepath, expected, count);
+
+    // the booking of the removed course is dropped from the saved user
+    char booked[32] = "";
+    if (id != 1) strcat(booked, "1,");
+    if (id != 4) strcat(booked, "4,");
+    write_user(user_oracle_filepath, booked, TEST_SAVED_HISTORY);
+
+    save_user(user_output_filepath, booked_list, history_list, user);
+    save_course(course_output_filepath, array);
+    catalog_watch_close();
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // check if output equal oracle
+    int course_test = !compare_files(course_output_filepath, course_oracle_filepath);
+    int user_test = !compare_files(user_output_filepath, user_oracle_filepath);
+
+    write_result(test_case_type, id, removed_test && restored_test && course_test && user_test);
+}
+
+void admin_test(int test_case_type, int id) {
+    hash_map_ptr hash_map = NULL;
+    array_ptr array = NULL;
+    user_ptr user = NULL;
+    linked_list_ptr booked_list = NULL;
+    linked_list_ptr history_list = NULL;
+
+    char course_filepath[TEST_PATH_LEN];
+    test_path(course_filepath, test_case_type, id, "course.txt");
+    char user_filepath[TEST_PATH_LEN];
+    test_path(user_filepath, test_case_type, id, "user.txt");
+    char counters_filepath[TEST_PATH_LEN];
+    test_path(counters_filepath, test_case_type, id, "course.seats");
+    write_catalog(course_filepath, test_catalog, TEST_COURSES);
+    write_user(user_filepath, TEST_BOOKED, TEST_HISTORY);
+    remove(counters_filepath);
+
+    load_courses(course_filepath, &array, &hash_map);
+    user = load_user(user_filepath, &booked_list, &history_list, &hash_map);
+    seat_counters_open(counters_filepath, course_filepath, array);
+
+    // the course with the id of the test case is booked, so it is dirty in
+    // the sidecar when it is deleted; the last course takes its place
+    action_book_course(id, booked_list, history_list, hash_map, user);
+    int deleted = admin_delete_course(hash_map, array, id) && !admin_delete_course(hash_map, array, id);
+
+    datetime_ptr datetime = create_datetime(15, 7, 17, 6, 2025);
+    int added = admin_add_course(hash_map, array, test_crossfit.id, test_crossfit.name, datetime, test_crossfit.seats)
+        && !admin_add_course(hash_map, array, test_crossfit.id, test_crossfit.name, datetime, test_crossfit.seats);
+    int updated = admin_update_course(hash_map, 2, "Pilates Reformer", datetime, 12)
+        && !admin_update_course(hash_map, id, "Pilates Reformer", datetime, 12);
+    delete_datetime(datetime);
+
+    char course_oracle_filepath[TEST_PATH_LEN];
+    test_path(course_oracle_filepath, test_case_type, id, "course_oracle.txt");
+    char user_oracle_filepath[TEST_PATH_LEN];
+    test_path(user_oracle_filepath, test_case_type, id, "user_oracle.txt");
+    char course_output_filepath[TEST_PATH_LEN];
+    test_path(course_output_filepath, test_case_type, id, "course_output.txt");
+    char user_output_filepath[TEST_PATH_LEN];
+    test_path(user_output_filepath, test_case_type, id, "user_output.txt");
+
+    test_course expected[TEST_COURSES];
+    int count = TEST_COURSES - 1;
+    for (int i = 0; i < count; i++) {
+        expected[i] = test_catalog[test_catalog[i].id == id ? TEST_COURSES - 1 : i];
+        if (expected[i].id == 2) {
+            expected[i].name = "Pilates Reformer";
+            expected[i].time = test_crossfit.time;
+            expected[i].seats = 12;
+        }
+    }
+    expected[count++] = test_crossfit;
+    write_catalog(course_oracle_filepath, expected, count);
+
+    // the deleted course stays in the history by name only
+    char history[64];
+    sprintf(history, "%s%d,%s,1,", TEST_SAVED_HISTORY, id, test_catalog[id - 1].name);
+    write_user(user_oracle_filepath, TEST_BOOKED, history);
+
+    // as on exit: the sidecar stayed open, it is flushed, then the catalog
+    // is saved in full and the sidecar stamped with it
+    int opened = seat_counters_is_open();
+    seat_counters_flush();
+    save_user(user_output_filepath, booked_list, history_list, user);
+    save_course(course_output_filepath, array);
+    int stamped = seat_counters_restamp(course_output_filepath, array);
+    seat_counters_close();
+    array_delete(array, NULL);
+    ll_delete_list(booked_list, NULL);
+    ll_delete_list(history_list, NULL);
+    delete_hash_map(hash_map, true);
+    session_close();
+
+    // the counters of the stamped sidecar agree with the saved catalog
+    char reopened_output_filepath[TEST_PATH_LEN];
+    test_path(reopened_output_filepath, test_case_type, id, "course_reopened_output.txt");
+    load_courses(course_output_filepath, &array, &hash_map);
+    stamped = stamped && seat_counters_open(counters_filepath, course_output_filepath, array);
+    seat_counters_close();
+    save_course(reopened_output_filepath, array);
+    array_delete(array, NULL);
+    delete_hash_map(hash_map, true);
+    remove(counters_filepath);
+
+    // check if output equal oracle
+    int course_test = !compare_files(course_output_filepath, course_oracle_filepath)
+        && !compare_files(reopened_output_filepath, course_oracle_filepath);
+    int user_test = !compare_files(user_output_filepath, user_oracle_filepath);
+
+    write_result(test_case_type, id, deleted && added && updated && opened && stamped && course_test && user_test);
+}
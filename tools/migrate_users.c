@@ -0,0 +1,34 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "utils.h"
+#include "main_functions.h"
+
+/*
+    Moves the user files of a flat assets/users/ tree into the hash-sharded
+    layout. Usage: migrate_users [users directory], default assets/users/.
+    Run it from the project root while the program is not running.
+*/
+int main(int argc, char* argv[]) {
+    static const char *const suffixes[] = { USER_FILE_SUFFIX, BOOKING_LOG_SUFFIX };
+    char users_path[256];
+
+    // the path must end with a separator
+    const char *root = argc > 1 ? argv[1] : USERS_PATH;
+    size_t length = strlen(root);
+    if (length == 0 || length + 2 > sizeof(users_path)) {
+        fprintf(stderr, "Invalid users directory\n");
+        return 1;
+    }
+    memcpy(users_path, root, length + 1);
+    if (users_path[length - 1] != '/') {
+        users_path[length] = '/';
+        users_path[length + 1] = '\0';
+    }
+
+    uint32_t moved = migrate_user_files(users_path, suffixes, sizeof(suffixes) / sizeof(suffixes[0]));
+    printf("Moved %u user files into %s\n", moved, users_path);
+    return 0;
+}